@@ -1,52 +1,271 @@
 #include "alert_api.h"
 #include "alert.h"
+#include "alert_worker_pool.h"
+#include "alert_image_store.h"
+#include "report_service.h"
+#include "request_params.h"
 #include <iostream>
+#include <fstream>
+#include <memory>
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
 namespace detector_service {
 
+namespace {
+
+nlohmann::json alertToJson(const AlertRecord& alert) {
+    nlohmann::json a;
+    a["id"] = alert.id;
+    a["channel_id"] = alert.channel_id;
+    a["channel_name"] = alert.channel_name;
+    a["alert_type"] = alert.alert_type;
+    a["alert_rule_id"] = alert.alert_rule_id;
+    a["alert_rule_name"] = alert.alert_rule_name;
+    a["image_path"] = alert.image_path;
+    a["thumbnail_path"] = alert.thumbnail_path;
+    a["confidence"] = alert.confidence;
+    a["detected_objects"] = alert.detected_objects;
+    a["bbox_x"] = alert.bbox_x;
+    a["bbox_y"] = alert.bbox_y;
+    a["bbox_w"] = alert.bbox_w;
+    a["bbox_h"] = alert.bbox_h;
+    a["report_status"] = alert.report_status;
+    a["report_url"] = alert.report_url;
+    a["created_at"] = alert.created_at;
+    a["created_ts"] = alert.created_ts;
+    return a;
+}
+
+// 单页最多返回的报警数
+constexpr int kMaxPageSize = 1000;
+
+// 读取列表查询的翻页参数，limit 限制在 1..kMaxPageSize，offset 不小于 0
+// 带 cursor 参数时按游标翻页（cursor 为空表示第一页），否则沿用 limit/offset
+bool parsePageParams(const HttpRequest& req, HttpResponse& res, int& limit, int& offset,
+                     bool& use_cursor, AlertCursor& cursor) {
+    if (!parseIntParam(req, "limit", limit)) {
+        badRequest(res, "Invalid limit");
+        return false;
+    }
+    if (!parseIntParam(req, "offset", offset)) {
+        badRequest(res, "Invalid offset");
+        return false;
+    }
+    limit = std::clamp(limit, 1, kMaxPageSize);
+    offset = std::max(0, offset);
+    
+    use_cursor = req.has_param("cursor");
+    if (use_cursor) {
+        std::string cursor_text = req.get_param_value("cursor");
+        if (!cursor_text.empty() && !AlertCursor::parse(cursor_text, cursor)) {
+            badRequest(res, "Invalid cursor");
+            return false;
+        }
+    }
+    return true;
+}
+
+// 当前页已满时返回下一页游标，否则为 null（没有更多记录）
+nlohmann::json nextCursor(const std::vector<AlertRecord>& alerts, int limit) {
+    if (limit <= 0 || alerts.size() < static_cast<size_t>(limit)) {
+        return nullptr;
+    }
+    return AlertCursor::after(alerts.back()).toString();
+}
+
+// 读取图片时每次发送的最大字节数
+constexpr size_t kImageChunkSize = 64 * 1024;
+
+// 返回已保存的告警图片
+// 图片保存后内容不再变化，带 ETag 供客户端长期缓存；Range 请求由 httplib 按 content provider 处理
+void serveStoredImage(const HttpRequest& req, HttpResponse& res, const StoredImage& image) {
+    res.set_header("ETag", image.etag);
+    res.set_header("Cache-Control", "private, max-age=31536000, immutable");
+    res.set_header("Accept-Ranges", "bytes");
+    
+    std::string if_none_match = req.get_header_value("If-None-Match");
+    if (if_none_match == "*" || if_none_match.find(image.etag) != std::string::npos) {
+        res.status = 304;
+        return;
+    }
+    
+    auto file = std::make_shared<std::ifstream>(image.file, std::ios::binary);
+    if (!file->is_open()) {
+        res.status = 500;
+        res.set_content("Failed to open image", "text/plain");
+        return;
+    }
+    
+    // 不设置 res.status：httplib 根据 Range 头返回 200 或 206，并只读取请求的区间
+    uint64_t base = image.offset;
+    res.set_content_provider(
+        static_cast<size_t>(image.length), "image/jpeg",
+        [file, base](size_t offset, size_t length, httplib::DataSink& sink) {
+            std::vector<char> buffer(std::min(length, kImageChunkSize));
+            file->clear();
+            file->seekg(static_cast<std::streamoff>(base + offset));
+            if (!file->read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+                return false;
+            }
+            sink.write(buffer.data(), buffer.size());
+            return true;
+        });
+}
+
+} // namespace
+
 void setupAlertRoutes(LwsServer& svr) {
     // 获取所有报警记录
     svr.Get("/api/alerts", [](const HttpRequest& req, HttpResponse& res) {
         int limit = 100;
         int offset = 0;
+        bool use_cursor = false;
+        AlertCursor cursor;
+        if (!parsePageParams(req, res, limit, offset, use_cursor, cursor)) {
+            return;
+        }
         
-        if (req.has_param("limit")) {
-            limit = std::stoi(req.get_param_value("limit"));
+        auto& alert_manager = AlertManager::getInstance();
+        auto alerts = use_cursor ? alert_manager.getAlertsPage(cursor, limit)
+                                 : alert_manager.getAlerts(limit, offset);
+        
+        nlohmann::json alert_list = nlohmann::json::array();
+        for (const auto& alert : alerts) {
+            alert_list.push_back(alertToJson(alert));
         }
-        if (req.has_param("offset")) {
-            offset = std::stoi(req.get_param_value("offset"));
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["alerts"] = alert_list;
+        response["total"] = alert_manager.getAlertCount();
+        response["next_cursor"] = nextCursor(alerts, limit);
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 告警处理线程池统计（排队、丢弃、处理耗时）和上报统计
+    svr.Get("/api/alerts/stats", [](const HttpRequest& /* req */, HttpResponse& res) {
+        auto stats = AlertWorkerPool::getInstance().getStats();
+        auto report_stats = ReportService::getInstance().getStats();
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["submitted"] = stats.submitted;
+        response["processed"] = stats.processed;
+        response["dropped"] = stats.dropped;
+        response["failed"] = stats.failed;
+        response["queue_depth"] = stats.queue_depth;
+        response["queue_capacity"] = stats.queue_capacity;
+        response["workers"] = stats.workers;
+        response["process_ms"] = stats.process_ms;
+        response["report"]["delivered"] = report_stats.delivered;
+        response["report"]["failed"] = report_stats.failed;
+        response["report"]["retried"] = report_stats.retried;
+        response["report"]["pending"] = report_stats.pending;
+        response["report"]["mqtt_inflight"] = report_stats.mqtt_inflight;
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 按上报状态列出报警（status=failed|pending），按ID倒序，before_id 为上一页返回的 next_cursor
+    svr.Get("/api/alerts/reports", [](const HttpRequest& req, HttpResponse& res) {
+        std::string status = req.has_param("status") ? req.get_param_value("status") : "failed";
+        if (status != "failed" && status != "pending") {
+            res.status = 400;
+            res.set_content("Invalid status", "text/plain");
+            return;
         }
+        int limit = 100;
+        int before_id = 0;
+        if (!parseIntParam(req, "limit", limit) || !parseIntParam(req, "before_id", before_id)) {
+            badRequest(res, "Invalid limit or before_id");
+            return;
+        }
+        limit = std::clamp(limit, 1, kMaxPageSize);
         
         auto& alert_manager = AlertManager::getInstance();
-        auto alerts = alert_manager.getAlerts(limit, offset);
+        auto alerts = alert_manager.getAlertsByReportStatus(status, before_id, limit);
         
         nlohmann::json alert_list = nlohmann::json::array();
         for (const auto& alert : alerts) {
-            nlohmann::json a;
-            a["id"] = alert.id;
-            a["channel_id"] = alert.channel_id;
-            a["channel_name"] = alert.channel_name;
-            a["alert_type"] = alert.alert_type;
-            a["alert_rule_id"] = alert.alert_rule_id;
-            a["alert_rule_name"] = alert.alert_rule_name;
-            a["image_path"] = alert.image_path;
-            a["confidence"] = alert.confidence;
-            a["detected_objects"] = alert.detected_objects;
-            a["bbox_x"] = alert.bbox_x;
-            a["bbox_y"] = alert.bbox_y;
-            a["bbox_w"] = alert.bbox_w;
-            a["bbox_h"] = alert.bbox_h;
-            a["report_status"] = alert.report_status;
-            a["report_url"] = alert.report_url;
-            a["created_at"] = alert.created_at;
-            alert_list.push_back(a);
+            alert_list.push_back(alertToJson(alert));
         }
         
         nlohmann::json response;
         response["success"] = true;
         response["alerts"] = alert_list;
-        response["total"] = alert_manager.getAlertCount();
+        response["total"] = alert_manager.getReportStatusCount(status);
+        response["next_cursor"] = alerts.size() < static_cast<size_t>(limit) ? nlohmann::json(nullptr)
+                                                                             : nlohmann::json(alerts.back().id);
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 重新上报：按 alert_ids 指定，或按状态（failed|pending）从最新一条起最多 limit 条
+    svr.Post("/api/alerts/reports/replay", [](const HttpRequest& req, HttpResponse& res) {
+        nlohmann::json json_body;
+        try {
+            json_body = req.body.empty() ? nlohmann::json::object() : nlohmann::json::parse(req.body);
+        } catch (const nlohmann::json::exception&) {
+            res.status = 400;
+            res.set_content("Invalid JSON", "text/plain");
+            return;
+        }
+        
+        auto& alert_manager = AlertManager::getInstance();
+        std::vector<AlertRecord> alerts;
+        try {
+            if (json_body.contains("alert_ids")) {
+                for (int alert_id : json_body["alert_ids"].get<std::vector<int>>()) {
+                    auto alert = alert_manager.getAlert(alert_id);
+                    if (alert.id != 0) {
+                        alerts.push_back(std::move(alert));
+                    }
+                }
+            } else {
+                std::string status = json_body.value("status", std::string("failed"));
+                int limit = std::clamp(json_body.value("limit", 1000), 1, 10000);
+                if (status != "failed" && status != "pending") {
+                    res.status = 400;
+                    res.set_content("Invalid status", "text/plain");
+                    return;
+                }
+                // 沿状态索引分页读取，单次查询不超过 500 条
+                int before_id = 0;
+                while (alerts.size() < static_cast<size_t>(limit)) {
+                    int page_size = std::min(500, limit - static_cast<int>(alerts.size()));
+                    auto page = alert_manager.getAlertsByReportStatus(status, before_id, page_size);
+                    if (page.empty()) {
+                        break;
+                    }
+                    before_id = page.back().id;
+                    alerts.insert(alerts.end(), std::make_move_iterator(page.begin()),
+                                  std::make_move_iterator(page.end()));
+                    if (page.size() < static_cast<size_t>(page_size)) {
+                        break;
+                    }
+                }
+            }
+        } catch (const nlohmann::json::exception&) {
+            res.status = 400;
+            res.set_content("Invalid request", "text/plain");
+            return;
+        }
+        
+        if (!ReportConfigManager::getInstance().isReportEnabled()) {
+            nlohmann::json response;
+            response["success"] = false;
+            response["error"] = "Report is disabled";
+            res.status = 200;
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["matched"] = alerts.size();
+        response["queued"] = ReportService::getInstance().replayAlerts(alerts);
         res.status = 200;
         res.set_content(response.dump(), "application/json");
     });
@@ -65,69 +284,61 @@ void setupAlertRoutes(LwsServer& svr) {
         
         nlohmann::json response;
         response["success"] = true;
-        response["alert"]["id"] = alert.id;
-        response["alert"]["channel_id"] = alert.channel_id;
-        response["alert"]["channel_name"] = alert.channel_name;
-        response["alert"]["alert_type"] = alert.alert_type;
-        response["alert"]["alert_rule_id"] = alert.alert_rule_id;
-        response["alert"]["alert_rule_name"] = alert.alert_rule_name;
-        response["alert"]["image_path"] = alert.image_path;
-        response["alert"]["confidence"] = alert.confidence;
-        response["alert"]["detected_objects"] = alert.detected_objects;
-        response["alert"]["bbox_x"] = alert.bbox_x;
-        response["alert"]["bbox_y"] = alert.bbox_y;
-        response["alert"]["bbox_w"] = alert.bbox_w;
-        response["alert"]["bbox_h"] = alert.bbox_h;
-        response["alert"]["report_status"] = alert.report_status;
-        response["alert"]["report_url"] = alert.report_url;
-        response["alert"]["created_at"] = alert.created_at;
+        response["alert"] = alertToJson(alert);
         
         res.status = 200;
         res.set_content(response.dump(), "application/json");
     });
     
+    // 获取报警图片 / 缩略图（未保存缩略图时返回报警图片）
+    svr.Get(R"(/api/alerts/(\d+)/(image|thumbnail))", [](const HttpRequest& req, HttpResponse& res) {
+        int alert_id = std::stoi(req.matches[1]);
+        bool thumbnail = req.matches[2] == "thumbnail";
+        auto alert = AlertManager::getInstance().getAlert(alert_id);
+        
+        if (alert.id == 0) {
+            res.status = 404;
+            res.set_content("Alert not found", "text/plain");
+            return;
+        }
+        
+        const std::string& location = (thumbnail && !alert.thumbnail_path.empty())
+            ? alert.thumbnail_path : alert.image_path;
+        StoredImage image;
+        if (location.empty() || !AlertImageStore::getInstance().locate(location, image)) {
+            res.status = 404;
+            res.set_content("Image not found", "text/plain");
+            return;
+        }
+        
+        serveStoredImage(req, res, image);
+    });
+    
     // 获取通道的报警记录
     svr.Get(R"(/api/channels/(\d+)/alerts)", [](const HttpRequest& req, HttpResponse& res) {
         int channel_id = std::stoi(req.matches[1]);
         int limit = 100;
         int offset = 0;
-        
-        if (req.has_param("limit")) {
-            limit = std::stoi(req.get_param_value("limit"));
-        }
-        if (req.has_param("offset")) {
-            offset = std::stoi(req.get_param_value("offset"));
+        bool use_cursor = false;
+        AlertCursor cursor;
+        if (!parsePageParams(req, res, limit, offset, use_cursor, cursor)) {
+            return;
         }
         
         auto& alert_manager = AlertManager::getInstance();
-        auto alerts = alert_manager.getAlertsByChannel(channel_id, limit, offset);
+        auto alerts = use_cursor ? alert_manager.getAlertsPage(cursor, limit, channel_id)
+                                 : alert_manager.getAlertsByChannel(channel_id, limit, offset);
         
         nlohmann::json alert_list = nlohmann::json::array();
         for (const auto& alert : alerts) {
-            nlohmann::json a;
-            a["id"] = alert.id;
-            a["channel_id"] = alert.channel_id;
-            a["channel_name"] = alert.channel_name;
-            a["alert_type"] = alert.alert_type;
-            a["alert_rule_id"] = alert.alert_rule_id;
-            a["alert_rule_name"] = alert.alert_rule_name;
-            a["image_path"] = alert.image_path;
-            a["confidence"] = alert.confidence;
-            a["detected_objects"] = alert.detected_objects;
-            a["bbox_x"] = alert.bbox_x;
-            a["bbox_y"] = alert.bbox_y;
-            a["bbox_w"] = alert.bbox_w;
-            a["bbox_h"] = alert.bbox_h;
-            a["report_status"] = alert.report_status;
-            a["report_url"] = alert.report_url;
-            a["created_at"] = alert.created_at;
-            alert_list.push_back(a);
+            alert_list.push_back(alertToJson(alert));
         }
         
         nlohmann::json response;
         response["success"] = true;
         response["alerts"] = alert_list;
         response["total"] = alert_manager.getAlertCountByChannel(channel_id);
+        response["next_cursor"] = nextCursor(alerts, limit);
         res.status = 200;
         res.set_content(response.dump(), "application/json");
     });
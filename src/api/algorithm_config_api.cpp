@@ -49,6 +49,8 @@ void setupAlgorithmConfigRoutes(httplib::Server& svr) {
             roi_json["type"] = (roi.type == ROIType::RECTANGLE) ? "RECTANGLE" : "POLYGON";
             roi_json["name"] = roi.name;
             roi_json["enabled"] = roi.enabled;
+            roi_json["match_mode"] = AlgorithmConfigManager::roiMatchModeToString(roi.match_mode);
+            roi_json["min_overlap_ratio"] = roi.min_overlap_ratio;
             roi_json["points"] = nlohmann::json::array();
             for (size_t j = 0; j < roi.points.size(); j++) {
                 nlohmann::json point_json;
@@ -75,6 +77,10 @@ void setupAlgorithmConfigRoutes(httplib::Server& svr) {
             rule_json["min_count"] = rule.min_count;
             rule_json["max_count"] = rule.max_count;
             rule_json["suppression_window_seconds"] = rule.suppression_window_seconds;
+            rule_json["window_size"] = rule.window_size;
+            rule_json["min_hits"] = rule.min_hits;
+            rule_json["min_duration_seconds"] = rule.min_duration_seconds;
+            rule_json["count_delta"] = rule.count_delta;
             rule_json["roi_ids"] = nlohmann::json::array();
             for (size_t j = 0; j < rule.roi_ids.size(); j++) {
                 rule_json["roi_ids"].push_back(rule.roi_ids[j]);
@@ -148,6 +154,12 @@ void setupAlgorithmConfigRoutes(httplib::Server& svr) {
                                ? ROIType::POLYGON : ROIType::RECTANGLE;
                     roi.name = roi_json.contains("name") ? roi_json["name"].get<std::string>() : std::string("");
                     roi.enabled = roi_json.contains("enabled") ? roi_json["enabled"].get<bool>() : true;
+                    if (roi_json.contains("match_mode")) {
+                        roi.match_mode = AlgorithmConfigManager::stringToROIMatchMode(roi_json["match_mode"].get<std::string>());
+                    }
+                    if (roi_json.contains("min_overlap_ratio")) {
+                        roi.min_overlap_ratio = roi_json["min_overlap_ratio"].get<float>();
+                    }
                     if (roi_json.contains("points")) {
                         for (const auto& point_json : roi_json["points"]) {
                             cv::Point2f point;
@@ -195,6 +207,14 @@ void setupAlgorithmConfigRoutes(httplib::Server& svr) {
                                     ? rule_json["max_count"].get<int>() : 0;
                     rule.suppression_window_seconds = rule_json.contains("suppression_window_seconds") 
                                                      ? rule_json["suppression_window_seconds"].get<int>() : 60;
+                    rule.window_size = rule_json.contains("window_size") 
+                                      ? rule_json["window_size"].get<int>() : 1;
+                    rule.min_hits = rule_json.contains("min_hits") 
+                                   ? rule_json["min_hits"].get<int>() : 1;
+                    rule.min_duration_seconds = rule_json.contains("min_duration_seconds") 
+                                               ? rule_json["min_duration_seconds"].get<int>() : 0;
+                    rule.count_delta = rule_json.contains("count_delta") 
+                                      ? rule_json["count_delta"].get<int>() : 0;
                     if (rule_json.contains("roi_ids")) {
                         for (const auto& roi_id : rule_json["roi_ids"]) {
                             rule.roi_ids.push_back(roi_id.get<int>());
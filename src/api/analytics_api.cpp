@@ -0,0 +1,113 @@
+#include "analytics_api.h"
+#include "analytics_engine.h"
+#include "request_params.h"
+#include <algorithm>
+#include <ctime>
+#include <map>
+#include <nlohmann/json.hpp>
+
+namespace detector_service {
+
+namespace {
+
+// 单次查询的最大时间范围（秒）
+constexpr int64_t kMaxQueryRangeSeconds = 31LL * 24 * 3600;
+
+nlohmann::json bucketToJson(const AnalyticsBucket& bucket) {
+    nlohmann::json b;
+    b["roi_id"] = bucket.roi_id;
+    b["minute_ts"] = bucket.minute_ts;
+    b["entries"] = bucket.entries;
+    b["exits"] = bucket.exits;
+    b["max_occupancy"] = bucket.max_occupancy;
+    b["avg_occupancy"] = bucket.avgOccupancy();
+    return b;
+}
+
+} // namespace
+
+void setupAnalyticsRoutes(LwsServer& svr) {
+    // 通道各区域的实时统计（当前区域内目标数、累计进入/离开数和当前分钟的统计）
+    svr.Get(R"(/api/analytics/(\d+))", [](const HttpRequest& req, HttpResponse& res) {
+        int channel_id = std::stoi(req.matches[1]);
+        
+        nlohmann::json zones = nlohmann::json::array();
+        for (const auto& zone : AnalyticsEngine::getInstance().getLive(channel_id)) {
+            zones.push_back(zoneAnalyticsToJson(zone));
+        }
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["channel_id"] = channel_id;
+        response["zones"] = zones;
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 按分钟汇总的区域统计：from/to 为 Unix 秒（默认最近一小时），roi_id 不指定时返回所有区域，
+    // interval 为汇总粒度（分钟，默认 1），例如 60 按小时汇总
+    svr.Get(R"(/api/analytics/(\d+)/minutes)", [](const HttpRequest& req, HttpResponse& res) {
+        int channel_id = std::stoi(req.matches[1]);
+        int64_t now = static_cast<int64_t>(std::time(nullptr));
+        int64_t to_ts = now + 60;
+        int64_t from_ts = now - 3600;
+        int roi_id = -1;
+        int interval = 1;
+        if (!parseInt64Param(req, "to", to_ts)) {
+            badRequest(res, "Invalid to");
+            return;
+        }
+        if (!parseInt64Param(req, "from", from_ts)) {
+            badRequest(res, "Invalid from");
+            return;
+        }
+        if (!parseIntParam(req, "roi_id", roi_id)) {
+            badRequest(res, "Invalid roi_id");
+            return;
+        }
+        if (!parseIntParam(req, "interval", interval)) {
+            badRequest(res, "Invalid interval");
+            return;
+        }
+        if (from_ts >= to_ts || to_ts - from_ts > kMaxQueryRangeSeconds) {
+            badRequest(res, "Invalid time range");
+            return;
+        }
+        interval = std::clamp(interval, 1, 1440);
+        
+        auto buckets = AnalyticsEngine::getInstance().getBuckets(channel_id, roi_id, from_ts, to_ts);
+        if (interval > 1) {
+            // 按 interval 分钟对齐后合并，结果仍按时间和区域排序
+            const int64_t span = static_cast<int64_t>(interval) * 60;
+            std::map<std::pair<int64_t, int>, AnalyticsBucket> grouped;
+            for (auto& bucket : buckets) {
+                bucket.minute_ts = bucket.minute_ts / span * span;
+                auto result = grouped.emplace(std::make_pair(bucket.minute_ts, bucket.roi_id), bucket);
+                if (!result.second) {
+                    result.first->second.merge(bucket);
+                }
+            }
+            buckets.clear();
+            for (auto& pair : grouped) {
+                buckets.push_back(std::move(pair.second));
+            }
+        }
+        
+        nlohmann::json bucket_list = nlohmann::json::array();
+        for (const auto& bucket : buckets) {
+            bucket_list.push_back(bucketToJson(bucket));
+        }
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["channel_id"] = channel_id;
+        response["from"] = from_ts;
+        response["to"] = to_ts;
+        response["interval"] = interval;
+        response["buckets"] = bucket_list;
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+}
+
+} // namespace detector_service
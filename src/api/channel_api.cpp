@@ -79,7 +79,7 @@ void setupChannelRoutes(httplib::Server& svr,
     // 获取所有通道
     svr.Get("/api/channels", [](const httplib::Request& req, httplib::Response& res) {
         auto& channel_manager = ChannelManager::getInstance();
-        auto channels = channel_manager.getAllChannels();
+        auto channels = channel_manager.getChannelSnapshots();
         
         nlohmann::json channel_list = nlohmann::json::array();
         for (const auto& channel : channels) {
@@ -109,7 +109,7 @@ void setupChannelRoutes(httplib::Server& svr,
     svr.Get(R"(/api/channels/(\d+))", [](const httplib::Request& req, httplib::Response& res) {
         int channel_id = std::stoi(req.matches[1]);
         auto& channel_manager = ChannelManager::getInstance();
-        auto channel = channel_manager.getChannel(channel_id);
+        auto channel = channel_manager.getChannelSnapshot(channel_id);
         
         if (!channel) {
             res.status = 404;
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <httplib.h>
+
+namespace detector_service {
+
+void setupAnalyticsRoutes(httplib::Server& svr);
+
+} // namespace detector_service
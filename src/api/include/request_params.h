@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+namespace detector_service {
+
+// 返回 400 和 {"success": false, "error": error}
+inline void badRequest(HttpResponse& res, const std::string& error) {
+    nlohmann::json response;
+    response["success"] = false;
+    response["error"] = error;
+    res.status = 400;
+    res.set_content(response.dump(), "application/json");
+}
+
+// 读取整数查询参数（未提供时保持 value 不变），不是完整的整数或超出范围时返回 false
+inline bool parseIntParam(const HttpRequest& req, const char* name, int& value) {
+    if (!req.has_param(name)) {
+        return true;
+    }
+    const std::string text = req.get_param_value(name);
+    try {
+        size_t used = 0;
+        int parsed = std::stoi(text, &used);
+        if (used != text.size()) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// 同 parseIntParam，用于时间戳等 64 位参数
+inline bool parseInt64Param(const HttpRequest& req, const char* name, int64_t& value) {
+    if (!req.has_param(name)) {
+        return true;
+    }
+    const std::string text = req.get_param_value(name);
+    try {
+        size_t used = 0;
+        long long parsed = std::stoll(text, &used);
+        if (used != text.size()) {
+            return false;
+        }
+        value = static_cast<int64_t>(parsed);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+} // namespace detector_service
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "image_utils.h"
+
+namespace detector_service {
+
+// WebSocket 二进制消息格式（所有多字节字段均为大端序）
+//
+//   偏移  长度  字段
+//   0     1     type        消息类型（WsBinaryType）
+//   1     1     flags       标志位（WsBinaryFlag）
+//   2     2     count       负载中的检测记录数（H264_ACCESS_UNIT 为 0）
+//   4     4     channel_id  通道ID
+//   8     4     sequence    通道内按消息类型递增的序号
+//   12    8     pts_ms      采集时间戳（毫秒）
+//   20    ...   payload     负载，格式由 type 决定
+//
+// H264_ACCESS_UNIT 负载：一个完整的 Annex-B 访问单元（关键帧前带 SPS/PPS）
+//
+// JPEG_FRAME / DETECTIONS 负载：
+//   width u16 | height u16 | jpeg_size u32 | jpeg 数据 | count 条检测记录
+//   DETECTIONS 不带图像（jpeg_size 为 0），用于直通码流的观看端
+//   width/height 为检测框坐标所在的原始帧尺寸，JPEG 可能按画质档位缩小
+//
+// 检测记录：
+//   class_id u16 | confidence u16（×10000）| x u16 | y u16 | w u16 | h u16 |
+//   name_len u8 | class_name（UTF-8，name_len 字节）
+namespace ws_binary {
+
+constexpr size_t kHeaderSize = 20;
+constexpr size_t kFrameInfoSize = 8;
+
+enum WsBinaryType : uint8_t {
+    H264_ACCESS_UNIT = 1,
+    JPEG_FRAME = 2,
+    DETECTIONS = 3,
+};
+
+enum WsBinaryFlag : uint8_t {
+    FLAG_KEYFRAME = 0x01,
+    FLAG_OVERLAY = 0x02,  // 检测框由客户端绘制（画面未叠加检测框）
+};
+
+inline void writeU16(std::string& buf, size_t offset, uint16_t value) {
+    buf[offset] = static_cast<char>((value >> 8) & 0xFF);
+    buf[offset + 1] = static_cast<char>(value & 0xFF);
+}
+
+inline void writeU32(std::string& buf, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        buf[offset + i] = static_cast<char>((value >> (24 - 8 * i)) & 0xFF);
+    }
+}
+
+inline void writeI64(std::string& buf, size_t offset, int64_t value) {
+    uint64_t v = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; ++i) {
+        buf[offset + i] = static_cast<char>((v >> (56 - 8 * i)) & 0xFF);
+    }
+}
+
+inline void appendU16(std::string& buf, int value) {
+    uint16_t v = static_cast<uint16_t>(std::clamp(value, 0, 0xFFFF));
+    buf.push_back(static_cast<char>((v >> 8) & 0xFF));
+    buf.push_back(static_cast<char>(v & 0xFF));
+}
+
+// 构造消息：写入头部并预留 payload_size 字节负载空间，负载由调用方从 kHeaderSize 处填充
+inline std::string makeMessage(uint8_t type, uint8_t flags, int channel_id,
+                               uint32_t sequence, int64_t pts_ms, size_t payload_size,
+                               uint16_t count = 0) {
+    std::string buf(kHeaderSize + payload_size, '\0');
+    buf[0] = static_cast<char>(type);
+    buf[1] = static_cast<char>(flags);
+    writeU16(buf, 2, count);
+    writeU32(buf, 4, static_cast<uint32_t>(channel_id));
+    writeU32(buf, 8, sequence);
+    writeI64(buf, 12, pts_ms);
+    return buf;
+}
+
+// 构造 JPEG_FRAME / DETECTIONS 消息
+// detections 为 nullptr 表示画面已叠加检测框，不携带检测记录
+inline std::string makeFrameMessage(uint8_t type, int channel_id, uint32_t sequence, int64_t pts_ms,
+                                    int width, int height, const std::vector<uchar>& jpeg,
+                                    const std::vector<Detection>* detections) {
+    size_t count = detections ? std::min<size_t>(detections->size(), 0xFFFF) : 0;
+    std::string buf = makeMessage(type, detections ? FLAG_OVERLAY : 0, channel_id, sequence, pts_ms,
+                                  kFrameInfoSize + jpeg.size(), static_cast<uint16_t>(count));
+    writeU16(buf, kHeaderSize, static_cast<uint16_t>(std::clamp(width, 0, 0xFFFF)));
+    writeU16(buf, kHeaderSize + 2, static_cast<uint16_t>(std::clamp(height, 0, 0xFFFF)));
+    writeU32(buf, kHeaderSize + 4, static_cast<uint32_t>(jpeg.size()));
+    if (!jpeg.empty()) {
+        std::copy(jpeg.begin(), jpeg.end(), buf.begin() + kHeaderSize + kFrameInfoSize);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const Detection& det = (*detections)[i];
+        appendU16(buf, det.class_id);
+        appendU16(buf, static_cast<int>(det.confidence * 10000.0f + 0.5f));
+        appendU16(buf, det.bbox.x);
+        appendU16(buf, det.bbox.y);
+        appendU16(buf, det.bbox.width);
+        appendU16(buf, det.bbox.height);
+        size_t name_len = std::min<size_t>(det.class_name.size(), 0xFF);
+        buf.push_back(static_cast<char>(name_len));
+        buf.append(det.class_name, 0, name_len);
+    }
+    return buf;
+}
+
+} // namespace ws_binary
+
+} // namespace detector_service
@@ -13,7 +13,9 @@
 #include <condition_variable>
 #include <chrono>
 #include <memory>
+#include <deque>
 #include "image_utils.h"
+#include "config.h"
 
 namespace detector_service {
 
@@ -32,9 +34,52 @@ enum class ConnectionType {
     ALERT     // 报警数据订阅
 };
 
+// 通道订阅的画面格式
+enum class StreamFormat {
+    JPEG,  // 逐帧 JPEG 与检测结果（二进制 JPEG_FRAME 消息，见 ws_binary_protocol.h）
+    H264   // 源码流直通的 H.264 访问单元（二进制消息），通道未直通时回退为 JPEG
+};
+
+// 单个连接的发送队列
+// 发送在独立线程中进行，不持有全局连接锁，慢速连接只会积压自己的队列
+struct ClientSendQueue {
+    struct Message {
+        std::shared_ptr<const std::string> data;  // 多个连接共享同一份已编码消息
+        bool binary = true;
+    };
+    
+    explicit ClientSendQueue(std::shared_ptr<ix::WebSocket> c) : conn(std::move(c)) {}
+    
+    std::shared_ptr<ix::WebSocket> conn;
+    std::mutex mutex;
+    std::deque<Message> messages;                   // 按序发送的消息（报警、控制消息、直通码流）
+    size_t queued_bytes = 0;                        // messages 中的字节数
+    std::shared_ptr<const std::string> latest_frame; // 最新画面帧，新帧直接覆盖未发送的旧帧
+    bool scheduled = false;                         // 是否已在待发送列表中
+    bool closed = false;                            // 连接已断开
+    bool waiting_keyframe = false;                  // 直通码流丢包后等待下一个关键帧
+    bool congested = false;                         // 最近一次发送时是否拥塞
+    std::chrono::steady_clock::time_point congested_since;
+    uint64_t dropped_frames = 0;
+    uint64_t dropped_messages = 0;
+};
+
 struct ConnectionInfo {
     ConnectionType type;
     int channel_id;  // 仅用于 CHANNEL 类型
+    StreamFormat format = StreamFormat::JPEG;  // 仅用于 CHANNEL 类型
+    int tier = 0;  // JPEG 画质档位（StreamConfig::tiers 下标），仅用于 CHANNEL 类型
+    std::shared_ptr<ClientSendQueue> queue;
+};
+
+// 通道画面发送统计（实际帧率与目标帧率）
+struct ChannelSendStats {
+    int channel_id = 0;
+    int target_fps = 0;          // 通道配置的帧率
+    double achieved_fps = 0.0;   // 最近一个统计窗口内实际发送的帧率
+    double encode_ms = 0.0;      // 单帧编码耗时（指数滑动平均，毫秒）
+    size_t subscribers = 0;      // 当前订阅者数量
+    size_t congested = 0;        // 发送拥塞的订阅者数量
 };
 
 // 帧数据结构，用于缓冲队列
@@ -42,6 +87,9 @@ struct FrameData {
     int channel_id;
     cv::Mat frame;
     std::chrono::steady_clock::time_point timestamp;
+    int64_t pts_ms = 0;                  // 帧采集时间戳（毫秒）
+    bool has_overlay = false;            // 是否携带检测结果（客户端叠加模式）
+    std::vector<Detection> detections;   // 客户端叠加模式下随帧下发的检测结果
 };
 
 class WebSocketHandler {
@@ -54,8 +102,24 @@ public:
     // 发送报警信息（仅发送给报警订阅连接）
     void broadcastAlert(const AlertMessage& alert);
     
-    // 发送图片帧（仅发送给订阅了对应通道的连接）
-    void broadcastFrame(int channel_id, const cv::Mat& frame);
+    // 发送通道的区域客流统计（JSON 消息，仅发送给订阅了对应通道的连接）
+    void broadcastAnalytics(int channel_id, const std::string& json);
+    
+    // 发送图片帧（仅发送给订阅了对应通道的连接），以二进制消息发送（见 ws_binary_protocol.h）
+    // overlay_detections 非空时，检测结果打包在同一条消息中，由客户端绘制
+    void broadcastFrame(int channel_id, const cv::Mat& frame, int64_t pts_ms = 0,
+                        const std::vector<Detection>* overlay_detections = nullptr);
+    
+    // 转发源码流的 H.264 访问单元（Annex-B，仅发送给以 H.264 格式订阅的连接）
+    // 同时缓存当前 GOP，新订阅者从最近的关键帧开始播放
+    void broadcastPacket(int channel_id, const uint8_t* data, size_t size,
+                         bool keyframe, int64_t pts_ms);
+    
+    // 通道的源码流直通结束（停止分析或回退到解码模式），清空 GOP 缓存
+    void endPacketStream(int channel_id);
+    
+    // 获取各通道的画面发送统计
+    std::vector<ChannelSendStats> getChannelSendStats();
     
     // 处理 WebSocket 连接
     void handleChannelConnection(std::shared_ptr<ix::WebSocket> conn);
@@ -70,9 +134,27 @@ private:
     WebSocketHandler(const WebSocketHandler&) = delete;
     WebSocketHandler& operator=(const WebSocketHandler&) = delete;
     
-    // 发送线程工作函数
+    // 发送线程工作函数：多个线程从 latest_frames_ 中取帧，同一通道同一时间只由一个线程处理
     void sendWorker();
     
+    // 编码并发送一个通道的帧（含帧率控制）
+    void sendChannelFrame(const FrameData& frame_data);
+    
+    // 发送队列：入队后由 flushWorker 在全局锁之外发送
+    // keyframe 仅用于直通码流，丢包后从下一个关键帧恢复
+    void enqueueFrame(const std::shared_ptr<ClientSendQueue>& queue,
+                      std::shared_ptr<const std::string> message);
+    void enqueueMessage(const std::shared_ptr<ClientSendQueue>& queue,
+                        std::shared_ptr<const std::string> message, bool binary,
+                        bool is_packet = false, bool keyframe = false);
+    void scheduleFlush(const std::shared_ptr<ClientSendQueue>& queue);
+    void flushWorker();
+    // 发送队列中的数据，返回是否仍有数据因拥塞未能发送
+    bool flushQueue(const std::shared_ptr<ClientSendQueue>& queue);
+    // 处理持续拥塞的连接：降低画质档位或断开
+    void handleCongestion(const std::shared_ptr<ClientSendQueue>& queue,
+                          std::chrono::steady_clock::duration congested_for);
+    
     std::mutex connections_mutex_;
     // 存储连接和其订阅信息
     std::map<std::shared_ptr<ix::WebSocket>, ConnectionInfo> connections_;
@@ -82,22 +164,51 @@ private:
     // 帧缓冲相关
     std::condition_variable frame_queue_cv_;
     std::atomic<bool> running_;
-    std::thread send_thread_;
+    std::vector<std::thread> send_threads_;
     
     // 每个通道的最新帧（用于丢帧机制）
     std::map<int, FrameData> latest_frames_;
+    std::set<int> channels_in_progress_;  // 正在编码发送的通道
+    int next_channel_hint_ = 0;           // 轮转取帧的起始通道，避免低编号通道长期优先
     std::mutex latest_frames_mutex_;
     
     // 每个通道的帧率控制信息
     struct ChannelFpsControl {
         int fps;  // 通道帧率
         std::chrono::steady_clock::time_point last_send_time;  // 上次发送时间
+        uint32_t sequence = 0;                // 帧消息序号
+        // 发送统计
+        std::chrono::steady_clock::time_point window_start;
+        int window_frames = 0;
+        double achieved_fps = 0.0;
+        double encode_ms = 0.0;
     };
     std::map<int, ChannelFpsControl> channel_fps_controls_;
     std::mutex channel_fps_controls_mutex_;
     
+    // 发送队列调度
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    std::deque<std::shared_ptr<ClientSendQueue>> flush_ready_;  // 有新数据待发送的连接
+    std::thread flush_thread_;
+    
+    // 每个通道的源码流直通状态（由 connections_mutex_ 保护）
+    struct PacketStream {
+        std::vector<std::shared_ptr<const std::string>> gop_cache;  // 从最近关键帧开始的已编码消息
+        size_t gop_bytes = 0;
+        uint32_t sequence = 0;
+    };
+    std::map<int, PacketStream> packet_streams_;
+    
+    // 收集通道订阅者需要的 JPEG 画质档位，为空表示不需要编码（调用方需持有 connections_mutex_）
+    std::set<int> collectJpegTiers(int channel_id,
+                                   const std::set<std::shared_ptr<ix::WebSocket>>& subscribers) const;
+    
+    // 订阅者是否接收 JPEG 帧（调用方需持有 connections_mutex_）
+    bool wantsJpeg(int channel_id, const std::shared_ptr<ix::WebSocket>& conn) const;
+    
     std::string alertToJson(const AlertMessage& alert);
-    std::string frameToJson(int channel_id, const cv::Mat& frame);
+    std::string encodeFrame(const FrameData& frame_data, uint32_t sequence, const StreamTier& tier);
 };
 
 } // namespace detector_service
@@ -3,6 +3,7 @@
 #include <ixwebsocket/IXWebSocketServer.h>
 #include <ixwebsocket/IXConnectionState.h>
 #include "config.h"
+#include <nlohmann/json.hpp>
 #include <iostream>
 #include <memory>
 #include <atomic>
@@ -178,6 +179,29 @@ void setupWebSocketRoutes(httplib::Server& svr) {
         }
     });
     
+    // 各通道画面发送统计（实际帧率 / 目标帧率 / 编码耗时 / 拥塞连接数）
+    svr.Get("/api/ws/stats", [](const httplib::Request& /* req */, httplib::Response& res) {
+        auto stats = WebSocketHandler::getInstance().getChannelSendStats();
+        
+        nlohmann::json channels = nlohmann::json::array();
+        for (const auto& s : stats) {
+            nlohmann::json item;
+            item["channel_id"] = s.channel_id;
+            item["target_fps"] = s.target_fps;
+            item["achieved_fps"] = s.achieved_fps;
+            item["encode_ms"] = s.encode_ms;
+            item["subscribers"] = s.subscribers;
+            item["congested"] = s.congested;
+            channels.push_back(item);
+        }
+        
+        nlohmann::json response;
+        response["success"] = true;
+        response["channels"] = channels;
+        res.status = 200;
+        res.set_content(response.dump(), "application/json");
+    });
+    
     svr.Get("/ws/alert", [ws_port](const httplib::Request& req, httplib::Response& res) {
         bool is_upgrade = false;
         auto upgrade_it = req.headers.find("Upgrade");
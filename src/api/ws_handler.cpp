@@ -1,25 +1,58 @@
 #include "ws_handler.h"
-#include <sstream>
-#include <iomanip>
-#include <ctime>
+#include "ws_binary_protocol.h"
 #include <nlohmann/json.hpp>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 #include "image_utils.h"
 #include "channel.h"
 
 namespace detector_service {
 
+namespace {
+
+// GOP 缓存上限，超出后丢弃缓存，新订阅者等待下一个关键帧
+constexpr size_t kMaxGopCacheBytes = 8 * 1024 * 1024;
+constexpr size_t kMaxGopCachePackets = 300;
+
+// 发送统计窗口与编码耗时平滑系数
+constexpr auto kStatsWindow = std::chrono::seconds(1);
+constexpr double kEncodeTimeSmoothing = 0.2;
+
+// IXWebSocket 内部发送缓冲超过该值时视为拥塞，后续数据留在连接自己的队列中（画面可合并、可丢弃）
+constexpr size_t kSocketHighWater = 512 * 1024;
+// 存在拥塞连接时的重试间隔
+constexpr auto kCongestionRetryInterval = std::chrono::milliseconds(20);
+
+} // namespace
+
 WebSocketHandler::WebSocketHandler() : running_(true) {
-    // 启动发送线程
-    send_thread_ = std::thread(&WebSocketHandler::sendWorker, this);
+    // 启动发送线程池，各通道的编码分散到多个线程
+    int thread_count = Config::getInstance().getStreamConfig().encode_threads;
+    if (thread_count <= 0) {
+        thread_count = static_cast<int>(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        send_threads_.emplace_back(&WebSocketHandler::sendWorker, this);
+    }
+    flush_thread_ = std::thread(&WebSocketHandler::flushWorker, this);
 }
 
 WebSocketHandler::~WebSocketHandler() {
     // 停止发送线程
     running_ = false;
     frame_queue_cv_.notify_all();
-    if (send_thread_.joinable()) {
-        send_thread_.join();
+    for (auto& thread : send_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+    }
+    flush_cv_.notify_all();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
     }
 }
 
@@ -28,6 +61,7 @@ void WebSocketHandler::handleChannelConnection(std::shared_ptr<ix::WebSocket> co
     ConnectionInfo info;
     info.type = ConnectionType::CHANNEL;
     info.channel_id = -1;  // 初始值，等待客户端订阅
+    info.queue = std::make_shared<ClientSendQueue>(conn);
     connections_[conn] = info;
 }
 
@@ -36,6 +70,7 @@ void WebSocketHandler::handleAlertConnection(std::shared_ptr<ix::WebSocket> conn
     ConnectionInfo info;
     info.type = ConnectionType::ALERT;
     info.channel_id = -1;
+    info.queue = std::make_shared<ClientSendQueue>(conn);
     connections_[conn] = info;
 }
 
@@ -43,6 +78,14 @@ void WebSocketHandler::handleDisconnection(std::shared_ptr<ix::WebSocket> conn)
     std::lock_guard<std::mutex> lock(connections_mutex_);
     auto it = connections_.find(conn);
     if (it != connections_.end()) {
+        // 丢弃未发送的数据，发送线程不再处理该连接
+        if (it->second.queue) {
+            std::lock_guard<std::mutex> queue_lock(it->second.queue->mutex);
+            it->second.queue->closed = true;
+            it->second.queue->messages.clear();
+            it->second.queue->queued_bytes = 0;
+            it->second.queue->latest_frame.reset();
+        }
         // 如果是通道订阅，从通道订阅列表中移除
         if (it->second.type == ConnectionType::CHANNEL && it->second.channel_id >= 0) {
             int channel_id = it->second.channel_id;
@@ -68,28 +111,76 @@ void WebSocketHandler::handleChannelMessage(std::shared_ptr<ix::WebSocket> conn,
         if (msg.contains("action") && msg["action"] == "subscribe") {
             if (msg.contains("channel_id")) {
                 int channel_id = msg["channel_id"];
+                StreamFormat format = StreamFormat::JPEG;
+                if (msg.contains("format") && msg["format"] == "h264") {
+                    format = StreamFormat::H264;
+                }
                 
-                std::lock_guard<std::mutex> lock(connections_mutex_);
-                auto it = connections_.find(conn);
-                if (it != connections_.end()) {
-                    // 如果之前已订阅其他通道，先移除旧订阅
-                    if (it->second.channel_id >= 0) {
-                        auto& old_channel_conns = channel_subscriptions_[it->second.channel_id];
-                        old_channel_conns.erase(conn);
-                        if (old_channel_conns.empty()) {
-                            channel_subscriptions_.erase(it->second.channel_id);
+                // 画质档位，未指定或不存在时使用默认档位
+                const auto& tiers = Config::getInstance().getStreamConfig().tiers;
+                int tier = 0;
+                if (msg.contains("tier") && msg["tier"].is_string()) {
+                    std::string tier_name = msg["tier"];
+                    for (size_t i = 0; i < tiers.size(); ++i) {
+                        if (tiers[i].name == tier_name) {
+                            tier = static_cast<int>(i);
+                            break;
                         }
                     }
-                    
-                    // 更新订阅信息
-                    it->second.channel_id = channel_id;
-                    channel_subscriptions_[channel_id].insert(conn);
-                    
-                    // 发送确认消息
-                    nlohmann::json response;
-                    response["type"] = "subscription_confirmed";
-                    response["channel_id"] = channel_id;
-                    conn->sendText(response.dump());
+                }
+                
+                std::shared_ptr<ClientSendQueue> queue;
+                std::vector<std::shared_ptr<const std::string>> gop_cache;
+                nlohmann::json response;
+                {
+                    std::lock_guard<std::mutex> lock(connections_mutex_);
+                    auto it = connections_.find(conn);
+                    if (it != connections_.end()) {
+                        // 如果之前已订阅其他通道，先移除旧订阅
+                        if (it->second.channel_id >= 0) {
+                            auto& old_channel_conns = channel_subscriptions_[it->second.channel_id];
+                            old_channel_conns.erase(conn);
+                            if (old_channel_conns.empty()) {
+                                channel_subscriptions_.erase(it->second.channel_id);
+                            }
+                        }
+                        
+                        // 更新订阅信息
+                        it->second.channel_id = channel_id;
+                        it->second.format = format;
+                        it->second.tier = tier;
+                        channel_subscriptions_[channel_id].insert(conn);
+                        
+                        // 发送确认消息
+                        response["type"] = "subscription_confirmed";
+                        response["channel_id"] = channel_id;
+                        response["format"] = (format == StreamFormat::H264) ? "h264" : "jpeg";
+                        nlohmann::json tier_names = nlohmann::json::array();
+                        for (const auto& t : tiers) {
+                            tier_names.push_back(t.name);
+                        }
+                        response["tiers"] = tier_names;
+                        if (!tiers.empty()) {
+                            response["tier"] = tiers[tier].name;
+                        }
+                        queue = it->second.queue;
+                        
+                        // 通道正在直通时，先补发缓存的 GOP，新订阅者无需等待下一个关键帧
+                        if (format == StreamFormat::H264) {
+                            auto ps_it = packet_streams_.find(channel_id);
+                            if (ps_it != packet_streams_.end()) {
+                                gop_cache = ps_it->second.gop_cache;
+                            }
+                        }
+                    }
+                }
+                
+                // 在全局锁之外入队，由发送线程发送
+                if (queue) {
+                    enqueueMessage(queue, std::make_shared<const std::string>(response.dump()), false);
+                    for (size_t i = 0; i < gop_cache.size(); ++i) {
+                        enqueueMessage(queue, gop_cache[i], true, true, i == 0);
+                    }
                 }
             }
         }
@@ -109,23 +200,45 @@ void WebSocketHandler::handleAlertMessage(std::shared_ptr<ix::WebSocket> conn,
 }
 
 void WebSocketHandler::broadcastAlert(const AlertMessage& alert) {
-    std::string json = alertToJson(alert);
+    auto json = std::make_shared<const std::string>(alertToJson(alert));
     
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    for (const auto& pair : connections_) {
-        if (pair.second.type == ConnectionType::ALERT && pair.first) {
-            try {
-                if (pair.first->getReadyState() == ix::ReadyState::Open) {
-                    pair.first->sendText(json);
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "发送报警消息失败: " << e.what() << std::endl;
+    // 只在锁内收集报警订阅连接，入队和发送都不阻塞调用方（检测线程）
+    std::vector<std::shared_ptr<ClientSendQueue>> queues;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (const auto& pair : connections_) {
+            if (pair.second.type == ConnectionType::ALERT && pair.second.queue) {
+                queues.push_back(pair.second.queue);
             }
         }
     }
+    for (const auto& queue : queues) {
+        enqueueMessage(queue, json, false);
+    }
 }
 
-void WebSocketHandler::broadcastFrame(int channel_id, const cv::Mat& frame) {
+void WebSocketHandler::broadcastAnalytics(int channel_id, const std::string& json) {
+    std::vector<std::shared_ptr<ClientSendQueue>> queues;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (const auto& pair : connections_) {
+            if (pair.second.type == ConnectionType::CHANNEL && pair.second.channel_id == channel_id &&
+                pair.second.queue) {
+                queues.push_back(pair.second.queue);
+            }
+        }
+    }
+    if (queues.empty()) {
+        return;
+    }
+    auto message = std::make_shared<const std::string>(json);
+    for (const auto& queue : queues) {
+        enqueueMessage(queue, message, false);
+    }
+}
+
+void WebSocketHandler::broadcastFrame(int channel_id, const cv::Mat& frame, int64_t pts_ms,
+                                      const std::vector<Detection>* overlay_detections) {
     // 使用丢帧机制：只保留每个通道的最新帧
     {
         std::lock_guard<std::mutex> lock(latest_frames_mutex_);
@@ -133,14 +246,18 @@ void WebSocketHandler::broadcastFrame(int channel_id, const cv::Mat& frame) {
         frame_data.channel_id = channel_id;
         frame_data.frame = frame.clone();  // 克隆帧数据
         frame_data.timestamp = std::chrono::steady_clock::now();
+        frame_data.pts_ms = pts_ms;
+        if (overlay_detections) {
+            frame_data.has_overlay = true;
+            frame_data.detections = *overlay_detections;
+        }
         latest_frames_[channel_id] = std::move(frame_data);
     }
     
-    // 初始化或更新通道的FPS控制信息
+    // 初始化或更新通道的FPS控制信息（通道信息取内存快照，不访问数据库）
+    auto channel = ChannelManager::getInstance().getChannelSnapshot(channel_id);
     {
         std::lock_guard<std::mutex> fps_lock(channel_fps_controls_mutex_);
-        auto& channel_manager = ChannelManager::getInstance();
-        auto channel = channel_manager.getChannel(channel_id);
         if (channel) {
             auto it = channel_fps_controls_.find(channel_id);
             if (it == channel_fps_controls_.end()) {
@@ -160,102 +277,554 @@ void WebSocketHandler::broadcastFrame(int channel_id, const cv::Mat& frame) {
     frame_queue_cv_.notify_one();
 }
 
+void WebSocketHandler::broadcastPacket(int channel_id, const uint8_t* data, size_t size,
+                                       bool keyframe, int64_t pts_ms) {
+    if (!data || size == 0) {
+        return;
+    }
+    
+    std::vector<std::shared_ptr<ClientSendQueue>> queues;
+    std::shared_ptr<const std::string> shared_message;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto& stream = packet_streams_[channel_id];
+        
+        std::string message = ws_binary::makeMessage(
+            ws_binary::H264_ACCESS_UNIT,
+            keyframe ? ws_binary::FLAG_KEYFRAME : 0,
+            channel_id, stream.sequence++, pts_ms, size);
+        std::memcpy(&message[ws_binary::kHeaderSize], data, size);
+        shared_message = std::make_shared<const std::string>(std::move(message));
+        
+        // 维护 GOP 缓存：关键帧时重新开始，超出上限时放弃缓存直到下一个关键帧
+        if (keyframe) {
+            stream.gop_cache.clear();
+            stream.gop_bytes = 0;
+        }
+        if (keyframe || !stream.gop_cache.empty()) {
+            if (stream.gop_cache.size() < kMaxGopCachePackets &&
+                stream.gop_bytes + shared_message->size() <= kMaxGopCacheBytes) {
+                stream.gop_bytes += shared_message->size();
+                stream.gop_cache.push_back(shared_message);
+            } else {
+                stream.gop_cache.clear();
+                stream.gop_bytes = 0;
+            }
+        }
+        
+        auto it = channel_subscriptions_.find(channel_id);
+        if (it == channel_subscriptions_.end()) {
+            return;
+        }
+        
+        for (const auto& conn : it->second) {
+            auto info_it = connections_.find(conn);
+            if (info_it == connections_.end() || info_it->second.format != StreamFormat::H264) {
+                continue;
+            }
+            if (info_it->second.queue) {
+                queues.push_back(info_it->second.queue);
+            }
+        }
+    }
+    
+    // 拥塞的连接丢弃数据包并从下一个关键帧恢复，不影响其他观看端和拉流线程
+    for (const auto& queue : queues) {
+        enqueueMessage(queue, shared_message, true, true, keyframe);
+    }
+}
+
+void WebSocketHandler::endPacketStream(int channel_id) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    packet_streams_.erase(channel_id);
+}
+
+bool WebSocketHandler::wantsJpeg(int channel_id, const std::shared_ptr<ix::WebSocket>& conn) const {
+    // 通道未直通时，H.264 订阅者也回退为 JPEG
+    if (packet_streams_.find(channel_id) == packet_streams_.end()) {
+        return true;
+    }
+    auto it = connections_.find(conn);
+    return it != connections_.end() && it->second.format == StreamFormat::JPEG;
+}
+
+std::set<int> WebSocketHandler::collectJpegTiers(
+    int channel_id, const std::set<std::shared_ptr<ix::WebSocket>>& subscribers) const {
+    std::set<int> tiers;
+    for (const auto& conn : subscribers) {
+        if (!wantsJpeg(channel_id, conn)) {
+            continue;
+        }
+        auto it = connections_.find(conn);
+        tiers.insert(it != connections_.end() ? it->second.tier : 0);
+    }
+    return tiers;
+}
+
 void WebSocketHandler::sendWorker() {
     // 添加帧率控制，根据通道FPS限制发送频率，避免浏览器来不及渲染
     
+    // 查找一个有新帧且未被其他线程处理的通道（调用方需持有 latest_frames_mutex_）
+    auto findReadyChannel = [this]() -> std::map<int, FrameData>::iterator {
+        auto start = latest_frames_.lower_bound(next_channel_hint_);
+        for (auto it = start; it != latest_frames_.end(); ++it) {
+            if (channels_in_progress_.count(it->first) == 0) {
+                return it;
+            }
+        }
+        for (auto it = latest_frames_.begin(); it != start; ++it) {
+            if (channels_in_progress_.count(it->first) == 0) {
+                return it;
+            }
+        }
+        return latest_frames_.end();
+    };
+    
     while (running_) {
         std::unique_lock<std::mutex> lock(latest_frames_mutex_);
         
         // 等待新帧或停止信号
-        frame_queue_cv_.wait(lock, [this] {
-            return !latest_frames_.empty() || !running_;
+        frame_queue_cv_.wait(lock, [&] {
+            return !running_ || findReadyChannel() != latest_frames_.end();
         });
         
         if (!running_) {
             break;
         }
         
-        // 获取所有通道的最新帧
-        std::map<int, FrameData> frames_to_send = latest_frames_;
-        latest_frames_.clear();  // 清空，等待新帧
+        // 取出该通道的最新帧，处理期间其他线程不会处理同一通道，保证发送顺序和帧率控制
+        auto it = findReadyChannel();
+        int channel_id = it->first;
+        FrameData frame_data = std::move(it->second);
+        latest_frames_.erase(it);
+        channels_in_progress_.insert(channel_id);
+        next_channel_hint_ = channel_id + 1;
         lock.unlock();
         
-        // 发送每个通道的最新帧（带帧率控制）
-        for (const auto& pair : frames_to_send) {
-            int channel_id = pair.first;
-            const FrameData& frame_data = pair.second;
+        try {
+            sendChannelFrame(frame_data);
+        } catch (const std::exception& e) {
+            std::cerr << "发送帧数据失败 (通道 " << channel_id << "): " << e.what() << std::endl;
+        }
+        
+        // 处理期间可能有该通道的新帧到达，唤醒其他线程处理
+        lock.lock();
+        channels_in_progress_.erase(channel_id);
+        bool has_pending = latest_frames_.count(channel_id) > 0;
+        lock.unlock();
+        if (has_pending) {
+            frame_queue_cv_.notify_one();
+        }
+    }
+}
+
+void WebSocketHandler::sendChannelFrame(const FrameData& frame_data) {
+    int channel_id = frame_data.channel_id;
+    
+    // 检查是否有订阅者（快速检查，避免不必要的编码）
+    // 所有订阅者都在接收直通码流时，不需要编码 JPEG，只下发检测元数据
+    std::set<int> jpeg_tiers;
+    {
+        std::lock_guard<std::mutex> conn_lock(connections_mutex_);
+        auto it = channel_subscriptions_.find(channel_id);
+        if (it == channel_subscriptions_.end() || it->second.empty()) {
+            return;  // 没有订阅者，跳过编码和发送
+        }
+        jpeg_tiers = collectJpegTiers(channel_id, it->second);
+    }
+    if (jpeg_tiers.empty() && !frame_data.has_overlay) {
+        return;
+    }
+    
+    // 帧率控制：检查是否应该发送这一帧
+    // 同一源帧的 JPEG_FRAME 和 DETECTIONS 消息使用相同序号
+    uint32_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> fps_lock(channel_fps_controls_mutex_);
+        auto fps_it = channel_fps_controls_.find(channel_id);
+        if (fps_it != channel_fps_controls_.end()) {
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                now - fps_it->second.last_send_time).count();
             
-            // 检查是否有订阅者（快速检查，避免不必要的编码）
-            {
-                std::lock_guard<std::mutex> conn_lock(connections_mutex_);
-                auto it = channel_subscriptions_.find(channel_id);
-                if (it == channel_subscriptions_.end() || it->second.empty()) {
-                    continue;  // 没有订阅者，跳过编码和发送
-                }
-            }
+            // 计算帧间隔（微秒）
+            int64_t frame_interval_us = 1000000LL / fps_it->second.fps;
             
-            // 帧率控制：检查是否应该发送这一帧
-            {
-                std::lock_guard<std::mutex> fps_lock(channel_fps_controls_mutex_);
-                auto fps_it = channel_fps_controls_.find(channel_id);
-                if (fps_it != channel_fps_controls_.end()) {
-                    auto now = std::chrono::steady_clock::now();
-                    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-                        now - fps_it->second.last_send_time).count();
-                    
-                    // 计算帧间隔（微秒）
-                    int64_t frame_interval_us = 1000000LL / fps_it->second.fps;
-                    
-                    // 如果距离上次发送时间太短，跳过这一帧（丢帧以保持流畅）
-                    if (elapsed < frame_interval_us) {
-                        continue;  // 跳过这一帧，等待下一帧
-                    }
-                    
-                    // 更新上次发送时间
-                    fps_it->second.last_send_time = now;
-                }
+            // 如果距离上次发送时间太短，跳过这一帧（丢帧以保持流畅）
+            if (elapsed < frame_interval_us) {
+                return;  // 跳过这一帧，等待下一帧
             }
             
-            // 编码帧数据（在锁外执行，避免阻塞其他通道）
-            // 注意：编码是耗时操作，但必须同步执行以确保数据一致性
-            std::string json = frameToJson(channel_id, frame_data.frame);
+            // 更新上次发送时间
+            fps_it->second.last_send_time = now;
+            sequence = fps_it->second.sequence++;
+        }
+    }
+    
+    // 编码帧数据（在锁外执行，避免阻塞其他通道）
+    // 每个档位只编码一次，由该档位的所有订阅者共享
+    auto encode_start = std::chrono::steady_clock::now();
+    const auto& tiers = Config::getInstance().getStreamConfig().tiers;
+    std::map<int, std::shared_ptr<const std::string>> tier_messages;
+    for (int tier : jpeg_tiers) {
+        std::string message = (tier >= 0 && tier < static_cast<int>(tiers.size()))
+            ? encodeFrame(frame_data, sequence, tiers[tier])
+            : encodeFrame(frame_data, sequence, StreamTier{});
+        if (!message.empty()) {
+            tier_messages[tier] = std::make_shared<const std::string>(std::move(message));
+        }
+    }
+    std::shared_ptr<const std::string> detections_message;
+    if (frame_data.has_overlay) {
+        detections_message = std::make_shared<const std::string>(ws_binary::makeFrameMessage(
+            ws_binary::DETECTIONS, channel_id, sequence, frame_data.pts_ms,
+            frame_data.frame.cols, frame_data.frame.rows, {}, &frame_data.detections));
+    }
+    auto encode_end = std::chrono::steady_clock::now();
+    
+    // 更新发送统计
+    {
+        std::lock_guard<std::mutex> fps_lock(channel_fps_controls_mutex_);
+        auto fps_it = channel_fps_controls_.find(channel_id);
+        if (fps_it != channel_fps_controls_.end()) {
+            auto& control = fps_it->second;
+            double encode_ms = std::chrono::duration<double, std::milli>(encode_end - encode_start).count();
+            control.encode_ms = (control.encode_ms == 0.0)
+                ? encode_ms
+                : control.encode_ms + kEncodeTimeSmoothing * (encode_ms - control.encode_ms);
             
-            // 发送给所有订阅者
-            std::lock_guard<std::mutex> conn_lock(connections_mutex_);
-            auto it = channel_subscriptions_.find(channel_id);
-            if (it == channel_subscriptions_.end() || it->second.empty()) {
-                continue;  // 订阅者可能在编码期间断开
+            if (control.window_frames == 0) {
+                control.window_start = encode_end;
+            }
+            control.window_frames++;
+            auto window = encode_end - control.window_start;
+            if (window >= kStatsWindow) {
+                control.achieved_fps = control.window_frames /
+                    std::chrono::duration<double>(window).count();
+                control.window_frames = 0;
+            }
+        }
+    }
+    
+    // 在锁内确定每个订阅者要接收的消息，锁外放入各连接的发送队列
+    std::vector<std::pair<std::shared_ptr<ClientSendQueue>, std::shared_ptr<const std::string>>> targets;
+    {
+        std::lock_guard<std::mutex> conn_lock(connections_mutex_);
+        auto it = channel_subscriptions_.find(channel_id);
+        if (it == channel_subscriptions_.end() || it->second.empty()) {
+            return;  // 订阅者可能在编码期间断开
+        }
+        
+        std::vector<std::shared_ptr<ix::WebSocket>> to_remove;
+        for (const auto& conn : it->second) {
+            auto info_it = connections_.find(conn);
+            if (!conn || info_it == connections_.end() || !info_it->second.queue ||
+                conn->getReadyState() != ix::ReadyState::Open) {
+                to_remove.push_back(conn);
+                continue;
             }
             
-            std::vector<std::shared_ptr<ix::WebSocket>> to_remove;
-            for (auto conn : it->second) {
-                if (conn && conn->getReadyState() == ix::ReadyState::Open) {
-                    try {
-                        conn->sendText(json);
-                    } catch (const std::exception& e) {
-                        std::cerr << "发送帧数据失败 (通道 " << channel_id << "): " 
-                                  << e.what() << std::endl;
-                        // 标记为需要移除的连接
-                        to_remove.push_back(conn);
-                    }
-                } else {
-                    to_remove.push_back(conn);
+            // JPEG_FRAME 消息中已包含检测结果
+            std::shared_ptr<const std::string> message;
+            if (wantsJpeg(channel_id, conn)) {
+                auto msg_it = tier_messages.find(info_it->second.tier);
+                if (msg_it != tier_messages.end()) {
+                    message = msg_it->second;
                 }
             }
-            
-            // 移除失效的连接
-            for (auto conn : to_remove) {
-                it->second.erase(conn);
-                connections_.erase(conn);
+            if (!message) {
+                message = detections_message;
             }
-            
-            if (it->second.empty()) {
-                channel_subscriptions_.erase(it);
+            if (message) {
+                targets.emplace_back(info_it->second.queue, std::move(message));
             }
         }
+        
+        // 移除失效的连接
+        for (const auto& conn : to_remove) {
+            it->second.erase(conn);
+            connections_.erase(conn);
+        }
+        
+        if (it->second.empty()) {
+            channel_subscriptions_.erase(it);
+        }
+    }
+    
+    for (auto& target : targets) {
+        enqueueFrame(target.first, std::move(target.second));
     }
 }
 
+void WebSocketHandler::enqueueFrame(const std::shared_ptr<ClientSendQueue>& queue,
+                                    std::shared_ptr<const std::string> message) {
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->closed) {
+            return;
+        }
+        // 只保留最新一帧：连接来不及发送的旧帧直接被覆盖
+        if (queue->latest_frame) {
+            queue->dropped_frames++;
+        }
+        queue->latest_frame = std::move(message);
+    }
+    scheduleFlush(queue);
+}
+
+void WebSocketHandler::enqueueMessage(const std::shared_ptr<ClientSendQueue>& queue,
+                                      std::shared_ptr<const std::string> message, bool binary,
+                                      bool is_packet, bool keyframe) {
+    size_t budget = Config::getInstance().getStreamConfig().client_send_budget;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->closed) {
+            return;
+        }
+        if (is_packet) {
+            // 丢包后的非关键帧无法解码，直接丢弃
+            if (queue->waiting_keyframe && !keyframe) {
+                queue->dropped_messages++;
+                return;
+            }
+            queue->waiting_keyframe = false;
+        }
+        // 超出发送缓冲上限时丢弃（队列为空时总是接受，避免单条大消息永远发不出去）
+        if (!queue->messages.empty() && queue->queued_bytes + message->size() > budget) {
+            queue->dropped_messages++;
+            if (is_packet) {
+                queue->waiting_keyframe = true;
+            }
+            return;
+        }
+        queue->queued_bytes += message->size();
+        queue->messages.push_back({std::move(message), binary});
+    }
+    scheduleFlush(queue);
+}
+
+void WebSocketHandler::scheduleFlush(const std::shared_ptr<ClientSendQueue>& queue) {
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->scheduled || queue->closed) {
+            return;
+        }
+        queue->scheduled = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        flush_ready_.push_back(queue);
+    }
+    flush_cv_.notify_one();
+}
+
+void WebSocketHandler::flushWorker() {
+    // 拥塞的连接不在待发送列表中，定期重试直到其发送缓冲回落
+    std::set<std::shared_ptr<ClientSendQueue>> congested;
+    
+    while (running_) {
+        std::deque<std::shared_ptr<ClientSendQueue>> ready;
+        {
+            std::unique_lock<std::mutex> lock(flush_mutex_);
+            auto has_work = [this] { return !running_ || !flush_ready_.empty(); };
+            if (congested.empty()) {
+                flush_cv_.wait(lock, has_work);
+            } else {
+                flush_cv_.wait_for(lock, kCongestionRetryInterval, has_work);
+            }
+            if (!running_) {
+                break;
+            }
+            ready.swap(flush_ready_);
+        }
+        
+        for (const auto& queue : congested) {
+            ready.push_back(queue);
+        }
+        congested.clear();
+        
+        for (const auto& queue : ready) {
+            if (flushQueue(queue)) {
+                congested.insert(queue);
+            }
+        }
+    }
+}
+
+bool WebSocketHandler::flushQueue(const std::shared_ptr<ClientSendQueue>& queue) {
+    const auto& conn = queue->conn;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->scheduled = false;
+        if (queue->closed) {
+            return false;
+        }
+    }
+    if (!conn || conn->getReadyState() != ix::ReadyState::Open) {
+        return false;
+    }
+    
+    bool pending = false;
+    while (true) {
+        // IXWebSocket 的发送缓冲未回落前不再写入，数据留在本连接的队列中
+        bool socket_full = conn->bufferedAmount() >= kSocketHighWater;
+        
+        ClientSendQueue::Message message;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            if (queue->closed) {
+                return false;
+            }
+            if (socket_full) {
+                pending = !queue->messages.empty() || queue->latest_frame;
+                break;
+            }
+            if (!queue->messages.empty()) {
+                message = std::move(queue->messages.front());
+                queue->messages.pop_front();
+                queue->queued_bytes -= message.data->size();
+            } else if (queue->latest_frame) {
+                message.data = std::move(queue->latest_frame);
+                message.binary = true;
+            } else {
+                break;
+            }
+        }
+        
+        try {
+            if (message.binary) {
+                conn->sendBinary(*message.data);
+            } else {
+                conn->sendText(*message.data);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "WebSocket 发送失败: " << e.what() << std::endl;
+            return false;
+        }
+    }
+    
+    // 记录拥塞持续时间
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration congested_for{0};
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (pending) {
+            if (!queue->congested) {
+                queue->congested = true;
+                queue->congested_since = now;
+            }
+            congested_for = now - queue->congested_since;
+        } else {
+            queue->congested = false;
+        }
+    }
+    if (pending) {
+        handleCongestion(queue, congested_for);
+    }
+    return pending;
+}
+
+void WebSocketHandler::handleCongestion(const std::shared_ptr<ClientSendQueue>& queue,
+                                        std::chrono::steady_clock::duration congested_for) {
+    const auto& config = Config::getInstance().getStreamConfig();
+    if (congested_for < std::chrono::milliseconds(config.congestion_downgrade_ms)) {
+        return;
+    }
+    
+    std::string notice;
+    bool disconnect = false;
+    int channel_id = -1;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto it = connections_.find(queue->conn);
+        if (it == connections_.end()) {
+            return;
+        }
+        auto& info = it->second;
+        channel_id = info.channel_id;
+        
+        // JPEG 观看端先逐级降低画质档位
+        bool can_downgrade = info.type == ConnectionType::CHANNEL && info.channel_id >= 0 &&
+                             wantsJpeg(info.channel_id, queue->conn) &&
+                             info.tier + 1 < static_cast<int>(config.tiers.size());
+        if (can_downgrade) {
+            info.tier++;
+            nlohmann::json j;
+            j["type"] = "tier_changed";
+            j["channel_id"] = info.channel_id;
+            j["tier"] = config.tiers[info.tier].name;
+            j["reason"] = "congestion";
+            notice = j.dump();
+        } else if (congested_for >= std::chrono::milliseconds(config.congestion_disconnect_ms)) {
+            disconnect = true;
+        } else {
+            return;
+        }
+    }
+    
+    if (!notice.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->congested_since = std::chrono::steady_clock::now();
+        }
+        std::cerr << "WebSocket 连接持续拥塞，降低画质档位 (通道 " << channel_id << ")" << std::endl;
+        enqueueMessage(queue, std::make_shared<const std::string>(std::move(notice)), false);
+        return;
+    }
+    
+    if (disconnect) {
+        uint64_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->closed = true;
+            queue->messages.clear();
+            queue->queued_bytes = 0;
+            queue->latest_frame.reset();
+            dropped = queue->dropped_frames + queue->dropped_messages;
+        }
+        std::cerr << "WebSocket 连接持续拥塞，断开连接 (通道 " << channel_id
+                  << ", 已丢弃 " << dropped << " 条消息)" << std::endl;
+        queue->conn->close(1008, "send queue congested");
+    }
+}
+
+std::vector<ChannelSendStats> WebSocketHandler::getChannelSendStats() {
+    std::vector<ChannelSendStats> stats;
+    {
+        std::lock_guard<std::mutex> fps_lock(channel_fps_controls_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& pair : channel_fps_controls_) {
+            ChannelSendStats s;
+            s.channel_id = pair.first;
+            s.target_fps = pair.second.fps;
+            s.encode_ms = pair.second.encode_ms;
+            // 超过两个统计窗口没有发送，视为已停止
+            s.achieved_fps = (now - pair.second.last_send_time > 2 * kStatsWindow)
+                ? 0.0 : pair.second.achieved_fps;
+            stats.push_back(s);
+        }
+    }
+    
+    std::lock_guard<std::mutex> conn_lock(connections_mutex_);
+    for (auto& s : stats) {
+        auto it = channel_subscriptions_.find(s.channel_id);
+        if (it == channel_subscriptions_.end()) {
+            continue;
+        }
+        s.subscribers = it->second.size();
+        for (const auto& conn : it->second) {
+            auto info_it = connections_.find(conn);
+            if (info_it != connections_.end() && info_it->second.queue) {
+                std::lock_guard<std::mutex> queue_lock(info_it->second.queue->mutex);
+                if (info_it->second.queue->congested) {
+                    s.congested++;
+                }
+            }
+        }
+    }
+    return stats;
+}
+
 std::string WebSocketHandler::alertToJson(const AlertMessage& alert) {
     nlohmann::json j;
     j["type"] = "alert";
@@ -269,23 +838,30 @@ std::string WebSocketHandler::alertToJson(const AlertMessage& alert) {
     return j.dump();
 }
 
-std::string WebSocketHandler::frameToJson(int channel_id, const cv::Mat& frame) {
-    // 使用较低的 JPEG 质量参数（60）以减少编码时间和数据大小，降低延迟
-    // 对于实时视频流，60 的质量已经足够清晰
-    std::string image_base64 = ImageUtils::matToBase64(frame, ".jpg", 60);
-    
-    nlohmann::json j;
-    j["type"] = "frame";
-    j["channel_id"] = channel_id;
-    j["image_base64"] = image_base64;
+std::string WebSocketHandler::encodeFrame(const FrameData& frame_data, uint32_t sequence,
+                                          const StreamTier& tier) {
+    // 超出档位最大宽度时等比缩小后再编码
+    // 检测框坐标仍基于原始帧尺寸，客户端按消息中的宽高缩放
+    // 缩放画布和 JPEG 缓冲区按线程复用，避免每帧重新分配
+    thread_local cv::Mat scaled;
+    thread_local std::vector<uchar> jpeg;
+    const cv::Mat* image = &frame_data.frame;
+    if (tier.max_width > 0 && frame_data.frame.cols > tier.max_width) {
+        int height = static_cast<int>(static_cast<int64_t>(frame_data.frame.rows) * tier.max_width /
+                                      frame_data.frame.cols);
+        cv::resize(frame_data.frame, scaled, cv::Size(tier.max_width, std::max(height, 1)), 0, 0, cv::INTER_AREA);
+        image = &scaled;
+    }
     
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    j["timestamp"] = oss.str();
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, tier.jpeg_quality};
+    if (!cv::imencode(".jpg", *image, jpeg, params)) {
+        return "";
+    }
     
-    return j.dump();
+    return ws_binary::makeFrameMessage(
+        ws_binary::JPEG_FRAME, frame_data.channel_id, sequence, frame_data.pts_ms,
+        frame_data.frame.cols, frame_data.frame.rows, jpeg,
+        frame_data.has_overlay ? &frame_data.detections : nullptr);
 }
 
 } // namespace detector_service
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace detector_service {
 
@@ -34,7 +35,11 @@ struct DetectorConfig {
 
 struct DatabaseConfig {
     std::string db_path = "detector.db";
-    int max_storage_days = 30;
+    int max_storage_days = 30;               // 报警保留天数，0 表示不清理
+    int retention_interval_seconds = 600;    // 过期报警清理周期
+    int retention_batch_size = 500;          // 每个事务最多删除的报警数
+    int retention_batch_pause_ms = 50;       // 批次间隔，让出写连接给报警写入
+    int retention_vacuum_pages = 2000;       // 每轮清理后增量回收的页数
 };
 
 struct ServerConfig {
@@ -43,6 +48,112 @@ struct ServerConfig {
     int max_connections = 100;
 };
 
+// 检测框叠加方式
+enum class OverlayMode {
+    BURN_IN,  // 服务端将检测框绘制到画面上（默认）
+    CLIENT    // 服务端转发原始画面，检测结果作为元数据单独下发，由客户端绘制
+};
+
+// WebSocket 观看端的画质档位
+// 同一档位的画面每帧只编码一次，由订阅该档位的所有观看端共享
+struct StreamTier {
+    std::string name;       // 档位名称，订阅时指定
+    int max_width = 0;      // 最大宽度，超出时等比缩小；0 表示保持原始分辨率
+    int jpeg_quality = 60;  // JPEG 质量
+};
+
+struct StreamConfig {
+    OverlayMode overlay_mode = OverlayMode::BURN_IN;
+    // 画质档位，第一个为默认档位
+    std::vector<StreamTier> tiers = {
+        {"high", 0, 60},
+        {"medium", 1280, 55},
+        {"low", 640, 45},
+    };
+    // WebSocket 画面编码线程数，0 表示按 CPU 核数自动选择（最多 4 个）
+    int encode_threads = 0;
+    // 每个 WebSocket 连接的发送缓冲上限（字节），超出后丢弃画面/报警，直通码流等待下一个关键帧
+    size_t client_send_budget = 4 * 1024 * 1024;
+    // 连接持续拥塞超过该时长后降低一个画质档位（毫秒）
+    int congestion_downgrade_ms = 2000;
+    // 已是最低档位仍持续拥塞超过该时长后断开连接（毫秒）
+    int congestion_disconnect_ms = 10000;
+    // 压缩流直通：源为H.264时，直接转发源码流给WebSocket观看端和GB28181，不再重新编码
+    // 直通时画面无法绘制检测框，检测框始终以元数据方式下发
+    bool passthrough = false;
+    
+    // 检测框是否由客户端绘制
+    bool clientOverlay() const {
+        return overlay_mode == OverlayMode::CLIENT || passthrough;
+    }
+};
+
+// 告警处理队列已满时的处理方式
+enum class AlertOverflowPolicy {
+    DROP_OLDEST,  // 丢弃队列中最早的告警（默认，保留最新的现场）
+    DROP_NEWEST   // 丢弃新触发的告警
+};
+
+// 告警图片内容（图片文件、上报和 WebSocket 推送）
+enum class AlertSnapshotPolicy {
+    FULL_FRAME,          // 整帧画面（默认），WebSocket 推送缩略图
+    DETECTION_CROP,      // 只保留置信度最高的目标附近区域
+    THUMBNAIL_AND_CROP   // 目标区域 + 整帧缩略图（缩略图随上报和 WebSocket 推送并落盘，重试上报时重新加载）
+};
+
+struct AlertConfig {
+    int worker_threads = 2;   // 告警处理线程数（图片编码、保存、入库和上报）
+    size_t queue_size = 32;   // 待处理告警上限，每条告警持有一帧画面
+    AlertOverflowPolicy overflow_policy = AlertOverflowPolicy::DROP_OLDEST;
+    int jpeg_quality = 90;    // 告警图片 JPEG 质量
+    int thumbnail_width = 320;    // WebSocket 推送的缩略图宽度（像素），0 表示推送原图
+    int thumbnail_quality = 70;   // 缩略图 JPEG 质量
+    AlertSnapshotPolicy snapshot_policy = AlertSnapshotPolicy::FULL_FRAME;
+    float crop_margin = 0.5f;     // 目标区域向四周扩展的比例（相对检测框宽高）
+    int crop_min_size = 128;      // 目标区域最小边长（像素），避免小目标截图过小
+    std::string image_dir = "alerts";   // 告警图片根目录，按 <日期>/<通道ID> 分目录保存
+    int image_sync_interval_ms = 200;   // 告警图片目录项和缩略图打包文件批量 fsync 周期（毫秒），0 表示不主动 fsync（图片文件也不 fsync）
+    bool thumbnail_pack = true;         // 缩略图追加写入每天一个的打包文件（仅在生成了缩略图时）
+};
+
+// 多目标跟踪（检测与告警之间）：为检测结果分配轨迹ID，未检测的帧按运动模型预测检测框位置，
+// 告警规则按轨迹去重（同一目标只告警一次）
+struct TrackerConfig {
+    bool enabled = true;
+    float min_iou = 0.3f;          // 检测框与轨迹预测框关联的最小 IoU
+    int max_lost_detections = 5;   // 轨迹连续多少次检测未关联后删除（短暂遮挡或漏检时保持ID）
+    int max_tracks = 64;           // 每个通道同时跟踪的最大目标数
+};
+
+// 区域客流统计：基于跟踪结果按ROI统计进入/离开次数和区域内目标数，按分钟汇总后写入数据库
+struct AnalyticsConfig {
+    bool enabled = true;
+    int flush_interval_seconds = 60;  // 已结束的分钟统计写入数据库的周期
+    int push_interval_ms = 1000;      // 统计变化时 WebSocket 推送的最小间隔（每个通道）
+    int exit_grace_ms = 2000;         // 目标离开区域（或消失）超过该时长才计为离开，避免漏检造成重复计数
+};
+
+// 报警上报中图片的编码方式
+enum class ReportImageMode {
+    BASE64,  // 图片 base64 后内嵌在 JSON 中（默认，兼容原有接收端）
+    RAW,     // 原始 JPEG 字节：HTTP 使用 multipart/form-data，MQTT 使用二进制负载
+    URL      // 只上报图片地址 <image_base_url>/api/alerts/<id>/image，接收端按需下载
+};
+
+// 报警上报投递（上报地址和方式在 Web 端配置，见 ReportConfig）
+struct ReportDeliveryConfig {
+    int workers = 2;                // 并发上报线程数，每个线程保持一个 HTTP 长连接
+    int batch_size = 1;             // HTTP 每次 POST 合并的报警数，大于 1 时请求体为 JSON 数组
+    int max_attempts = 10;          // 最多尝试次数，仍失败时标记为 failed
+    int retry_base_ms = 2000;       // 首次重试延迟（毫秒），之后每次加倍
+    int retry_max_ms = 300000;      // 重试延迟上限（毫秒）
+    int http_timeout_seconds = 5;   // HTTP 连接和读取超时
+    int mqtt_max_inflight = 100;    // MQTT 流水线发布时同时等待 PUBACK 的最大消息数
+    int mqtt_ack_timeout_seconds = 30;  // MQTT 未收到 PUBACK 时重新排队的超时
+    ReportImageMode image_mode = ReportImageMode::BASE64;
+    std::string image_base_url;     // URL 模式下的图片地址前缀（本服务对外地址，如 http://192.168.1.10:9090）
+};
+
 class Config {
 public:
     static Config& getInstance() {
@@ -54,10 +165,20 @@ public:
     void setDetectorConfig(const DetectorConfig& config) { detector_config_ = config; }
     void setDatabaseConfig(const DatabaseConfig& config) { database_config_ = config; }
     void setServerConfig(const ServerConfig& config) { server_config_ = config; }
+    void setStreamConfig(const StreamConfig& config) { stream_config_ = config; }
+    void setAlertConfig(const AlertConfig& config) { alert_config_ = config; }
+    void setReportDeliveryConfig(const ReportDeliveryConfig& config) { report_delivery_config_ = config; }
+    void setTrackerConfig(const TrackerConfig& config) { tracker_config_ = config; }
+    void setAnalyticsConfig(const AnalyticsConfig& config) { analytics_config_ = config; }
 
     const DetectorConfig& getDetectorConfig() const { return detector_config_; }
     const DatabaseConfig& getDatabaseConfig() const { return database_config_; }
     const ServerConfig& getServerConfig() const { return server_config_; }
+    const StreamConfig& getStreamConfig() const { return stream_config_; }
+    const AlertConfig& getAlertConfig() const { return alert_config_; }
+    const ReportDeliveryConfig& getReportDeliveryConfig() const { return report_delivery_config_; }
+    const TrackerConfig& getTrackerConfig() const { return tracker_config_; }
+    const AnalyticsConfig& getAnalyticsConfig() const { return analytics_config_; }
 
 private:
     Config() = default;
@@ -68,6 +189,11 @@ private:
     DetectorConfig detector_config_;
     DatabaseConfig database_config_;
     ServerConfig server_config_;
+    StreamConfig stream_config_;
+    AlertConfig alert_config_;
+    ReportDeliveryConfig report_delivery_config_;
+    TrackerConfig tracker_config_;
+    AnalyticsConfig analytics_config_;
 };
 
 } // namespace detector_service
@@ -1,28 +1,192 @@
 #include "database.h"
 #include "common_utils.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
 
 namespace detector_service {
 
+namespace {
+
+// 单个事务最多合并的报警写入数
+constexpr size_t kAlertBatchSize = 256;
+// 合并写入时最多等待的时间
+constexpr std::chrono::milliseconds kAlertBatchWindow(20);
+// 写入事务失败后的重试间隔（逐次加倍，直到上限）
+constexpr std::chrono::milliseconds kAlertRetryBase(50);
+constexpr std::chrono::milliseconds kAlertRetryMax(5000);
+// 服务停止时事务仍失败的最多重试次数，超过后丢弃剩余写入
+constexpr int kAlertShutdownRetries = 5;
+// 只读连接数（HTTP API 查询并发上限）
+constexpr size_t kReaderConnections = 4;
+// 批量更新时 IN 列表的固定长度（SQL 文本固定，预编译语句可以缓存复用）
+constexpr size_t kInListChunk = 64;
+
+// 报警查询列，顺序与 readAlertRow 一致
+constexpr const char* kAlertColumns =
+    "id, channel_id, channel_name, alert_type, alert_rule_id, alert_rule_name, image_path, "
+    "confidence, detected_objects, bbox_x, bbox_y, bbox_w, bbox_h, report_status, report_url, "
+    "created_at, created_ts, thumbnail_path, image_cropped";
+
+// 稍后重试可能成功的错误（相对于约束冲突等与数据本身有关的错误）
+bool isTransientError(int rc) {
+    switch (rc & 0xff) {
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+        case SQLITE_IOERR:
+        case SQLITE_FULL:
+        case SQLITE_NOMEM:
+        case SQLITE_CANTOPEN:
+        case SQLITE_PROTOCOL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string columnText(sqlite3_stmt* stmt, int index) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, index));
+    return text ? text : "";
+}
+
+// 按 kInListChunk 分块执行以 "IN (?, ...)" 结尾的语句，最后一块不足时重复最后一个ID补齐
+// bind_prefix 绑定 IN 列表之前的参数，返回下一个参数序号
+bool execInChunks(SqliteConnection& conn, const std::string& sql_prefix, const std::vector<int>& ids,
+                  const std::function<int(sqlite3_stmt*)>& bind_prefix) {
+    static const std::string in_list = [] {
+        std::string list = "(";
+        for (size_t i = 0; i < kInListChunk; ++i) {
+            list += i == 0 ? "?" : ", ?";
+        }
+        return list + ")";
+    }();
+
+    auto stmt = conn.prepare(sql_prefix + " IN " + in_list);
+    if (!stmt) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t begin = 0; begin < ids.size(); begin += kInListChunk) {
+        int index = bind_prefix(stmt);
+        for (size_t i = 0; i < kInListChunk; ++i) {
+            sqlite3_bind_int(stmt, index++, ids[std::min(begin + i, ids.size() - 1)]);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            ok = false;
+        }
+        sqlite3_reset(stmt);
+    }
+    return ok;
+}
+
+AlertRecord readAlertRow(sqlite3_stmt* stmt) {
+    AlertRecord alert;
+    alert.id = sqlite3_column_int(stmt, 0);
+    alert.channel_id = sqlite3_column_int(stmt, 1);
+    alert.channel_name = columnText(stmt, 2);
+    alert.alert_type = columnText(stmt, 3);
+    alert.alert_rule_id = sqlite3_column_int(stmt, 4);
+    alert.alert_rule_name = columnText(stmt, 5);
+    alert.image_path = columnText(stmt, 6);
+    alert.confidence = static_cast<float>(sqlite3_column_double(stmt, 7));
+    alert.detected_objects = columnText(stmt, 8);
+    alert.bbox_x = sqlite3_column_double(stmt, 9);
+    alert.bbox_y = sqlite3_column_double(stmt, 10);
+    alert.bbox_w = sqlite3_column_double(stmt, 11);
+    alert.bbox_h = sqlite3_column_double(stmt, 12);
+    alert.report_status = columnText(stmt, 13);
+    if (alert.report_status.empty()) {
+        alert.report_status = "pending";
+    }
+    alert.report_url = columnText(stmt, 14);
+    alert.created_at = columnText(stmt, 15);
+    alert.created_ts = sqlite3_column_int64(stmt, 16);
+    alert.thumbnail_path = columnText(stmt, 17);
+    alert.image_cropped = sqlite3_column_int(stmt, 18) != 0;
+    return alert;
+}
+
+} // namespace
+
 bool Database::initialize(const std::string& db_path) {
-    if (db_ != nullptr) {
+    if (writer_) {
         close();
     }
 
-    int rc = sqlite3_open(db_path.c_str(), &db_);
-    if (rc != SQLITE_OK) {
-        std::cerr << "无法打开数据库: " << sqlite3_errmsg(db_) << std::endl;
+    // 先打开写连接：创建数据库文件、切换 WAL 并建表，之后只读连接才能打开
+    // 新建的数据库启用增量回收，过期报警删除后可以分批归还磁盘空间
+    writer_ = SqliteConnection::open(db_path, false, true);
+    if (!writer_) {
         return false;
     }
 
-    return createTables();
+    if (!createTables()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(readers_mutex_);
+        for (size_t i = 0; i < kReaderConnections; ++i) {
+            auto reader = SqliteConnection::open(db_path, true);
+            if (!reader) {
+                return false;
+            }
+            idle_readers_.push_back(reader.get());
+            readers_.push_back(std::move(reader));
+        }
+    }
+
+    return startAlertWriter();
 }
 
 void Database::close() {
-    if (db_ != nullptr) {
-        sqlite3_close(db_);
-        db_ = nullptr;
+    stopAlertWriter();
+
+    // 关闭时不应再有租出的连接
+    {
+        std::lock_guard<std::mutex> lock(readers_mutex_);
+        idle_readers_.clear();
+        readers_.clear();
     }
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_.reset();
+}
+
+Database::ConnectionLease Database::acquireReader() {
+    std::unique_lock<std::mutex> lock(readers_mutex_);
+    if (readers_.empty()) {
+        return ConnectionLease(this, nullptr, false);
+    }
+    readers_cv_.wait(lock, [this] { return !idle_readers_.empty(); });
+    SqliteConnection* conn = idle_readers_.back();
+    idle_readers_.pop_back();
+    return ConnectionLease(this, conn, false);
+}
+
+Database::ConnectionLease Database::acquireWriter() {
+    writer_mutex_.lock();
+    if (!writer_) {
+        writer_mutex_.unlock();
+        return ConnectionLease(this, nullptr, true);
+    }
+    return ConnectionLease(this, writer_.get(), true);
+}
+
+void Database::releaseConnection(SqliteConnection* conn, bool writer) {
+    if (writer) {
+        writer_mutex_.unlock();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(readers_mutex_);
+        idle_readers_.push_back(conn);
+    }
+    readers_cv_.notify_one();
 }
 
 bool Database::createTables() {
@@ -43,7 +207,17 @@ bool Database::createTables() {
             bbox_h REAL,
             report_status TEXT NOT NULL DEFAULT 'pending',
             report_url TEXT NOT NULL DEFAULT '',
-            created_at TEXT NOT NULL
+            created_at TEXT NOT NULL,
+            created_ts INTEGER NOT NULL DEFAULT 0,
+            thumbnail_path TEXT NOT NULL DEFAULT '',
+            image_cropped INTEGER NOT NULL DEFAULT 0
+        );
+
+        CREATE TABLE IF NOT EXISTS report_outbox (
+            alert_id INTEGER PRIMARY KEY,
+            attempts INTEGER NOT NULL DEFAULT 0,
+            next_attempt_ms INTEGER NOT NULL DEFAULT 0,
+            last_error TEXT NOT NULL DEFAULT ''
         );
 
         CREATE TABLE IF NOT EXISTS channels (
@@ -71,9 +245,6 @@ bool Database::createTables() {
             updated_at TEXT NOT NULL
         );
 
-        CREATE INDEX IF NOT EXISTS idx_channel_id ON alerts(channel_id);
-        CREATE INDEX IF NOT EXISTS idx_created_at ON alerts(created_at);
-
         CREATE TABLE IF NOT EXISTS gb28181_config (
             id INTEGER PRIMARY KEY CHECK (id = 1),
             enabled INTEGER NOT NULL DEFAULT 0,
@@ -113,10 +284,28 @@ bool Database::createTables() {
             updated_at TEXT NOT NULL,
             FOREIGN KEY (channel_id) REFERENCES channels(id) ON DELETE CASCADE
         );
+
+        CREATE TABLE IF NOT EXISTS analytics_minutes (
+            channel_id INTEGER NOT NULL,
+            minute_ts INTEGER NOT NULL,
+            roi_id INTEGER NOT NULL,
+            entries INTEGER NOT NULL DEFAULT 0,
+            exits INTEGER NOT NULL DEFAULT 0,
+            max_occupancy INTEGER NOT NULL DEFAULT 0,
+            occupancy_sum INTEGER NOT NULL DEFAULT 0,
+            samples INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (channel_id, minute_ts, roi_id)
+        ) WITHOUT ROWID;
     )";
 
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    sqlite3* db = conn->handle();
+
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err_msg);
     
     if (rc != SQLITE_OK) {
         std::cerr << "创建表失败: " << err_msg << std::endl;
@@ -124,119 +313,381 @@ bool Database::createTables() {
         return false;
     }
 
-    // 为现有数据库添加report_enabled字段（如果不存在）
-    const char* alter_report_sql = "ALTER TABLE channels ADD COLUMN report_enabled INTEGER NOT NULL DEFAULT 0";
-    err_msg = nullptr;
-    rc = sqlite3_exec(db_, alter_report_sql, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK && err_msg) {
-        std::string error_str = err_msg;
-        if (error_str.find("duplicate column name") == std::string::npos) {
-            std::cerr << "添加report_enabled字段失败: " << err_msg << std::endl;
-        }
-        sqlite3_free(err_msg);
-    }
-
-    // 为现有数据库添加report_status字段（如果不存在）
+    // 为现有数据库添加字段（如果不存在）
     // 注意：SQLite不支持直接删除列，所以如果image_data列存在，我们保留它但不使用
-    const char* alter_report_status_sql = "ALTER TABLE alerts ADD COLUMN report_status TEXT NOT NULL DEFAULT 'pending'";
-    err_msg = nullptr;
-    rc = sqlite3_exec(db_, alter_report_status_sql, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK && err_msg) {
-        std::string error_str = err_msg;
-        if (error_str.find("duplicate column name") == std::string::npos) {
-            std::cerr << "添加report_status字段失败: " << err_msg << std::endl;
+    auto addColumn = [db](const char* table, const char* column_def, const char* column_name) {
+        std::string alter_sql = std::string("ALTER TABLE ") + table + " ADD COLUMN " + column_def;
+        char* alter_err = nullptr;
+        int alter_rc = sqlite3_exec(db, alter_sql.c_str(), nullptr, nullptr, &alter_err);
+        if (alter_rc != SQLITE_OK && alter_err) {
+            std::string error_str = alter_err;
+            if (error_str.find("duplicate column name") == std::string::npos) {
+                std::cerr << "添加" << column_name << "字段失败: " << alter_err << std::endl;
+            }
+            sqlite3_free(alter_err);
         }
-        sqlite3_free(err_msg);
-    }
+    };
+    addColumn("channels", "report_enabled INTEGER NOT NULL DEFAULT 0", "report_enabled");
+    addColumn("alerts", "alert_rule_id INTEGER NOT NULL DEFAULT 0", "alert_rule_id");
+    addColumn("alerts", "alert_rule_name TEXT NOT NULL DEFAULT ''", "alert_rule_name");
+    addColumn("alerts", "report_status TEXT NOT NULL DEFAULT 'pending'", "report_status");
+    addColumn("alerts", "report_url TEXT NOT NULL DEFAULT ''", "report_url");
+    addColumn("alerts", "created_ts INTEGER NOT NULL DEFAULT 0", "created_ts");
+    addColumn("alerts", "thumbnail_path TEXT NOT NULL DEFAULT ''", "thumbnail_path");
+    addColumn("alerts", "image_cropped INTEGER NOT NULL DEFAULT 0", "image_cropped");
+    addColumn("gb28181_config", "sip_transport TEXT NOT NULL DEFAULT 'UDP'", "sip_transport");
+
+    // 报警列表索引和计数
+    // 列表按 (created_ts, id) 倒序游标翻页，created_ts 为 Unix 秒，比较和排序不再依赖 TEXT 时间
+    // 报警数由触发器维护在 alert_counters 中，计数查询不再扫描全表
+    const char* alert_index_sql = R"(
+        DROP INDEX IF EXISTS idx_channel_id;
+        DROP INDEX IF EXISTS idx_created_at;
+        CREATE INDEX IF NOT EXISTS idx_alerts_created ON alerts(created_ts, id);
+        CREATE INDEX IF NOT EXISTS idx_alerts_channel_created ON alerts(channel_id, created_ts, id);
+        DROP INDEX IF EXISTS idx_alerts_report_status;
+        CREATE INDEX IF NOT EXISTS idx_alerts_report_pending ON alerts(id) WHERE report_status = 'pending';
+        CREATE INDEX IF NOT EXISTS idx_alerts_report_failed ON alerts(id) WHERE report_status = 'failed';
+
+        UPDATE alerts SET created_ts = COALESCE(CAST(strftime('%s', created_at, 'utc') AS INTEGER), 0)
+        WHERE created_ts = 0;
+
+        CREATE TABLE IF NOT EXISTS alert_counters (
+            channel_id INTEGER PRIMARY KEY,
+            count INTEGER NOT NULL DEFAULT 0
+        );
 
-    // 为现有数据库添加report_url字段（如果不存在）
-    const char* alter_report_url_sql = "ALTER TABLE alerts ADD COLUMN report_url TEXT NOT NULL DEFAULT ''";
+        CREATE TRIGGER IF NOT EXISTS trg_alert_counters_insert AFTER INSERT ON alerts
+        BEGIN
+            INSERT OR IGNORE INTO alert_counters (channel_id, count) VALUES (NEW.channel_id, 0);
+            UPDATE alert_counters SET count = count + 1 WHERE channel_id = NEW.channel_id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS trg_alert_counters_delete AFTER DELETE ON alerts
+        BEGIN
+            UPDATE alert_counters SET count = count - 1 WHERE channel_id = OLD.channel_id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS trg_alert_counters_move AFTER UPDATE OF channel_id ON alerts
+        WHEN NEW.channel_id != OLD.channel_id
+        BEGIN
+            UPDATE alert_counters SET count = count - 1 WHERE channel_id = OLD.channel_id;
+            INSERT OR IGNORE INTO alert_counters (channel_id, count) VALUES (NEW.channel_id, 0);
+            UPDATE alert_counters SET count = count + 1 WHERE channel_id = NEW.channel_id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS trg_report_outbox_alert_delete AFTER DELETE ON alerts
+        BEGIN
+            DELETE FROM report_outbox WHERE alert_id = OLD.id;
+        END;
+    )";
     err_msg = nullptr;
-    rc = sqlite3_exec(db_, alter_report_url_sql, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK && err_msg) {
-        std::string error_str = err_msg;
-        if (error_str.find("duplicate column name") == std::string::npos) {
-            std::cerr << "添加report_url字段失败: " << err_msg << std::endl;
-        }
+    rc = sqlite3_exec(db, alert_index_sql, nullptr, nullptr, &err_msg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "创建报警索引失败: " << (err_msg ? err_msg : "") << std::endl;
         sqlite3_free(err_msg);
+        return false;
     }
 
-    // 为现有数据库添加sip_transport字段（如果不存在）
-    const char* alter_sip_transport_sql = "ALTER TABLE gb28181_config ADD COLUMN sip_transport TEXT NOT NULL DEFAULT 'UDP'";
+    // 计数表为空时（首次升级）按现有报警重建一次
+    const char* rebuild_counters_sql = R"(
+        INSERT INTO alert_counters (channel_id, count)
+        SELECT channel_id, COUNT(*) FROM alerts
+        WHERE NOT EXISTS (SELECT 1 FROM alert_counters)
+        GROUP BY channel_id
+    )";
     err_msg = nullptr;
-    rc = sqlite3_exec(db_, alter_sip_transport_sql, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK && err_msg) {
-        std::string error_str = err_msg;
-        if (error_str.find("duplicate column name") == std::string::npos) {
-            std::cerr << "添加sip_transport字段失败: " << err_msg << std::endl;
-        }
+    rc = sqlite3_exec(db, rebuild_counters_sql, nullptr, nullptr, &err_msg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "重建报警计数失败: " << (err_msg ? err_msg : "") << std::endl;
         sqlite3_free(err_msg);
+        return false;
     }
 
     return true;
 }
 
 int Database::insertAlert(const AlertRecord& alert) {
-    const char* sql = R"(
+    PendingAlertWrite write;
+    write.kind = PendingAlertWrite::Kind::INSERT_ALERT;
+    write.alert = alert;
+    write.alert.id = next_alert_id_.fetch_add(1);
+    if (write.alert.report_status.empty()) {
+        write.alert.report_status = "pending";
+    }
+    if (write.alert.created_at.empty()) {
+        write.alert.created_at = getCurrentTime();
+    }
+    if (write.alert.created_ts == 0) {
+        write.alert.created_ts = static_cast<int64_t>(std::time(nullptr));
+    }
+    // 图片数据不入库，不随写入队列保留
+    write.alert.image_jpeg.reset();
+    write.alert.thumbnail_jpeg.reset();
+
+    int alert_id = write.alert.id;
+    enqueueAlertWrite(std::move(write));
+    return alert_id;
+}
+
+bool Database::startAlertWriter() {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+
+    // 报警ID由写入线程预分配，从自增序列和现有最大ID中较大者之后开始
+    const char* max_id_sql = R"(
+        SELECT MAX(COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'alerts'), 0),
+                   COALESCE((SELECT MAX(id) FROM alerts), 0))
+    )";
+    auto stmt = conn->prepare(max_id_sql);
+    if (!stmt) {
+        return false;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        next_alert_id_ = sqlite3_column_int(stmt, 0) + 1;
+    }
+
+    alert_writer_running_ = true;
+    alert_writer_thread_ = std::thread(&Database::alertWriterWorker, this);
+    return true;
+}
+
+void Database::stopAlertWriter() {
+    // 停止写入线程（退出前写完队列中剩余的报警）
+    {
+        std::lock_guard<std::mutex> lock(alert_write_mutex_);
+        alert_writer_running_ = false;
+    }
+    alert_write_cv_.notify_all();
+
+    if (alert_writer_thread_.joinable()) {
+        alert_writer_thread_.join();
+    }
+}
+
+void Database::enqueueAlertWrite(PendingAlertWrite write) {
+    {
+        std::lock_guard<std::mutex> lock(alert_write_mutex_);
+        alert_write_queue_.push_back(std::move(write));
+        alert_writes_in_flight_++;
+    }
+    alert_write_cv_.notify_one();
+}
+
+void Database::flushAlertWrites() {
+    std::unique_lock<std::mutex> lock(alert_write_mutex_);
+    alert_write_done_cv_.wait(lock, [this] { return alert_writes_in_flight_ == 0; });
+}
+
+void Database::alertWriterWorker() {
+    std::vector<PendingAlertWrite> batch;
+    auto retry_delay = kAlertRetryBase;
+    int shutdown_retries = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(alert_write_mutex_);
+            alert_write_cv_.wait(lock, [this] {
+                return !alert_writer_running_ || !alert_write_queue_.empty();
+            });
+            if (alert_write_queue_.empty()) {
+                break;  // 已停止且队列为空
+            }
+
+            // 短暂等待后续写入，合并到同一事务中提交
+            if (alert_writer_running_ && alert_write_queue_.size() < kAlertBatchSize) {
+                alert_write_cv_.wait_for(lock, kAlertBatchWindow, [this] {
+                    return !alert_writer_running_ || alert_write_queue_.size() >= kAlertBatchSize;
+                });
+            }
+
+            size_t count = std::min(alert_write_queue_.size(), kAlertBatchSize);
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(alert_write_queue_.front()));
+                alert_write_queue_.pop_front();
+            }
+        }
+
+        if (writeAlertBatch(batch)) {
+            retry_delay = kAlertRetryBase;
+        } else {
+            // 报警ID已返回给调用方、上报也可能已加入发件箱，事务失败时整批放回队首，退避后按原顺序重试
+            std::unique_lock<std::mutex> lock(alert_write_mutex_);
+            if (alert_writer_running_ || ++shutdown_retries <= kAlertShutdownRetries) {
+                for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+                    alert_write_queue_.push_front(std::move(*it));
+                }
+                batch.clear();
+                if (alert_writer_running_) {
+                    alert_write_cv_.wait_for(lock, retry_delay, [this] { return !alert_writer_running_; });
+                } else {
+                    lock.unlock();
+                    std::this_thread::sleep_for(retry_delay);
+                }
+                retry_delay = std::min(retry_delay * 2, kAlertRetryMax);
+                continue;
+            }
+            std::cerr << "服务停止时报警写入仍失败，丢弃 " << batch.size() << " 条写入" << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(alert_write_mutex_);
+            alert_writes_in_flight_ -= batch.size();
+        }
+        alert_write_done_cv_.notify_all();
+        batch.clear();
+    }
+}
+
+bool Database::writeAlertBatch(std::vector<PendingAlertWrite>& batch) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return true;  // 数据库已关闭
+    }
+
+    if (!conn->exec("BEGIN IMMEDIATE")) {
+        std::cerr << "开始事务失败，" << batch.size() << " 条报警写入稍后重试" << std::endl;
+        return false;
+    }
+    auto rollback = [&conn](const char* what) {
+        std::cerr << what << ": " << conn->errmsg() << "，回滚后重试" << std::endl;
+        conn->exec("ROLLBACK");
+        return false;
+    };
+
+    const char* insert_sql = R"(
         INSERT INTO alerts (
-            channel_id, channel_name, alert_type, alert_rule_id, alert_rule_name,
+            id, channel_id, channel_name, alert_type, alert_rule_id, alert_rule_name,
             image_path, confidence, detected_objects, 
-            bbox_x, bbox_y, bbox_w, bbox_h, report_status, report_url, created_at
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+            bbox_x, bbox_y, bbox_w, bbox_h, report_status, report_url, created_at, created_ts,
+            thumbnail_path, image_cropped
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )";
+    const char* put_outbox_sql = R"(
+        INSERT OR REPLACE INTO report_outbox (alert_id, attempts, next_attempt_ms, last_error)
+        VALUES (?, ?, ?, ?)
     )";
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
-        return -1;
+    // 插入按顺序执行；上报状态和发件箱操作在插入之后执行，同一报警只保留本批次中的最后一次，
+    // 上报状态按相同取值合并为一条 "WHERE id IN (...)"，上报端恢复时积压的结果不再逐条 UPDATE
+    using Kind = PendingAlertWrite::Kind;
+    std::unordered_map<int, const PendingAlertWrite*> final_status;
+    std::unordered_map<int, const PendingAlertWrite*> final_outbox;
+    std::unordered_set<int> rejected;  // 因数据本身无法插入的报警，其上报状态和发件箱操作一并跳过
+    for (const auto& write : batch) {
+        if (write.kind == Kind::REPORT_STATUS) {
+            final_status[write.alert.id] = &write;
+            continue;
+        }
+        if (write.kind != Kind::INSERT_ALERT) {
+            final_outbox[write.outbox.alert_id] = &write;
+            continue;
+        }
+
+        const AlertRecord& alert = write.alert;
+        auto stmt = conn->prepare(insert_sql);
+        if (!stmt) {
+            return rollback("准备插入语句失败");
+        }
+        sqlite3_bind_int(stmt, 1, alert.id);
+        sqlite3_bind_int(stmt, 2, alert.channel_id);
+        sqlite3_bind_text(stmt, 3, alert.channel_name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, alert.alert_type.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 5, alert.alert_rule_id);
+        sqlite3_bind_text(stmt, 6, alert.alert_rule_name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 7, alert.image_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 8, alert.confidence);
+        sqlite3_bind_text(stmt, 9, alert.detected_objects.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 10, alert.bbox_x);
+        sqlite3_bind_double(stmt, 11, alert.bbox_y);
+        sqlite3_bind_double(stmt, 12, alert.bbox_w);
+        sqlite3_bind_double(stmt, 13, alert.bbox_h);
+        sqlite3_bind_text(stmt, 14, alert.report_status.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 15, alert.report_url.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 16, alert.created_at.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 17, alert.created_ts);
+        sqlite3_bind_text(stmt, 18, alert.thumbnail_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 19, alert.image_cropped ? 1 : 0);
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            if (isTransientError(rc)) {
+                return rollback("插入报警失败");
+            }
+            std::cerr << "插入失败: " << conn->errmsg() << " (报警 " << alert.id << ")" << std::endl;
+            rejected.insert(alert.id);
+        }
     }
 
-    sqlite3_bind_int(stmt, 1, alert.channel_id);
-    sqlite3_bind_text(stmt, 2, alert.channel_name.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, alert.alert_type.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 4, alert.alert_rule_id);
-    sqlite3_bind_text(stmt, 5, alert.alert_rule_name.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 6, alert.image_path.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 7, alert.confidence);
-    sqlite3_bind_text(stmt, 8, alert.detected_objects.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 9, alert.bbox_x);
-    sqlite3_bind_double(stmt, 10, alert.bbox_y);
-    sqlite3_bind_double(stmt, 11, alert.bbox_w);
-    sqlite3_bind_double(stmt, 12, alert.bbox_h);
-    
-    std::string report_status = alert.report_status.empty() ? "pending" : alert.report_status;
-    sqlite3_bind_text(stmt, 13, report_status.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 14, alert.report_url.c_str(), -1, SQLITE_STATIC);
-    
-    std::string created_at = alert.created_at.empty() ? getCurrentTime() : alert.created_at;
-    sqlite3_bind_text(stmt, 15, created_at.c_str(), -1, SQLITE_STATIC);
+    std::map<std::pair<std::string, std::string>, std::vector<int>> status_groups;
+    for (const auto& pair : final_status) {
+        if (rejected.count(pair.first) > 0) {
+            continue;
+        }
+        const AlertRecord& alert = pair.second->alert;
+        status_groups[{alert.report_status, alert.report_url}].push_back(pair.first);
+    }
+    for (const auto& group : status_groups) {
+        const auto& status = group.first;
+        bool ok = execInChunks(*conn, "UPDATE alerts SET report_status = ?, report_url = ? WHERE id",
+                               group.second, [&status](sqlite3_stmt* stmt) {
+            sqlite3_bind_text(stmt, 1, status.first.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, status.second.c_str(), -1, SQLITE_STATIC);
+            return 3;
+        });
+        if (!ok) {
+            return rollback("更新上报状态失败");
+        }
+    }
 
-    rc = sqlite3_step(stmt);
-    int alert_id = -1;
-    
-    if (rc == SQLITE_DONE) {
-        alert_id = sqlite3_last_insert_rowid(db_);
-    } else {
-        std::cerr << "插入失败: " << sqlite3_errmsg(db_) << std::endl;
+    std::vector<int> removed_outbox;
+    for (const auto& pair : final_outbox) {
+        const ReportOutboxEntry& outbox = pair.second->outbox;
+        if (rejected.count(pair.first) > 0) {
+            continue;
+        }
+        if (pair.second->kind == Kind::REMOVE_OUTBOX) {
+            removed_outbox.push_back(outbox.alert_id);
+            continue;
+        }
+        auto stmt = conn->prepare(put_outbox_sql);
+        if (!stmt) {
+            return rollback("准备发件箱语句失败");
+        }
+        sqlite3_bind_int(stmt, 1, outbox.alert_id);
+        sqlite3_bind_int(stmt, 2, outbox.attempts);
+        sqlite3_bind_int64(stmt, 3, outbox.next_attempt_ms);
+        sqlite3_bind_text(stmt, 4, outbox.last_error.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            return rollback("写入上报发件箱失败");
+        }
+    }
+    if (!removed_outbox.empty() &&
+        !execInChunks(*conn, "DELETE FROM report_outbox WHERE alert_id", removed_outbox,
+                      [](sqlite3_stmt*) { return 1; })) {
+        return rollback("删除上报发件箱条目失败");
     }
 
-    sqlite3_finalize(stmt);
-    return alert_id;
+    if (!conn->exec("COMMIT")) {
+        return rollback("提交事务失败");
+    }
+    return true;
 }
 
 bool Database::deleteAlert(int alert_id) {
     const char* sql = "DELETE FROM alerts WHERE id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
     sqlite3_bind_int(stmt, 1, alert_id);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -244,222 +695,194 @@ bool Database::deleteAlert(int alert_id) {
 bool Database::deleteAlertsByChannel(int channel_id) {
     const char* sql = "DELETE FROM alerts WHERE channel_id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
     sqlite3_bind_int(stmt, 1, channel_id);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
 
     return rc == SQLITE_DONE;
 }
 
 std::vector<AlertRecord> Database::getAlerts(int limit, int offset) {
-    std::vector<AlertRecord> alerts;
-    const char* sql = "SELECT * FROM alerts ORDER BY created_at DESC LIMIT ? OFFSET ?";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return alerts;
-    }
+    std::string sql = std::string("SELECT ") + kAlertColumns +
+                      " FROM alerts ORDER BY created_ts DESC, id DESC LIMIT ? OFFSET ?";
+    return queryAlerts(sql, [limit, offset](sqlite3_stmt* stmt) {
+        sqlite3_bind_int(stmt, 1, limit);
+        sqlite3_bind_int(stmt, 2, offset);
+    });
+}
 
-    sqlite3_bind_int(stmt, 1, limit);
-    sqlite3_bind_int(stmt, 2, offset);
+std::vector<AlertRecord> Database::getAlertsByChannel(int channel_id, int limit, int offset) {
+    std::string sql = std::string("SELECT ") + kAlertColumns +
+                      " FROM alerts WHERE channel_id = ? ORDER BY created_ts DESC, id DESC LIMIT ? OFFSET ?";
+    return queryAlerts(sql, [channel_id, limit, offset](sqlite3_stmt* stmt) {
+        sqlite3_bind_int(stmt, 1, channel_id);
+        sqlite3_bind_int(stmt, 2, limit);
+        sqlite3_bind_int(stmt, 3, offset);
+    });
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        AlertRecord alert;
-        int col_count = sqlite3_column_count(stmt);
-        alert.id = sqlite3_column_int(stmt, 0);
-        alert.channel_id = sqlite3_column_int(stmt, 1);
-        alert.channel_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        alert.alert_type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        // 兼容新旧数据库结构
-        if (col_count > 4) {
-            alert.alert_rule_id = sqlite3_column_int(stmt, 4);
-            if (col_count > 5) {
-                const char* rule_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-                alert.alert_rule_name = rule_name ? rule_name : "";
-            }
-        }
-        int offset = (col_count > 5) ? 6 : 4;
-        alert.image_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset));
-        alert.confidence = sqlite3_column_double(stmt, offset + 1);
-        alert.detected_objects = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 2));
-        alert.bbox_x = sqlite3_column_double(stmt, offset + 3);
-        alert.bbox_y = sqlite3_column_double(stmt, offset + 4);
-        alert.bbox_w = sqlite3_column_double(stmt, offset + 5);
-        alert.bbox_h = sqlite3_column_double(stmt, offset + 6);
-        
-        // 兼容新旧数据库结构：检查是否有 report_status 和 report_url 字段
-        if (col_count > offset + 7) {
-            const char* report_status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 7));
-            alert.report_status = report_status ? report_status : "pending";
-        } else {
-            alert.report_status = "pending";
-        }
-        if (col_count > offset + 8) {
-            const char* report_url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 8));
-            alert.report_url = report_url ? report_url : "";
-        } else {
-            alert.report_url = "";
-        }
-        
-        alert.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + (col_count > offset + 8 ? 9 : 8)));
-        
-        alerts.push_back(alert);
+std::vector<AlertRecord> Database::getAlertsPage(const AlertCursor& cursor, int limit, int channel_id) {
+    // 从游标位置沿 (created_ts, id) 索引继续读取，翻页深度不影响查询耗时
+    std::string sql = std::string("SELECT ") + kAlertColumns + " FROM alerts";
+    std::vector<std::string> conditions;
+    if (channel_id > 0) {
+        conditions.push_back("channel_id = ?");
+    }
+    if (cursor.valid()) {
+        conditions.push_back("(created_ts, id) < (?, ?)");
+    }
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        sql += (i == 0 ? " WHERE " : " AND ") + conditions[i];
     }
+    sql += " ORDER BY created_ts DESC, id DESC LIMIT ?";
 
-    sqlite3_finalize(stmt);
-    return alerts;
+    return queryAlerts(sql, [&cursor, limit, channel_id](sqlite3_stmt* stmt) {
+        int index = 1;
+        if (channel_id > 0) {
+            sqlite3_bind_int(stmt, index++, channel_id);
+        }
+        if (cursor.valid()) {
+            sqlite3_bind_int64(stmt, index++, cursor.created_ts);
+            sqlite3_bind_int(stmt, index++, cursor.id);
+        }
+        sqlite3_bind_int(stmt, index, limit);
+    });
 }
 
-std::vector<AlertRecord> Database::getAlertsByChannel(int channel_id, int limit, int offset) {
+std::vector<AlertRecord> Database::queryAlerts(const std::string& sql, const std::function<void(sqlite3_stmt*)>& bind) {
     std::vector<AlertRecord> alerts;
-    const char* sql = "SELECT * FROM alerts WHERE channel_id = ? ORDER BY created_at DESC LIMIT ? OFFSET ?";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+
+    auto conn = acquireReader();
+    if (!conn) {
+        return alerts;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return alerts;
     }
 
-    sqlite3_bind_int(stmt, 1, channel_id);
-    sqlite3_bind_int(stmt, 2, limit);
-    sqlite3_bind_int(stmt, 3, offset);
-
+    bind(stmt);
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        AlertRecord alert;
-        int col_count = sqlite3_column_count(stmt);
-        alert.id = sqlite3_column_int(stmt, 0);
-        alert.channel_id = sqlite3_column_int(stmt, 1);
-        alert.channel_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        alert.alert_type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        // 兼容新旧数据库结构
-        if (col_count > 4) {
-            alert.alert_rule_id = sqlite3_column_int(stmt, 4);
-            if (col_count > 5) {
-                const char* rule_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-                alert.alert_rule_name = rule_name ? rule_name : "";
-            }
-        }
-        int offset = (col_count > 5) ? 6 : 4;
-        alert.image_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset));
-        alert.confidence = sqlite3_column_double(stmt, offset + 1);
-        alert.detected_objects = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 2));
-        alert.bbox_x = sqlite3_column_double(stmt, offset + 3);
-        alert.bbox_y = sqlite3_column_double(stmt, offset + 4);
-        alert.bbox_w = sqlite3_column_double(stmt, offset + 5);
-        alert.bbox_h = sqlite3_column_double(stmt, offset + 6);
-        
-        // 兼容新旧数据库结构：检查是否有 report_status 和 report_url 字段
-        if (col_count > offset + 7) {
-            const char* report_status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 7));
-            alert.report_status = report_status ? report_status : "pending";
-        } else {
-            alert.report_status = "pending";
-        }
-        if (col_count > offset + 8) {
-            const char* report_url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 8));
-            alert.report_url = report_url ? report_url : "";
-        } else {
-            alert.report_url = "";
-        }
-        
-        alert.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + (col_count > offset + 8 ? 9 : 8)));
-        
-        alerts.push_back(alert);
+        alerts.push_back(readAlertRow(stmt));
     }
 
-    sqlite3_finalize(stmt);
     return alerts;
 }
 
 AlertRecord Database::getAlert(int alert_id) {
-    AlertRecord alert;
-    const char* sql = "SELECT * FROM alerts WHERE id = ?";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return alert;
-    }
+    std::string sql = std::string("SELECT ") + kAlertColumns + " FROM alerts WHERE id = ?";
+    auto alerts = queryAlerts(sql, [alert_id](sqlite3_stmt* stmt) {
+        sqlite3_bind_int(stmt, 1, alert_id);
+    });
+    return alerts.empty() ? AlertRecord() : alerts.front();
+}
 
-    sqlite3_bind_int(stmt, 1, alert_id);
+bool Database::updateAlertReportStatus(int alert_id, const std::string& report_status, const std::string& report_url) {
+    // 与插入走同一写入队列，保证在报警插入之后执行
+    PendingAlertWrite write;
+    write.kind = PendingAlertWrite::Kind::REPORT_STATUS;
+    write.alert.id = alert_id;
+    write.alert.report_status = report_status;
+    write.alert.report_url = report_url;
+    enqueueAlertWrite(std::move(write));
+    return true;
+}
 
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        int col_count = sqlite3_column_count(stmt);
-        alert.id = sqlite3_column_int(stmt, 0);
-        alert.channel_id = sqlite3_column_int(stmt, 1);
-        alert.channel_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        alert.alert_type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        // 兼容新旧数据库结构
-        if (col_count > 4) {
-            alert.alert_rule_id = sqlite3_column_int(stmt, 4);
-            if (col_count > 5) {
-                const char* rule_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-                alert.alert_rule_name = rule_name ? rule_name : "";
-            }
-        }
-        int offset = (col_count > 5) ? 6 : 4;
-        alert.image_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset));
-        alert.confidence = sqlite3_column_double(stmt, offset + 1);
-        alert.detected_objects = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 2));
-        alert.bbox_x = sqlite3_column_double(stmt, offset + 3);
-        alert.bbox_y = sqlite3_column_double(stmt, offset + 4);
-        alert.bbox_w = sqlite3_column_double(stmt, offset + 5);
-        alert.bbox_h = sqlite3_column_double(stmt, offset + 6);
-        
-        // 兼容新旧数据库结构：检查是否有 report_status 和 report_url 字段
-        if (col_count > offset + 7) {
-            const char* report_status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 7));
-            alert.report_status = report_status ? report_status : "pending";
-        } else {
-            alert.report_status = "pending";
-        }
-        if (col_count > offset + 8) {
-            const char* report_url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + 8));
-            alert.report_url = report_url ? report_url : "";
-        } else {
-            alert.report_url = "";
-        }
-        
-        alert.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, offset + (col_count > offset + 8 ? 9 : 8)));
+void Database::putReportOutbox(const ReportOutboxEntry& entry) {
+    PendingAlertWrite write;
+    write.kind = PendingAlertWrite::Kind::PUT_OUTBOX;
+    write.outbox = entry;
+    enqueueAlertWrite(std::move(write));
+}
+
+void Database::removeReportOutbox(int alert_id) {
+    PendingAlertWrite write;
+    write.kind = PendingAlertWrite::Kind::REMOVE_OUTBOX;
+    write.outbox.alert_id = alert_id;
+    enqueueAlertWrite(std::move(write));
+}
+
+std::vector<ReportOutboxEntry> Database::loadReportOutbox() {
+    std::vector<ReportOutboxEntry> entries;
+    auto conn = acquireReader();
+    if (!conn) {
+        return entries;
+    }
+    auto stmt = conn->prepare(
+        "SELECT alert_id, attempts, next_attempt_ms, last_error FROM report_outbox ORDER BY next_attempt_ms");
+    if (!stmt) {
+        return entries;
     }
 
-    sqlite3_finalize(stmt);
-    return alert;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ReportOutboxEntry entry;
+        entry.alert_id = sqlite3_column_int(stmt, 0);
+        entry.attempts = sqlite3_column_int(stmt, 1);
+        entry.next_attempt_ms = sqlite3_column_int64(stmt, 2);
+        entry.last_error = columnText(stmt, 3);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
 }
 
-bool Database::updateAlertReportStatus(int alert_id, const std::string& report_status, const std::string& report_url) {
-    const char* sql = "UPDATE alerts SET report_status = ?, report_url = ? WHERE id = ?";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
-        return false;
+std::vector<AlertRecord> Database::getAlertsByReportStatus(const std::string& report_status, int before_id, int limit) {
+    // 状态写成字面量，与部分索引的 WHERE 条件完全一致，查询才能使用对应状态的部分索引
+    // （EXPLAIN QUERY PLAN: SEARCH alerts USING INDEX idx_alerts_report_failed (id<?)）
+    if (report_status != "pending" && report_status != "failed") {
+        return {};
+    }
+    std::string sql = std::string("SELECT ") + kAlertColumns + " FROM alerts WHERE report_status = '" +
+                      report_status + "'" + (before_id > 0 ? " AND id < ?" : "") + " ORDER BY id DESC LIMIT ?";
+    return queryAlerts(sql, [before_id, limit](sqlite3_stmt* stmt) {
+        int index = 1;
+        if (before_id > 0) {
+            sqlite3_bind_int(stmt, index++, before_id);
+        }
+        sqlite3_bind_int(stmt, index, limit);
+    });
+}
+
+int Database::getReportStatusCount(const std::string& report_status) {
+    if (report_status != "pending" && report_status != "failed") {
+        return 0;
     }
+    // 只扫描对应状态的部分索引（COVERING INDEX），不扫描全表
+    std::string sql = "SELECT COUNT(*) FROM alerts WHERE report_status = '" + report_status + "'";
 
-    sqlite3_bind_text(stmt, 1, report_status.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, report_url.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, alert_id);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    auto conn = acquireReader();
+    if (!conn) {
+        return 0;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
+        return 0;
+    }
 
-    return rc == SQLITE_DONE;
+    int count = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+
+    return count;
 }
 
 int Database::getAlertCount() {
-    const char* sql = "SELECT COUNT(*) FROM alerts";
+    const char* sql = "SELECT COALESCE(SUM(count), 0) FROM alert_counters";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return 0;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return 0;
     }
 
@@ -468,16 +891,18 @@ int Database::getAlertCount() {
         count = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
     return count;
 }
 
 int Database::getAlertCountByChannel(int channel_id) {
-    const char* sql = "SELECT COUNT(*) FROM alerts WHERE channel_id = ?";
+    const char* sql = "SELECT count FROM alert_counters WHERE channel_id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return 0;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return 0;
     }
 
@@ -487,24 +912,194 @@ int Database::getAlertCountByChannel(int channel_id) {
         count = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
     return count;
 }
 
-bool Database::cleanupOldAlerts(int days) {
-    const char* sql = "DELETE FROM alerts WHERE created_at < datetime('now', '-' || ? || ' days')";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+int Database::deleteAlertsBefore(int64_t cutoff_ts, int limit, std::vector<std::string>& image_paths) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return -1;
+    }
+
+    // 一批只删最早的 limit 条，事务很短，报警写入线程和其他写操作最多等待一个批次
+    if (!conn->exec("BEGIN IMMEDIATE")) {
+        return -1;
+    }
+
+    int deleted = 0;
+    int64_t last_ts = 0;
+    int last_id = 0;
+    {
+        auto stmt = conn->prepare(
+            "SELECT id, created_ts, image_path FROM alerts WHERE created_ts < ? ORDER BY created_ts, id LIMIT ?");
+        if (!stmt) {
+            conn->exec("ROLLBACK");
+            return -1;
+        }
+        sqlite3_bind_int64(stmt, 1, cutoff_ts);
+        sqlite3_bind_int(stmt, 2, limit);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            last_id = sqlite3_column_int(stmt, 0);
+            last_ts = sqlite3_column_int64(stmt, 1);
+            std::string image_path = columnText(stmt, 2);
+            if (!image_path.empty()) {
+                image_paths.push_back(std::move(image_path));
+            }
+            deleted++;
+        }
+    }
+
+    if (deleted > 0) {
+        // 按 (created_ts, id) 删除到本批最后一条为止，与上面读取的范围一致
+        auto stmt = conn->prepare("DELETE FROM alerts WHERE created_ts < ? AND (created_ts, id) <= (?, ?)");
+        if (!stmt) {
+            conn->exec("ROLLBACK");
+            return -1;
+        }
+        sqlite3_bind_int64(stmt, 1, cutoff_ts);
+        sqlite3_bind_int64(stmt, 2, last_ts);
+        sqlite3_bind_int(stmt, 3, last_id);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "删除过期报警失败: " << conn->errmsg() << std::endl;
+            conn->exec("ROLLBACK");
+            return -1;
+        }
+    }
+
+    if (!conn->exec("COMMIT")) {
+        conn->exec("ROLLBACK");
+        return -1;
+    }
+    return deleted;
+}
+
+bool Database::incrementalVacuum(int pages) {
+    auto conn = acquireWriter();
+    if (!conn) {
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, days);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    // 只有 auto_vacuum=INCREMENTAL 的数据库才能增量回收
+    // 旧数据库需要一次完整 VACUUM 才能切换模式，这里不自动执行，避免长时间锁库
+    {
+        auto stmt = conn->prepare("PRAGMA auto_vacuum");
+        if (!stmt || sqlite3_step(stmt) != SQLITE_ROW || sqlite3_column_int(stmt, 0) != 2) {
+            return false;
+        }
+    }
+
+    std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(std::max(1, pages)) + ")";
+    return conn->exec(sql.c_str());
+}
 
-    return rc == SQLITE_DONE;
+bool Database::upsertAnalyticsBuckets(const std::vector<AnalyticsBucket>& buckets) {
+    if (buckets.empty()) {
+        return true;
+    }
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+
+    if (!conn->exec("BEGIN IMMEDIATE")) {
+        return false;
+    }
+    {
+        // 同一分钟已有记录时（服务重启前已写入一部分）累加
+        auto stmt = conn->prepare(R"(
+            INSERT INTO analytics_minutes
+                (channel_id, minute_ts, roi_id, entries, exits, max_occupancy, occupancy_sum, samples)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+            ON CONFLICT (channel_id, minute_ts, roi_id) DO UPDATE SET
+                entries = entries + excluded.entries,
+                exits = exits + excluded.exits,
+                max_occupancy = MAX(max_occupancy, excluded.max_occupancy),
+                occupancy_sum = occupancy_sum + excluded.occupancy_sum,
+                samples = samples + excluded.samples
+        )");
+        if (!stmt) {
+            std::cerr << "写入客流统计失败: " << conn->errmsg() << std::endl;
+            conn->exec("ROLLBACK");
+            return false;
+        }
+        for (const auto& bucket : buckets) {
+            sqlite3_bind_int(stmt, 1, bucket.channel_id);
+            sqlite3_bind_int64(stmt, 2, bucket.minute_ts);
+            sqlite3_bind_int(stmt, 3, bucket.roi_id);
+            sqlite3_bind_int(stmt, 4, bucket.entries);
+            sqlite3_bind_int(stmt, 5, bucket.exits);
+            sqlite3_bind_int(stmt, 6, bucket.max_occupancy);
+            sqlite3_bind_int64(stmt, 7, bucket.occupancy_sum);
+            sqlite3_bind_int(stmt, 8, bucket.samples);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::cerr << "写入客流统计失败: " << conn->errmsg() << std::endl;
+                conn->exec("ROLLBACK");
+                return false;
+            }
+            sqlite3_reset(stmt);
+        }
+    }
+
+    if (!conn->exec("COMMIT")) {
+        conn->exec("ROLLBACK");
+        return false;
+    }
+    return true;
+}
+
+std::vector<AnalyticsBucket> Database::getAnalyticsBuckets(int channel_id, int roi_id,
+                                                           int64_t from_ts, int64_t to_ts) {
+    std::vector<AnalyticsBucket> buckets;
+    auto conn = acquireReader();
+    if (!conn) {
+        return buckets;
+    }
+
+    auto stmt = conn->prepare(R"(
+        SELECT roi_id, minute_ts, entries, exits, max_occupancy, occupancy_sum, samples
+        FROM analytics_minutes
+        WHERE channel_id = ? AND minute_ts >= ? AND minute_ts < ? AND (? < 0 OR roi_id = ?)
+        ORDER BY minute_ts, roi_id
+    )");
+    if (!stmt) {
+        return buckets;
+    }
+    sqlite3_bind_int(stmt, 1, channel_id);
+    sqlite3_bind_int64(stmt, 2, from_ts);
+    sqlite3_bind_int64(stmt, 3, to_ts);
+    sqlite3_bind_int(stmt, 4, roi_id);
+    sqlite3_bind_int(stmt, 5, roi_id);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        AnalyticsBucket bucket;
+        bucket.channel_id = channel_id;
+        bucket.roi_id = sqlite3_column_int(stmt, 0);
+        bucket.minute_ts = sqlite3_column_int64(stmt, 1);
+        bucket.entries = sqlite3_column_int(stmt, 2);
+        bucket.exits = sqlite3_column_int(stmt, 3);
+        bucket.max_occupancy = sqlite3_column_int(stmt, 4);
+        bucket.occupancy_sum = sqlite3_column_int64(stmt, 5);
+        bucket.samples = sqlite3_column_int(stmt, 6);
+        buckets.push_back(bucket);
+    }
+    return buckets;
+}
+
+int Database::deleteAnalyticsBefore(int64_t cutoff_ts) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return -1;
+    }
+    auto stmt = conn->prepare("DELETE FROM analytics_minutes WHERE minute_ts < ?");
+    if (!stmt) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, cutoff_ts);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "删除过期客流统计失败: " << conn->errmsg() << std::endl;
+        return -1;
+    }
+    return sqlite3_changes(conn->handle());
 }
 
 // 通道管理方法实现
@@ -515,10 +1110,12 @@ int Database::insertChannel(int id, const std::string& name, const std::string&
         VALUES (?, ?, ?, 'idle', ?, ?, ?, ?)
     )";
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
+    auto conn = acquireWriter();
+    if (!conn) {
+        return -1;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return -1;
     }
 
@@ -530,31 +1127,32 @@ int Database::insertChannel(int id, const std::string& name, const std::string&
     sqlite3_bind_text(stmt, 6, created_at.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 7, updated_at.c_str(), -1, SQLITE_STATIC);
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     int result = -1;
     
     if (rc == SQLITE_DONE) {
         result = id;
     } else {
-        std::cerr << "插入通道失败: " << sqlite3_errmsg(db_) << std::endl;
+        std::cerr << "插入通道失败: " << conn->errmsg() << std::endl;
     }
 
-    sqlite3_finalize(stmt);
     return result;
 }
 
 bool Database::deleteChannel(int channel_id) {
     const char* sql = "DELETE FROM channels WHERE id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
     sqlite3_bind_int(stmt, 1, channel_id);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -567,9 +1165,12 @@ bool Database::updateChannel(int channel_id, const std::string& name, const std:
         WHERE id = ?
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
@@ -580,8 +1181,7 @@ bool Database::updateChannel(int channel_id, const std::string& name, const std:
     sqlite3_bind_text(stmt, 5, updated_at.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 6, channel_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -589,9 +1189,12 @@ bool Database::updateChannel(int channel_id, const std::string& name, const std:
 bool Database::updateChannelStatus(int channel_id, const std::string& status, const std::string& updated_at) {
     const char* sql = "UPDATE channels SET status = ?, updated_at = ? WHERE id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
@@ -599,8 +1202,7 @@ bool Database::updateChannelStatus(int channel_id, const std::string& status, co
     sqlite3_bind_text(stmt, 2, updated_at.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 3, channel_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -615,9 +1217,14 @@ bool Database::updateChannelId(int old_id, int new_id) {
         return false;
     }
     
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    
     // 开始事务
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(conn->handle(), "BEGIN TRANSACTION", nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
         if (err_msg) {
             std::cerr << "开始事务失败: " << err_msg << std::endl;
@@ -628,19 +1235,17 @@ bool Database::updateChannelId(int old_id, int new_id) {
     
     // 删除旧记录
     const char* delete_sql = "DELETE FROM channels WHERE id = ?";
-    sqlite3_stmt* delete_stmt;
-    rc = sqlite3_prepare_v2(db_, delete_sql, -1, &delete_stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    auto delete_stmt = conn->prepare(delete_sql);
+    if (!delete_stmt) {
+        conn->exec("ROLLBACK");
         return false;
     }
     
     sqlite3_bind_int(delete_stmt, 1, old_id);
     rc = sqlite3_step(delete_stmt);
-    sqlite3_finalize(delete_stmt);
     
     if (rc != SQLITE_DONE) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        conn->exec("ROLLBACK");
         return false;
     }
     
@@ -649,10 +1254,9 @@ bool Database::updateChannelId(int old_id, int new_id) {
         INSERT INTO channels (id, name, source_url, status, enabled, report_enabled, created_at, updated_at)
         VALUES (?, ?, ?, ?, ?, ?, ?, ?)
     )";
-    sqlite3_stmt* insert_stmt;
-    rc = sqlite3_prepare_v2(db_, insert_sql, -1, &insert_stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    auto insert_stmt = conn->prepare(insert_sql);
+    if (!insert_stmt) {
+        conn->exec("ROLLBACK");
         return false;
     }
     
@@ -666,34 +1270,31 @@ bool Database::updateChannelId(int old_id, int new_id) {
     sqlite3_bind_text(insert_stmt, 8, updated_at.c_str(), -1, SQLITE_STATIC);
     
     rc = sqlite3_step(insert_stmt);
-    sqlite3_finalize(insert_stmt);
     
     if (rc != SQLITE_DONE) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        conn->exec("ROLLBACK");
         return false;
     }
     
     // 更新alerts表中的channel_id（外键）
     const char* update_alerts_sql = "UPDATE alerts SET channel_id = ? WHERE channel_id = ?";
-    sqlite3_stmt* update_alerts_stmt;
-    rc = sqlite3_prepare_v2(db_, update_alerts_sql, -1, &update_alerts_stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    auto update_alerts_stmt = conn->prepare(update_alerts_sql);
+    if (!update_alerts_stmt) {
+        conn->exec("ROLLBACK");
         return false;
     }
     
     sqlite3_bind_int(update_alerts_stmt, 1, new_id);
     sqlite3_bind_int(update_alerts_stmt, 2, old_id);
     rc = sqlite3_step(update_alerts_stmt);
-    sqlite3_finalize(update_alerts_stmt);
     
     if (rc != SQLITE_DONE) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        conn->exec("ROLLBACK");
         return false;
     }
     
     // 提交事务
-    rc = sqlite3_exec(db_, "COMMIT", nullptr, nullptr, &err_msg);
+    rc = sqlite3_exec(conn->handle(), "COMMIT", nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
         if (err_msg) {
             std::cerr << "提交事务失败: " << err_msg << std::endl;
@@ -709,9 +1310,12 @@ std::vector<std::pair<int, std::string>> Database::getAllChannelsFromDB() {
     std::vector<std::pair<int, std::string>> channels;
     const char* sql = "SELECT id, name FROM channels";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return channels;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return channels;
     }
 
@@ -721,7 +1325,6 @@ std::vector<std::pair<int, std::string>> Database::getAllChannelsFromDB() {
         channels.push_back({id, name ? name : ""});
     }
 
-    sqlite3_finalize(stmt);
     return channels;
 }
 
@@ -729,9 +1332,12 @@ bool Database::loadChannelFromDB(int channel_id, std::string& name, std::string&
                                   std::string& status, bool& enabled, bool& report_enabled, std::string& created_at, std::string& updated_at) {
     const char* sql = "SELECT name, source_url, status, enabled, report_enabled, created_at, updated_at FROM channels WHERE id = ?";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
 
@@ -750,20 +1356,21 @@ bool Database::loadChannelFromDB(int channel_id, std::string& name, std::string&
         int updated_at_idx = (col_count > 4) ? 6 : 5;
         created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, created_at_idx));
         updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, updated_at_idx));
-        sqlite3_finalize(stmt);
         return true;
     }
 
-    sqlite3_finalize(stmt);
     return false;
 }
 
 int Database::getMaxChannelId() {
     const char* sql = "SELECT MAX(id) FROM channels";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return 0;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return 0;
     }
 
@@ -772,7 +1379,6 @@ int Database::getMaxChannelId() {
         max_id = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
     return max_id;
 }
 
@@ -784,10 +1390,12 @@ bool Database::saveReportConfig(const ReportConfig& config) {
         ) VALUES (1, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -805,8 +1413,7 @@ bool Database::saveReportConfig(const ReportConfig& config) {
     sqlite3_bind_int(stmt, 9, config.enabled.load() ? 1 : 0);
     sqlite3_bind_text(stmt, 10, updated_at.c_str(), -1, SQLITE_STATIC);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
     
     return rc == SQLITE_DONE;
 }
@@ -816,9 +1423,12 @@ bool Database::loadReportConfig(ReportConfig& config) {
                       "mqtt_username, mqtt_password, mqtt_client_id, enabled "
                       "FROM report_config WHERE id = 1";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -848,11 +1458,9 @@ bool Database::loadReportConfig(ReportConfig& config) {
         
         config.enabled = sqlite3_column_int(stmt, 8) != 0;
         
-        sqlite3_finalize(stmt);
         return true;
     }
     
-    sqlite3_finalize(stmt);
     return false;
 }
 
@@ -866,10 +1474,12 @@ bool Database::saveGB28181Config(const GB28181Config& config) {
         ) VALUES (1, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
+    auto conn = acquireWriter();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -896,8 +1506,7 @@ bool Database::saveGB28181Config(const GB28181Config& config) {
     sqlite3_bind_text(stmt, 19, config.sip_transport.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 20, updated_at.c_str(), -1, SQLITE_STATIC);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
     
     return rc == SQLITE_DONE;
 }
@@ -911,13 +1520,16 @@ bool Database::loadGB28181Config(GB28181Config& config) {
         FROM gb28181_config WHERE id = 1
     )";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = acquireReader();
+    if (!conn) {
+        return false;
+    }
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc == SQLITE_ROW) {
         config.enabled.store(sqlite3_column_int(stmt, 0) != 0);
         
@@ -962,11 +1574,9 @@ bool Database::loadGB28181Config(GB28181Config& config) {
         const char* sip_transport = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 18));
         config.sip_transport = sip_transport ? sip_transport : "UDP";
         
-        sqlite3_finalize(stmt);
         return true;
     }
     
-    sqlite3_finalize(stmt);
     return false;
 }
 
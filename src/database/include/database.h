@@ -4,10 +4,18 @@
 #include <vector>
 #include <memory>
 #include <optional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include <sqlite3.h>
+#include "sqlite_connection.h"
 #include "alert.h"
 #include "report_config.h"
 #include "gb28181_config.h"
+#include "analytics.h"
 
 namespace detector_service {
 
@@ -18,22 +26,81 @@ public:
         return instance;
     }
 
+    /**
+     * @brief 连接租用
+     * 读连接从连接池中取出（HTTP API 等查询并发执行），写连接全局唯一（所有写操作串行）。
+     * 租用期间独占连接，析构时归还。数据库未初始化时租用结果为空。
+     */
+    class ConnectionLease {
+    public:
+        ConnectionLease(Database* owner, SqliteConnection* conn, bool writer)
+            : owner_(owner), conn_(conn), writer_(writer) {}
+        ConnectionLease(ConnectionLease&& other) noexcept
+            : owner_(other.owner_), conn_(other.conn_), writer_(other.writer_) {
+            other.conn_ = nullptr;
+        }
+        ConnectionLease(const ConnectionLease&) = delete;
+        ConnectionLease& operator=(const ConnectionLease&) = delete;
+        ConnectionLease& operator=(ConnectionLease&&) = delete;
+        ~ConnectionLease() {
+            if (conn_) {
+                owner_->releaseConnection(conn_, writer_);
+            }
+        }
+
+        explicit operator bool() const { return conn_ != nullptr; }
+        SqliteConnection* operator->() const { return conn_; }
+        SqliteConnection& operator*() const { return *conn_; }
+
+    private:
+        Database* owner_;
+        SqliteConnection* conn_;
+        bool writer_;
+    };
+
+    ConnectionLease acquireReader();
+    ConnectionLease acquireWriter();
+
     bool initialize(const std::string& db_path);
     void close();
 
     // 报警记录管理
+    // 报警写入（插入和上报状态更新）由报警写入线程按批次合并为事务提交，调用方不等待落库；
+    // 同一批次内的上报状态更新按取值合并为 "WHERE id IN (...)"
+    // insertAlert 立即返回预分配的报警ID
     int insertAlert(const AlertRecord& alert);
     bool deleteAlert(int alert_id);
     bool deleteAlertsByChannel(int channel_id);
     std::vector<AlertRecord> getAlerts(int limit = 100, int offset = 0);
     std::vector<AlertRecord> getAlertsByChannel(int channel_id, int limit = 100, int offset = 0);
+    // 按游标翻页（游标无效时从最新一条开始），channel_id 为 0 表示所有通道
+    std::vector<AlertRecord> getAlertsPage(const AlertCursor& cursor, int limit, int channel_id = 0);
     AlertRecord getAlert(int alert_id);
     int getAlertCount();
     int getAlertCountByChannel(int channel_id);
     bool updateAlertReportStatus(int alert_id, const std::string& report_status, const std::string& report_url);
+    // 按上报状态（pending/failed，走对应状态的部分索引 idx_alerts_report_pending/failed）按ID倒序翻页，before_id 为 0 时从最新一条开始
+    std::vector<AlertRecord> getAlertsByReportStatus(const std::string& report_status, int before_id, int limit);
+    int getReportStatusCount(const std::string& report_status);
+    // 上报发件箱：写入和删除与报警写入走同一队列（在报警插入之后落库），报警删除时由触发器一并删除
+    void putReportOutbox(const ReportOutboxEntry& entry);
+    void removeReportOutbox(int alert_id);
+    std::vector<ReportOutboxEntry> loadReportOutbox();
+    // 等待已提交的报警写入全部落库
+    void flushAlertWrites();
 
     // 清理旧数据
-    bool cleanupOldAlerts(int days);
+    // 删除 created_ts 早于 cutoff_ts 的最早 limit 条报警（单个短事务），返回删除条数，失败返回 -1
+    // 被删除报警的图片路径追加到 image_paths，由调用方删除文件
+    int deleteAlertsBefore(int64_t cutoff_ts, int limit, std::vector<std::string>& image_paths);
+    // 增量回收空闲页，数据库未启用 auto_vacuum=INCREMENTAL 时返回 false
+    bool incrementalVacuum(int pages);
+
+    // 区域客流统计（每个通道、ROI、分钟一条）
+    // 写入时同一分钟已有记录则累加；roi_id 为负数时查询通道的所有ROI，时间范围为 [from_ts, to_ts)
+    bool upsertAnalyticsBuckets(const std::vector<AnalyticsBucket>& buckets);
+    std::vector<AnalyticsBucket> getAnalyticsBuckets(int channel_id, int roi_id, int64_t from_ts, int64_t to_ts);
+    int deleteAnalyticsBefore(int64_t cutoff_ts);
 
     // 通道管理
     int insertChannel(int id, const std::string& name, const std::string& source_url, 
@@ -56,17 +123,54 @@ public:
     bool saveGB28181Config(const GB28181Config& config);
     bool loadGB28181Config(GB28181Config& config);
 
-    // 获取数据库句柄（供其他模块使用）
-    sqlite3* getDb() const { return db_; }
-
 private:
-    Database() : db_(nullptr) {}
+    Database() = default;
     ~Database() { close(); }
     Database(const Database&) = delete;
     Database& operator=(const Database&) = delete;
 
-    sqlite3* db_;
     bool createTables();
+    std::vector<AlertRecord> queryAlerts(const std::string& sql, const std::function<void(sqlite3_stmt*)>& bind);
+    void releaseConnection(SqliteConnection* conn, bool writer);
+
+    // 写连接（建表、报警写入线程和其他所有写操作共用）
+    std::unique_ptr<SqliteConnection> writer_;
+    std::mutex writer_mutex_;
+
+    // 只读连接池
+    std::vector<std::unique_ptr<SqliteConnection>> readers_;
+    std::vector<SqliteConnection*> idle_readers_;
+    std::mutex readers_mutex_;
+    std::condition_variable readers_cv_;
+
+    // 报警写入线程
+    struct PendingAlertWrite {
+        enum class Kind {
+            INSERT_ALERT,    // 插入报警
+            REPORT_STATUS,   // 更新上报状态
+            PUT_OUTBOX,      // 写入发件箱条目
+            REMOVE_OUTBOX    // 删除发件箱条目
+        };
+        Kind kind = Kind::INSERT_ALERT;
+        AlertRecord alert;
+        ReportOutboxEntry outbox;
+    };
+    bool startAlertWriter();
+    void stopAlertWriter();
+    void alertWriterWorker();
+    // 在一个事务中写入一批操作，事务失败（数据库忙、I/O 错误等）时回滚并返回 false，由调用方整批重试
+    bool writeAlertBatch(std::vector<PendingAlertWrite>& batch);
+    void enqueueAlertWrite(PendingAlertWrite write);
+
+    std::atomic<int> next_alert_id_{1};
+
+    std::deque<PendingAlertWrite> alert_write_queue_;
+    std::mutex alert_write_mutex_;
+    std::condition_variable alert_write_cv_;
+    std::condition_variable alert_write_done_cv_;
+    size_t alert_writes_in_flight_ = 0;
+    bool alert_writer_running_ = false;
+    std::thread alert_writer_thread_;
 };
 
 } // namespace detector_service
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <sqlite3.h>
+
+namespace detector_service {
+
+/**
+ * @brief 缓存的预编译语句
+ * 作用域结束时自动 reset 并清除绑定，语句本身留在连接的缓存中复用。
+ * 可隐式转换为 sqlite3_stmt*，直接传给 sqlite3_bind_* / sqlite3_column_* 使用。
+ */
+class CachedStatement {
+public:
+    explicit CachedStatement(sqlite3_stmt* stmt = nullptr) : stmt_(stmt) {}
+    ~CachedStatement() { release(); }
+
+    CachedStatement(CachedStatement&& other) noexcept : stmt_(other.stmt_) { other.stmt_ = nullptr; }
+    CachedStatement& operator=(CachedStatement&& other) noexcept {
+        if (this != &other) {
+            release();
+            stmt_ = other.stmt_;
+            other.stmt_ = nullptr;
+        }
+        return *this;
+    }
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+
+    operator sqlite3_stmt*() const { return stmt_; }
+
+private:
+    void release() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+            stmt_ = nullptr;
+        }
+    }
+
+    sqlite3_stmt* stmt_;
+};
+
+/**
+ * @brief SQLite 连接 + 预编译语句缓存（以 SQL 文本为键）
+ * 连接不做内部加锁，同一时刻只能由一个线程使用，由 Database 的连接池保证独占。
+ */
+class SqliteConnection {
+public:
+    /**
+     * @brief 打开连接并设置 WAL、busy_timeout 等参数
+     * @param read_only 只读连接（HTTP API 查询使用）
+     * @param incremental_vacuum 写连接新建数据库文件时启用 auto_vacuum=INCREMENTAL
+     * @return 打开失败时返回 nullptr
+     */
+    static std::unique_ptr<SqliteConnection> open(const std::string& db_path, bool read_only,
+                                                  bool incremental_vacuum = false);
+
+    ~SqliteConnection();
+    SqliteConnection(const SqliteConnection&) = delete;
+    SqliteConnection& operator=(const SqliteConnection&) = delete;
+
+    sqlite3* handle() const { return db_; }
+    const char* errmsg() const { return sqlite3_errmsg(db_); }
+
+    /**
+     * @brief 获取预编译语句，首次使用时编译并缓存
+     * @return 编译失败时返回空语句（转换为 nullptr），错误信息见 errmsg()
+     */
+    CachedStatement prepare(const std::string& sql);
+
+    // 执行不带参数的 SQL（建表、事务控制等），失败时输出错误信息
+    bool exec(const char* sql);
+
+private:
+    explicit SqliteConnection(sqlite3* db) : db_(db) {}
+
+    sqlite3* db_;
+    std::unordered_map<std::string, sqlite3_stmt*> statements_;
+};
+
+} // namespace detector_service
@@ -0,0 +1,78 @@
+#include "sqlite_connection.h"
+#include <iostream>
+
+namespace detector_service {
+
+namespace {
+
+// 数据库被其他连接锁定时的等待时间
+constexpr int kBusyTimeoutMs = 5000;
+
+} // namespace
+
+std::unique_ptr<SqliteConnection> SqliteConnection::open(const std::string& db_path, bool read_only,
+                                                         bool incremental_vacuum) {
+    // 连接由连接池保证单线程使用，不需要 SQLite 内部的连接级互斥锁
+    int flags = SQLITE_OPEN_NOMUTEX;
+    flags |= read_only ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+    sqlite3* db = nullptr;
+    int rc = sqlite3_open_v2(db_path.c_str(), &db, flags, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "无法打开数据库: " << (db ? sqlite3_errmsg(db) : sqlite3_errstr(rc)) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    std::unique_ptr<SqliteConnection> conn(new SqliteConnection(db));
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+
+    // WAL 模式下读写互不阻塞；WAL 下 synchronous=NORMAL 仍可保证数据库一致性
+    // journal_mode 持久保存在数据库文件中，由写连接设置一次即可
+    if (!read_only) {
+        // auto_vacuum 只能在写入数据库头之前设置，切换 WAL 会写入数据库头，因此必须先于 journal_mode；
+        // 已有数据库的模式不变（需完整 VACUUM 才能切换），这条语句对其无效
+        if (incremental_vacuum) {
+            conn->exec("PRAGMA auto_vacuum = INCREMENTAL");
+        }
+        conn->exec("PRAGMA journal_mode = WAL");
+        conn->exec("PRAGMA synchronous = NORMAL");
+    }
+    conn->exec("PRAGMA temp_store = MEMORY");
+    return conn;
+}
+
+SqliteConnection::~SqliteConnection() {
+    for (auto& pair : statements_) {
+        sqlite3_finalize(pair.second);
+    }
+    sqlite3_close(db_);
+}
+
+CachedStatement SqliteConnection::prepare(const std::string& sql) {
+    auto it = statements_.find(sql);
+    if (it != statements_.end()) {
+        return CachedStatement(it->second);
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "准备语句失败: " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_finalize(stmt);
+        return CachedStatement();
+    }
+    statements_.emplace(sql, stmt);
+    return CachedStatement(stmt);
+}
+
+bool SqliteConnection::exec(const char* sql) {
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "执行SQL失败: " << (err_msg ? err_msg : sqlite3_errmsg(db_)) << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+} // namespace detector_service
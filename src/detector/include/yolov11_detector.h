@@ -7,6 +7,7 @@
 #include <memory>
 #include "image_utils.h"
 #include "algorithm_config.h"
+#include "compiled_filter.h"
 #include "onnx_env_singleton.h"
 #include "config.h"
 
@@ -42,6 +43,10 @@ public:
                                        int frame_width = 0,
                                        int frame_height = 0);
     
+    // 使用预编译过滤器应用过滤（类别位图 + 栅格化ROI）
+    std::vector<Detection> applyFilters(const std::vector<Detection>& detections,
+                                       const CompiledAlgorithmFilter& filter) const;
+    
     // 获取类别名称列表
     const std::vector<std::string>& getClassNames() const { return class_names_; }
     
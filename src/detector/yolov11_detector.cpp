@@ -619,6 +619,11 @@ std::vector<Detection> YOLOv11Detector::applyFilters(const std::vector<Detection
     return filtered;
 }
 
+std::vector<Detection> YOLOv11Detector::applyFilters(const std::vector<Detection>& detections,
+                                                     const CompiledAlgorithmFilter& filter) const {
+    return filter.filterDetections(detections);
+}
+
 cv::Mat YOLOv11Detector::processFrame(const cv::Mat& frame) {
     auto detections = detect(frame);
     return ImageUtils::drawDetections(frame, detections);
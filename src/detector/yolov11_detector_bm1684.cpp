@@ -589,6 +589,11 @@ std::vector<Detection> YOLOv11DetectorBM1684::applyFilters(const std::vector<Det
     return filtered;
 }
 
+std::vector<Detection> YOLOv11DetectorBM1684::applyFilters(const std::vector<Detection>& detections,
+                                                          const CompiledAlgorithmFilter& filter) const {
+    return filter.filterDetections(detections);
+}
+
 cv::Mat YOLOv11DetectorBM1684::processFrame(const cv::Mat& frame) {
     auto detections = detect(frame);
     return ImageUtils::drawDetections(frame, detections);
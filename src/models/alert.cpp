@@ -5,6 +5,31 @@
 
 namespace detector_service {
 
+std::string AlertCursor::toString() const {
+    return std::to_string(created_ts) + "-" + std::to_string(id);
+}
+
+bool AlertCursor::parse(const std::string& text, AlertCursor& cursor) {
+    size_t sep = text.find('-');
+    if (sep == std::string::npos || sep == 0 || sep + 1 >= text.size()) {
+        return false;
+    }
+    try {
+        size_t ts_len = 0;
+        size_t id_len = 0;
+        int64_t created_ts = std::stoll(text.substr(0, sep), &ts_len);
+        int id = std::stoi(text.substr(sep + 1), &id_len);
+        if (ts_len != sep || id_len != text.size() - sep - 1 || id <= 0) {
+            return false;
+        }
+        cursor.created_ts = created_ts;
+        cursor.id = id;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
 int AlertManager::createAlert(const AlertRecord& alert) {
     auto& db = Database::getInstance();
     return db.insertAlert(alert);
@@ -30,6 +55,11 @@ std::vector<AlertRecord> AlertManager::getAlertsByChannel(int channel_id, int li
     return db.getAlertsByChannel(channel_id, limit, offset);
 }
 
+std::vector<AlertRecord> AlertManager::getAlertsPage(const AlertCursor& cursor, int limit, int channel_id) {
+    auto& db = Database::getInstance();
+    return db.getAlertsPage(cursor, limit, channel_id);
+}
+
 AlertRecord AlertManager::getAlert(int alert_id) {
     auto& db = Database::getInstance();
     return db.getAlert(alert_id);
@@ -50,9 +80,19 @@ bool AlertManager::updateAlertReportStatus(int alert_id, const std::string& repo
     return db.updateAlertReportStatus(alert_id, report_status, report_url);
 }
 
-bool AlertManager::cleanupOldAlerts(int days) {
+std::vector<AlertRecord> AlertManager::getAlertsByReportStatus(const std::string& report_status, int before_id, int limit) {
+    auto& db = Database::getInstance();
+    return db.getAlertsByReportStatus(report_status, before_id, limit);
+}
+
+int AlertManager::getReportStatusCount(const std::string& report_status) {
+    auto& db = Database::getInstance();
+    return db.getReportStatusCount(report_status);
+}
+
+int AlertManager::deleteAlertsBefore(int64_t cutoff_ts, int limit, std::vector<std::string>& image_paths) {
     auto& db = Database::getInstance();
-    return db.cleanupOldAlerts(days);
+    return db.deleteAlertsBefore(cutoff_ts, limit, image_paths);
 }
 
 bool AlertManager::isAlertSuppressed(int channel_id, int rule_id, int suppression_window_seconds) {
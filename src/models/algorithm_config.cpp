@@ -1,4 +1,5 @@
 #include "algorithm_config.h"
+#include "compiled_filter.h"
 #include "database.h"
 #include "utils/include/image_utils.h"
 #include <nlohmann/json.hpp>
@@ -10,10 +11,43 @@
 namespace detector_service {
 
 bool AlgorithmConfigManager::getAlgorithmConfig(int channel_id, AlgorithmConfig& config) {
-    auto& db = Database::getInstance();
-    sqlite3* db_handle = db.getDb();
+    auto snapshot = getAlgorithmConfigSnapshot(channel_id);
+    if (!snapshot) {
+        return false;
+    }
+    config = *snapshot;
+    return true;
+}
+
+std::shared_ptr<const AlgorithmConfig> AlgorithmConfigManager::getAlgorithmConfigSnapshot(int channel_id) {
+    {
+        std::lock_guard<std::mutex> lock(config_cache_mutex_);
+        auto it = config_cache_.find(channel_id);
+        if (it != config_cache_.end()) {
+            return it->second;
+        }
+    }
+    
+    // 缓存未命中时从数据库加载并解析一次
+    auto config = std::make_shared<AlgorithmConfig>();
+    if (!loadAlgorithmConfig(channel_id, *config)) {
+        return nullptr;
+    }
+    
+    // 加载期间配置被修改时版本号已变化，不写入缓存，下次重新加载
+    std::lock_guard<std::mutex> lock(config_cache_mutex_);
+    if (config->version == getConfigVersion(channel_id)) {
+        config_cache_[channel_id] = config;
+    }
+    return config;
+}
+
+bool AlgorithmConfigManager::loadAlgorithmConfig(int channel_id, AlgorithmConfig& config) {
+    // 版本号在读取数据库之前获取，保证缓存中的配置不会比版本号更新
+    uint64_t version = getConfigVersion(channel_id);
     
-    if (!db_handle) {
+    auto conn = Database::getInstance().acquireReader();
+    if (!conn) {
         std::cerr << "数据库未初始化" << std::endl;
         return false;
     }
@@ -28,9 +62,8 @@ bool AlgorithmConfigManager::getAlgorithmConfig(int channel_id, AlgorithmConfig&
         WHERE channel_id = ?
     )";
     
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "准备SQL语句失败: " << sqlite3_errmsg(db_handle) << std::endl;
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -74,6 +107,8 @@ bool AlgorithmConfigManager::getAlgorithmConfig(int channel_id, AlgorithmConfig&
                                ? ROIType::POLYGON : ROIType::RECTANGLE;
                     roi.name = roi_data.value("name", "");
                     roi.enabled = roi_data.value("enabled", true);
+                    roi.match_mode = stringToROIMatchMode(roi_data.value("match_mode", "CENTER"));
+                    roi.min_overlap_ratio = roi_data.value("min_overlap_ratio", 0.5f);
                     if (roi_data.contains("points")) {
                         for (const auto& point_data : roi_data["points"]) {
                             cv::Point2f point;
@@ -109,6 +144,10 @@ bool AlgorithmConfigManager::getAlgorithmConfig(int channel_id, AlgorithmConfig&
                     rule.min_count = rule_data.value("min_count", 1);
                     rule.max_count = rule_data.value("max_count", 0);
                     rule.suppression_window_seconds = rule_data.value("suppression_window_seconds", 60);
+                    rule.window_size = rule_data.value("window_size", 1);
+                    rule.min_hits = rule_data.value("min_hits", 1);
+                    rule.min_duration_seconds = rule_data.value("min_duration_seconds", 0);
+                    rule.count_delta = rule_data.value("count_delta", 0);
                     if (rule_data.contains("roi_ids")) {
                         for (const auto& roi_id : rule_data["roi_ids"]) {
                             rule.roi_ids.push_back(roi_id);
@@ -127,13 +166,13 @@ bool AlgorithmConfigManager::getAlgorithmConfig(int channel_id, AlgorithmConfig&
         found = true;
     }
     
-    sqlite3_finalize(stmt);
-    
     if (!found) {
         // 如果不存在，返回默认配置
         config = getDefaultConfig(channel_id);
     }
     
+    config.version = version;
+    
     return true;
 }
 
@@ -144,10 +183,8 @@ bool AlgorithmConfigManager::saveAlgorithmConfig(const AlgorithmConfig& config)
         return false;
     }
     
-    auto& db = Database::getInstance();
-    sqlite3* db_handle = db.getDb();
-    
-    if (!db_handle) {
+    auto conn = Database::getInstance().acquireWriter();
+    if (!conn) {
         std::cerr << "数据库未初始化" << std::endl;
         return false;
     }
@@ -174,6 +211,8 @@ bool AlgorithmConfigManager::saveAlgorithmConfig(const AlgorithmConfig& config)
         roi_data["type"] = (roi.type == ROIType::RECTANGLE) ? "RECTANGLE" : "POLYGON";
         roi_data["name"] = roi.name;
         roi_data["enabled"] = roi.enabled;
+        roi_data["match_mode"] = roiMatchModeToString(roi.match_mode);
+        roi_data["min_overlap_ratio"] = roi.min_overlap_ratio;
         nlohmann::json points_array = nlohmann::json::array();
         for (const auto& point : roi.points) {
             nlohmann::json point_data;
@@ -208,6 +247,10 @@ bool AlgorithmConfigManager::saveAlgorithmConfig(const AlgorithmConfig& config)
         rule_data["min_count"] = rule.min_count;
         rule_data["max_count"] = rule.max_count;
         rule_data["suppression_window_seconds"] = rule.suppression_window_seconds;
+        rule_data["window_size"] = rule.window_size;
+        rule_data["min_hits"] = rule.min_hits;
+        rule_data["min_duration_seconds"] = rule.min_duration_seconds;
+        rule_data["count_delta"] = rule.count_delta;
         rule_data["roi_ids"] = rule.roi_ids;
         alert_rules_data.push_back(rule_data);
     }
@@ -223,9 +266,8 @@ bool AlgorithmConfigManager::saveAlgorithmConfig(const AlgorithmConfig& config)
                 datetime('now'))
     )";
     
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "准备SQL语句失败: " << sqlite3_errmsg(db_handle) << std::endl;
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -242,30 +284,33 @@ bool AlgorithmConfigManager::saveAlgorithmConfig(const AlgorithmConfig& config)
     sqlite3_bind_int(stmt, 11, config.channel_id);
     
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
+    
+    if (success) {
+        bumpConfigVersion(config.channel_id);
+    }
     
     return success;
 }
 
 bool AlgorithmConfigManager::deleteAlgorithmConfig(int channel_id) {
-    auto& db = Database::getInstance();
-    sqlite3* db_handle = db.getDb();
-    
-    if (!db_handle) {
+    auto conn = Database::getInstance().acquireWriter();
+    if (!conn) {
         std::cerr << "数据库未初始化" << std::endl;
         return false;
     }
     
     std::string sql = "DELETE FROM algorithm_configs WHERE channel_id = ?";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "准备SQL语句失败: " << sqlite3_errmsg(db_handle) << std::endl;
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
         return false;
     }
     
     sqlite3_bind_int(stmt, 1, channel_id);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
+    
+    if (success) {
+        bumpConfigVersion(channel_id);
+    }
     
     return success;
 }
@@ -314,9 +359,77 @@ bool AlgorithmConfigManager::validateConfig(const AlgorithmConfig& config, std::
         return false;
     }
     
+    for (const auto& roi : config.rois) {
+        if (roi.min_overlap_ratio < 0.0f || roi.min_overlap_ratio > 1.0f) {
+            error_msg = "ROI最小重叠比例必须在0-1之间";
+            return false;
+        }
+    }
+    
+    for (const auto& rule : config.alert_rules) {
+        if (rule.window_size < 1 || rule.window_size > kMaxRuleWindowSize) {
+            error_msg = "告警规则窗口长度必须在1-" + std::to_string(kMaxRuleWindowSize) + "之间";
+            return false;
+        }
+        if (rule.min_hits < 1 || rule.min_hits > rule.window_size) {
+            error_msg = "告警规则命中次数必须在1和窗口长度之间";
+            return false;
+        }
+        if (rule.min_duration_seconds < 0 || rule.count_delta < 0) {
+            error_msg = "告警规则持续时间和数量变化不能为负数";
+            return false;
+        }
+    }
+    
     return true;
 }
 
+void AlgorithmConfigManager::bumpConfigVersion(int channel_id) {
+    {
+        std::lock_guard<std::mutex> lock(version_mutex_);
+        config_versions_[channel_id] = next_version_++;
+    }
+    // 配置已修改，丢弃缓存
+    std::lock_guard<std::mutex> lock(config_cache_mutex_);
+    config_cache_.erase(channel_id);
+}
+
+uint64_t AlgorithmConfigManager::getConfigVersion(int channel_id) {
+    std::lock_guard<std::mutex> lock(version_mutex_);
+    auto it = config_versions_.find(channel_id);
+    return it != config_versions_.end() ? it->second : 0;
+}
+
+std::shared_ptr<const CompiledAlgorithmFilter> AlgorithmConfigManager::getCompiledFilter(
+    const AlgorithmConfig& config, int frame_width, int frame_height) {
+    std::lock_guard<std::mutex> lock(filter_cache_mutex_);
+    auto& cached = filter_cache_[config.channel_id];
+    if (cached && cached->version() == config.version &&
+        cached->matchesSize(frame_width, frame_height)) {
+        return cached;
+    }
+    
+    cached = std::make_shared<const CompiledAlgorithmFilter>(config, frame_width, frame_height);
+    return cached;
+}
+
+std::string AlgorithmConfigManager::roiMatchModeToString(ROIMatchMode mode) {
+    return mode == ROIMatchMode::OVERLAP ? "OVERLAP" : "CENTER";
+}
+
+ROIMatchMode AlgorithmConfigManager::stringToROIMatchMode(const std::string& mode) {
+    return mode == "OVERLAP" ? ROIMatchMode::OVERLAP : ROIMatchMode::CENTER;
+}
+
+bool AlgorithmConfigManager::isRuleCountSatisfied(const AlertRule& rule, size_t matched_count) {
+    if (matched_count == 0) {
+        return false;
+    }
+    
+    // 超过最大数量（如果设置了）也触发告警，因此只需检查最小数量
+    return static_cast<int>(matched_count) >= rule.min_count;
+}
+
 bool AlgorithmConfigManager::isPointInROI(const cv::Point2f& point, const ROI& roi, int frame_width, int frame_height) {
     if (!roi.enabled) {
         return false;
@@ -340,19 +453,15 @@ bool AlgorithmConfigManager::isPointInROI(const cv::Point2f& point, const ROI& r
     } else if (roi.type == ROIType::POLYGON) {
         if (roi.points.size() < 3) return false;
         // 使用射线法判断点是否在多边形内
-        // 先将归一化的多边形坐标转换为像素坐标
-        std::vector<cv::Point2f> pixel_points;
-        for (const auto& norm_point : roi.points) {
-            pixel_points.push_back(cv::Point2f(norm_point.x * scale_x, norm_point.y * scale_y));
-        }
-        
+        // 直接在归一化坐标上逐边换算，避免每次调用都分配像素坐标数组
         int intersections = 0;
-        for (size_t i = 0, j = pixel_points.size() - 1; i < pixel_points.size(); j = i++) {
-            const cv::Point2f& p1 = pixel_points[i];
-            const cv::Point2f& p2 = pixel_points[j];
+        size_t n = roi.points.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            float x1 = roi.points[i].x * scale_x, y1 = roi.points[i].y * scale_y;
+            float x2 = roi.points[j].x * scale_x, y2 = roi.points[j].y * scale_y;
             
-            if (((p1.y > point.y) != (p2.y > point.y)) &&
-                (point.x < (p2.x - p1.x) * (point.y - p1.y) / (p2.y - p1.y) + p1.x)) {
+            if (((y1 > point.y) != (y2 > point.y)) &&
+                (point.x < (x2 - x1) * (point.y - y1) / (y2 - y1) + x1)) {
                 intersections++;
             }
         }
@@ -367,7 +476,12 @@ bool AlgorithmConfigManager::isDetectionInROI(const cv::Rect& bbox, const ROI& r
         return false;
     }
     
-    // 检查检测框的中心点或任意角点是否在ROI内
+    // 重叠比例模式需要栅格化ROI，高频调用应使用 CompiledAlgorithmFilter
+    if (roi.match_mode == ROIMatchMode::OVERLAP) {
+        return CompiledROI(roi, frame_width, frame_height).matches(bbox);
+    }
+    
+    // 检查检测框的中心点是否在ROI内
     cv::Point2f center(bbox.x + bbox.width / 2.0f, bbox.y + bbox.height / 2.0f);
     return isPointInROI(center, roi, frame_width, frame_height);
 }
@@ -448,20 +562,7 @@ bool AlgorithmConfigManager::shouldTriggerAlert(
     }
     
     // 检查数量条件
-    int count = static_cast<int>(matched.size());
-    
-    // 检查最小数量
-    if (count < rule.min_count) {
-        return false;
-    }
-    
-    // 检查最大数量（如果设置了）
-    if (rule.max_count > 0 && count > rule.max_count) {
-        return true;  // 超过最大数量也触发告警
-    }
-    
-    // 满足最小数量条件
-    return true;
+    return isRuleCountSatisfied(rule, matched.size());
 }
 
 } // namespace detector_service
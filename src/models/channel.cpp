@@ -7,239 +7,305 @@
 
 namespace detector_service {
 
+ChannelManager::ChannelManager()
+    : registry_(std::make_shared<const ChannelMap>()) {
+    // 启动数据库写回线程
+    write_worker_thread_ = std::thread(&ChannelManager::writeWorker, this);
+}
+
+ChannelManager::~ChannelManager() {
+    // 停止写回线程（退出前写完队列中剩余的修改）
+    {
+        std::lock_guard<std::mutex> lock(write_queue_mutex_);
+        write_worker_running_ = false;
+    }
+    write_queue_cv_.notify_all();
+
+    if (write_worker_thread_.joinable()) {
+        write_worker_thread_.join();
+    }
+}
+
+std::shared_ptr<const ChannelManager::ChannelMap> ChannelManager::registry() const {
+    return std::atomic_load(&registry_);
+}
+
+void ChannelManager::commit(std::shared_ptr<const ChannelMap> next, const std::string& description,
+                            std::function<bool(Database&)> write) {
+    std::atomic_store(&registry_, std::move(next));
+
+    {
+        std::lock_guard<std::mutex> lock(write_queue_mutex_);
+        write_queue_.push_back({description, std::move(write)});
+        writes_in_flight_++;
+    }
+    write_queue_cv_.notify_one();
+}
+
+void ChannelManager::writeWorker() {
+    while (true) {
+        PendingWrite write;
+        {
+            std::unique_lock<std::mutex> lock(write_queue_mutex_);
+            write_queue_cv_.wait(lock, [this] {
+                return !write_worker_running_ || !write_queue_.empty();
+            });
+            if (write_queue_.empty()) {
+                break;  // 已停止且队列为空
+            }
+            write = std::move(write_queue_.front());
+            write_queue_.pop_front();
+        }
+
+        if (!write.apply(Database::getInstance())) {
+            std::cerr << "错误: 通道数据写入数据库失败: " << write.description << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(write_queue_mutex_);
+            writes_in_flight_--;
+        }
+        write_done_cv_.notify_all();
+    }
+}
+
+void ChannelManager::flushWrites() {
+    std::unique_lock<std::mutex> lock(write_queue_mutex_);
+    write_done_cv_.wait(lock, [this] { return writes_in_flight_ == 0; });
+}
+
+bool ChannelManager::loadChannels() {
+    auto conn = Database::getInstance().acquireReader();
+    if (!conn) {
+        std::cerr << "数据库未初始化" << std::endl;
+        return false;
+    }
+
+    const char* sql = R"(
+        SELECT id, name, source_url, status, enabled, report_enabled, created_at, updated_at
+        FROM channels
+    )";
+
+    auto stmt = conn->prepare(sql);
+    if (!stmt) {
+        return false;
+    }
+
+    auto columnText = [&stmt](int index) -> std::string {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, index));
+        return text ? text : "";
+    };
+
+    auto channels = std::make_shared<ChannelMap>();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto channel = std::make_shared<Channel>();
+        channel->id = sqlite3_column_int(stmt, 0);
+        channel->name = columnText(1);
+        channel->source_url = columnText(2);
+        channel->status = stringToChannelStatus(columnText(3));
+        channel->enabled = sqlite3_column_int(stmt, 4) != 0;
+        channel->report_enabled = sqlite3_column_int(stmt, 5) != 0;
+        channel->created_at = columnText(6);
+        channel->updated_at = columnText(7);
+        (*channels)[channel->id] = channel;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    std::atomic_store(&registry_, std::shared_ptr<const ChannelMap>(std::move(channels)));
+    return true;
+}
+
 int ChannelManager::createChannel(const Channel& channel) {
-    auto& db = Database::getInstance();
-    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = registry();
+
     int id;
     if (channel.id > 0) {
         // 如果用户指定了id，使用用户指定的id
         id = channel.id;
-        // 检查数据库中id是否已存在
-        std::string name, source_url, status, created_at, updated_at;
-        bool enabled, report_enabled;
-        if (db.loadChannelFromDB(id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
+        // 检查id是否已存在
+        if (current->count(id) > 0) {
             return -1; // 返回-1表示id已存在
         }
     } else {
-        // 如果用户没有指定id，自动生成（从数据库获取最大id+1）
-        int max_id = db.getMaxChannelId();
-        id = max_id + 1;
-    }
-    
-    std::string created_at = getCurrentTime();
-    std::string updated_at = created_at;
-    
-    // 保存到数据库
-    int db_result = db.insertChannel(id, channel.name, channel.source_url,
-                                      channel.enabled.load(),
-                                      channel.report_enabled.load(), created_at, updated_at);
-    if (db_result == -1) {
-        std::cerr << "错误: 通道数据库保存失败" << std::endl;
-        return -1;
-    }
-    
+        // 如果用户没有指定id，自动生成（最大id+1）
+        id = current->empty() ? 1 : current->rbegin()->first + 1;
+    }
+
+    auto created = std::make_shared<Channel>(channel);
+    created->id = id;
+    created->status = ChannelStatus::IDLE;
+    created->created_at = getCurrentTime();
+    created->updated_at = created->created_at;
+
+    auto next = std::make_shared<ChannelMap>(*current);
+    (*next)[id] = created;
+
+    commit(std::move(next), "创建通道 " + std::to_string(id), [created](Database& db) {
+        return db.insertChannel(created->id, created->name, created->source_url,
+                                created->enabled.load(), created->report_enabled.load(),
+                                created->created_at, created->updated_at) != -1;
+    });
+
     return id;
 }
 
 bool ChannelManager::deleteChannel(int channel_id) {
-    auto& db = Database::getInstance();
-    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = registry();
+
     // 检查通道是否存在
-    std::string name, source_url, status, created_at, updated_at;
-    bool enabled, report_enabled;
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
+    if (current->count(channel_id) == 0) {
         return false; // 通道不存在
     }
-    
-    // 如果通道正在运行，先更新数据库状态为停止
-    if (status == "running") {
-        std::string updated_at = getCurrentTime();
-        if (!db.updateChannelStatus(channel_id, channelStatusToString(ChannelStatus::STOPPED), updated_at)) {
-            std::cerr << "错误: 通道状态更新失败，不删除通道" << std::endl;
-            return false;
-        }
-    }
-    
-    // 从数据库删除
-    bool db_result = db.deleteChannel(channel_id);
-    if (!db_result) {
-        std::cerr << "错误: 通道数据库删除失败" << std::endl;
-        return false;
-    }
-    
+
+    auto next = std::make_shared<ChannelMap>(*current);
+    next->erase(channel_id);
+
+    commit(std::move(next), "删除通道 " + std::to_string(channel_id), [channel_id](Database& db) {
+        return db.deleteChannel(channel_id);
+    });
+
     return true;
 }
 
 bool ChannelManager::updateChannel(int channel_id, const Channel& channel) {
-    auto& db = Database::getInstance();
-    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = registry();
+
     // 检查通道是否存在
-    std::string name, source_url, status, created_at, updated_at;
-    bool enabled, report_enabled;
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
+    auto it = current->find(channel_id);
+    if (it == current->end()) {
         return false; // 通道不存在
     }
-    
+
     int final_id = channel_id;
-    
-    // 如果id被修改了，需要先更新数据库中的id
+
+    // 如果id被修改了，检查新id是否已存在
     if (channel.id != channel_id && channel.id > 0) {
-        // 检查新id是否已存在
-        std::string tmp_name, tmp_source_url, tmp_status, tmp_created_at, tmp_updated_at;
-        bool tmp_enabled, tmp_report_enabled;
-        if (db.loadChannelFromDB(channel.id, tmp_name, tmp_source_url, tmp_status, tmp_enabled, tmp_report_enabled, tmp_created_at, tmp_updated_at)) {
+        if (current->count(channel.id) > 0) {
             return false; // 新id已存在，更新失败
         }
-        
-        // 更新数据库中的id
-        bool db_result = db.updateChannelId(channel_id, channel.id);
-        if (!db_result) {
-            std::cerr << "错误: 通道ID数据库更新失败" << std::endl;
-            return false;
-        }
-        
         final_id = channel.id;
     }
-    
-    updated_at = getCurrentTime();
-    
-    // 更新数据库
-    bool db_result = db.updateChannel(final_id, channel.name, channel.source_url,
-                                      channel.enabled.load(),
-                                      channel.report_enabled.load(), updated_at);
-    if (!db_result) {
-        std::cerr << "错误: 通道数据库更新失败" << std::endl;
-        // 如果之前更新了id，需要回滚
-        if (final_id != channel_id) {
-            db.updateChannelId(final_id, channel_id);
+
+    // 运行状态、创建时间等字段保持不变
+    auto updated = std::make_shared<Channel>(*it->second);
+    updated->id = final_id;
+    updated->name = channel.name;
+    updated->source_url = channel.source_url;
+    updated->enabled = channel.enabled.load();
+    updated->report_enabled = channel.report_enabled.load();
+    updated->updated_at = getCurrentTime();
+
+    auto next = std::make_shared<ChannelMap>(*current);
+    next->erase(channel_id);
+    (*next)[final_id] = updated;
+
+    commit(std::move(next), "更新通道 " + std::to_string(channel_id), [channel_id, updated](Database& db) {
+        // 如果id被修改了，先更新数据库中的id
+        if (updated->id != channel_id && !db.updateChannelId(channel_id, updated->id)) {
+            return false;
         }
-        return false;
-    }
-    
+        return db.updateChannel(updated->id, updated->name, updated->source_url,
+                                updated->enabled.load(), updated->report_enabled.load(),
+                                updated->updated_at);
+    });
+
     return true;
 }
 
 std::shared_ptr<Channel> ChannelManager::getChannel(int channel_id) {
-    auto& db = Database::getInstance();
-    
-    std::string name, source_url, status_str, created_at, updated_at;
-    bool enabled, report_enabled;
-    
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status_str, enabled, report_enabled, created_at, updated_at)) {
+    auto snapshot = getChannelSnapshot(channel_id);
+    if (!snapshot) {
         return nullptr; // 通道不存在
     }
-    
-    auto channel = std::make_shared<Channel>();
-    channel->id = channel_id;
-    channel->name = name;
-    channel->source_url = source_url;
-    channel->status = stringToChannelStatus(status_str);
-    channel->enabled = enabled;
-    channel->report_enabled = report_enabled;
-    channel->created_at = created_at;
-    channel->updated_at = updated_at;
-    
-    return channel;
+    return std::make_shared<Channel>(*snapshot);
 }
 
 std::vector<std::shared_ptr<Channel>> ChannelManager::getAllChannels() {
-    auto& db = Database::getInstance();
-    auto channel_list = db.getAllChannelsFromDB();
-    
+    auto current = registry();
+
     std::vector<std::shared_ptr<Channel>> result;
-    result.reserve(channel_list.size());
-    
-    for (const auto& pair : channel_list) {
-        int channel_id = pair.first;
-        
-        std::string name, source_url, status_str, created_at, updated_at;
-        bool enabled, report_enabled;
-        
-        if (db.loadChannelFromDB(channel_id, name, source_url, status_str, enabled, report_enabled, created_at, updated_at)) {
-            auto channel = std::make_shared<Channel>();
-            channel->id = channel_id;
-            channel->name = name;
-            channel->source_url = source_url;
-            channel->status = stringToChannelStatus(status_str);
-            channel->enabled = enabled;
-            channel->report_enabled = report_enabled;
-            channel->created_at = created_at;
-            channel->updated_at = updated_at;
-            
-            result.push_back(channel);
-        }
+    result.reserve(current->size());
+    for (const auto& pair : *current) {
+        result.push_back(std::make_shared<Channel>(*pair.second));
     }
-    
+
     return result;
 }
 
-bool ChannelManager::startChannel(int channel_id) {
-    auto& db = Database::getInstance();
-    
-    // 检查通道是否存在并获取当前状态
-    std::string name, source_url, status, created_at, updated_at;
-    bool enabled, report_enabled;
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
+std::shared_ptr<const Channel> ChannelManager::getChannelSnapshot(int channel_id) {
+    auto current = registry();
+    auto it = current->find(channel_id);
+    return it != current->end() ? it->second : nullptr;
+}
+
+std::vector<std::shared_ptr<const Channel>> ChannelManager::getChannelSnapshots() {
+    auto current = registry();
+
+    std::vector<std::shared_ptr<const Channel>> result;
+    result.reserve(current->size());
+    for (const auto& pair : *current) {
+        result.push_back(pair.second);
+    }
+
+    return result;
+}
+
+bool ChannelManager::setChannelStatus(int channel_id, ChannelStatus status) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = registry();
+
+    auto it = current->find(channel_id);
+    if (it == current->end()) {
         return false; // 通道不存在
     }
-    
-    // 如果已经是运行状态，直接返回成功
-    if (status == "running") {
+
+    // 状态未变化时不写数据库
+    if (it->second->status == status) {
         return true;
     }
-    
-    // 更新数据库状态
-    std::string new_updated_at = getCurrentTime();
-    bool db_result = db.updateChannelStatus(channel_id, channelStatusToString(ChannelStatus::RUNNING),
-                                            new_updated_at);
-    if (!db_result) {
-        std::cerr << "错误: 通道状态数据库更新失败" << std::endl;
-        return false;
-    }
-    
+
+    auto updated = std::make_shared<Channel>(*it->second);
+    updated->status = status;
+    updated->updated_at = getCurrentTime();
+
+    auto next = std::make_shared<ChannelMap>(*current);
+    (*next)[channel_id] = updated;
+
+    std::string status_str = channelStatusToString(status);
+    std::string updated_at = updated->updated_at;
+    commit(std::move(next), "更新通道 " + std::to_string(channel_id) + " 状态为 " + status_str,
+           [channel_id, status_str, updated_at](Database& db) {
+               return db.updateChannelStatus(channel_id, status_str, updated_at);
+           });
+
     return true;
 }
 
+bool ChannelManager::startChannel(int channel_id) {
+    return setChannelStatus(channel_id, ChannelStatus::RUNNING);
+}
+
 bool ChannelManager::stopChannel(int channel_id) {
-    auto& db = Database::getInstance();
-    
-    // 检查通道是否存在并获取当前状态
-    std::string name, source_url, status, created_at, updated_at;
-    bool enabled, report_enabled;
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
+    auto channel = getChannelSnapshot(channel_id);
+    if (!channel) {
         return false; // 通道不存在
     }
-    
-    // 如果已经是停止状态，直接返回成功
-    if (status != "running") {
+
+    // 如果不是运行状态，直接返回成功
+    if (channel->status != ChannelStatus::RUNNING) {
         return true;
     }
-    
-    // 更新数据库状态
-    std::string new_updated_at = getCurrentTime();
-    bool db_result = db.updateChannelStatus(channel_id, channelStatusToString(ChannelStatus::STOPPED),
-                                            new_updated_at);
-    if (!db_result) {
-        std::cerr << "错误: 通道状态数据库更新失败" << std::endl;
-        return false;
-    }
-    
-    return true;
+
+    return setChannelStatus(channel_id, ChannelStatus::STOPPED);
 }
 
 bool ChannelManager::isChannelRunning(int channel_id) {
-    auto& db = Database::getInstance();
-    
-    std::string name, source_url, status, created_at, updated_at;
-    bool enabled, report_enabled;
-    
-    if (!db.loadChannelFromDB(channel_id, name, source_url, status, enabled, report_enabled, created_at, updated_at)) {
-        return false; // 通道不存在
-    }
-    
-    return status == "running";
+    auto channel = getChannelSnapshot(channel_id);
+    return channel && channel->status == ChannelStatus::RUNNING;
 }
 
 
 } // namespace detector_service
-
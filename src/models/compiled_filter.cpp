@@ -0,0 +1,311 @@
+#include "compiled_filter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace detector_service {
+
+namespace {
+
+// 网格每个方向最多的单元数，决定栅格化的精度与内存占用
+constexpr int kMaxGridCells = 128;
+constexpr int kMinCellSize = 4;
+// fillPoly/polylines 的亚像素精度（坐标左移位数）
+constexpr int kSubPixelShift = 4;
+
+} // namespace
+
+ClassMask::ClassMask(const std::vector<int>& ids) : match_all_(ids.empty()) {
+    int max_id = -1;
+    for (int id : ids) {
+        max_id = std::max(max_id, id);
+    }
+    if (max_id < 0) {
+        return;
+    }
+    bits_.assign(static_cast<size_t>(max_id >> 6) + 1, 0ULL);
+    for (int id : ids) {
+        if (id >= 0) {
+            bits_[static_cast<size_t>(id) >> 6] |= (1ULL << (id & 63));
+        }
+    }
+}
+
+CompiledROI::CompiledROI(const ROI& roi, int frame_width, int frame_height)
+    : id_(roi.id),
+      enabled_(roi.enabled),
+      type_(roi.type),
+      match_mode_(roi.match_mode),
+      min_overlap_ratio_(std::clamp(roi.min_overlap_ratio, 0.0f, 1.0f)),
+      valid_(false),
+      cell_size_(1),
+      grid_cols_(0),
+      grid_rows_(0) {
+    if (frame_width <= 0 || frame_height <= 0) {
+        return;
+    }
+
+    float scale_x = static_cast<float>(frame_width);
+    float scale_y = static_cast<float>(frame_height);
+
+    if (type_ == ROIType::RECTANGLE) {
+        if (roi.points.size() < 2) {
+            return;
+        }
+        float x1 = roi.points[0].x * scale_x;
+        float y1 = roi.points[0].y * scale_y;
+        float x2 = roi.points[1].x * scale_x;
+        float y2 = roi.points[1].y * scale_y;
+        if (x1 > x2) std::swap(x1, x2);
+        if (y1 > y2) std::swap(y1, y2);
+        bounds_ = cv::Rect2f(x1, y1, x2 - x1, y2 - y1);
+        valid_ = true;
+        return;
+    }
+
+    if (roi.points.size() < 3) {
+        return;
+    }
+
+    // 将归一化坐标一次性换算为像素坐标
+    std::vector<cv::Point2f> pixel_points;
+    pixel_points.reserve(roi.points.size());
+    float min_x = scale_x, min_y = scale_y, max_x = 0.0f, max_y = 0.0f;
+    for (const auto& p : roi.points) {
+        cv::Point2f pp(p.x * scale_x, p.y * scale_y);
+        min_x = std::min(min_x, pp.x);
+        min_y = std::min(min_y, pp.y);
+        max_x = std::max(max_x, pp.x);
+        max_y = std::max(max_y, pp.y);
+        pixel_points.push_back(pp);
+    }
+    bounds_ = cv::Rect2f(min_x, min_y, max_x - min_x, max_y - min_y);
+
+    // 预计算边，水平边对射线法没有贡献，直接跳过
+    for (size_t i = 0, j = pixel_points.size() - 1; i < pixel_points.size(); j = i++) {
+        const cv::Point2f& p1 = pixel_points[i];
+        const cv::Point2f& p2 = pixel_points[j];
+        if (p1.y == p2.y) {
+            continue;
+        }
+        edges_.push_back({p1.x, p1.y, p2.y, (p2.x - p1.x) / (p2.y - p1.y)});
+    }
+
+    // 栅格化到低分辨率网格
+    int longest = std::max(frame_width, frame_height);
+    cell_size_ = std::max(kMinCellSize, (longest + kMaxGridCells - 1) / kMaxGridCells);
+    grid_cols_ = (frame_width + cell_size_ - 1) / cell_size_;
+    grid_rows_ = (frame_height + cell_size_ - 1) / cell_size_;
+
+    const float grid_scale = static_cast<float>(1 << kSubPixelShift) / static_cast<float>(cell_size_);
+    std::vector<std::vector<cv::Point>> contour(1);
+    contour[0].reserve(pixel_points.size());
+    for (const auto& pp : pixel_points) {
+        contour[0].emplace_back(static_cast<int>(std::lround(pp.x * grid_scale)),
+                                static_cast<int>(std::lround(pp.y * grid_scale)));
+    }
+
+    cv::Mat filled(grid_rows_, grid_cols_, CV_8UC1, cv::Scalar(0));
+    cv::fillPoly(filled, contour, cv::Scalar(1), cv::LINE_8, kSubPixelShift);
+
+    // 边经过的单元及其邻域标记为边界，保证非边界单元整体位于多边形一侧
+    cv::Mat boundary(grid_rows_, grid_cols_, CV_8UC1, cv::Scalar(0));
+    cv::polylines(boundary, contour, true, cv::Scalar(1), 1, cv::LINE_8, kSubPixelShift);
+    cv::dilate(boundary, boundary, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+
+    grid_ = cv::Mat(grid_rows_, grid_cols_, CV_8UC1, cv::Scalar(CELL_OUTSIDE));
+    for (int r = 0; r < grid_rows_; ++r) {
+        const uchar* f = filled.ptr<uchar>(r);
+        const uchar* b = boundary.ptr<uchar>(r);
+        uchar* g = grid_.ptr<uchar>(r);
+        for (int c = 0; c < grid_cols_; ++c) {
+            if (b[c]) {
+                g[c] = CELL_BOUNDARY;
+            } else if (f[c]) {
+                g[c] = CELL_INSIDE;
+            }
+        }
+    }
+
+    cv::integral(filled, coverage_integral_, CV_32S);
+    valid_ = true;
+}
+
+bool CompiledROI::exactContains(float x, float y) const {
+    bool inside = false;
+    for (const auto& e : edges_) {
+        if (((e.y1 > y) != (e.y2 > y)) &&
+            (x < e.inv_slope * (y - e.y1) + e.x1)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool CompiledROI::containsPoint(float x, float y) const {
+    if (!valid_) {
+        return false;
+    }
+
+    if (x < bounds_.x || x > bounds_.x + bounds_.width ||
+        y < bounds_.y || y > bounds_.y + bounds_.height) {
+        return false;
+    }
+
+    if (type_ == ROIType::RECTANGLE) {
+        return true;
+    }
+
+    int col = std::clamp(static_cast<int>(x) / cell_size_, 0, grid_cols_ - 1);
+    int row = std::clamp(static_cast<int>(y) / cell_size_, 0, grid_rows_ - 1);
+    uchar state = grid_.at<uchar>(row, col);
+    if (state == CELL_BOUNDARY) {
+        return exactContains(x, y);
+    }
+    return state == CELL_INSIDE;
+}
+
+float CompiledROI::overlapRatio(const cv::Rect& bbox) const {
+    if (!valid_ || bbox.width <= 0 || bbox.height <= 0) {
+        return 0.0f;
+    }
+
+    float bx1 = static_cast<float>(bbox.x);
+    float by1 = static_cast<float>(bbox.y);
+    float bx2 = bx1 + static_cast<float>(bbox.width);
+    float by2 = by1 + static_cast<float>(bbox.height);
+
+    float ix1 = std::max(bx1, bounds_.x);
+    float iy1 = std::max(by1, bounds_.y);
+    float ix2 = std::min(bx2, bounds_.x + bounds_.width);
+    float iy2 = std::min(by2, bounds_.y + bounds_.height);
+    if (ix2 <= ix1 || iy2 <= iy1) {
+        return 0.0f;
+    }
+
+    if (type_ == ROIType::RECTANGLE) {
+        return ((ix2 - ix1) * (iy2 - iy1)) / static_cast<float>(bbox.area());
+    }
+
+    // 多边形：在覆盖网格上用积分图统计检测框内被覆盖的单元比例
+    int c0 = std::clamp(static_cast<int>(bx1) / cell_size_, 0, grid_cols_);
+    int r0 = std::clamp(static_cast<int>(by1) / cell_size_, 0, grid_rows_);
+    int c1 = std::clamp((static_cast<int>(std::ceil(bx2)) + cell_size_ - 1) / cell_size_, 0, grid_cols_);
+    int r1 = std::clamp((static_cast<int>(std::ceil(by2)) + cell_size_ - 1) / cell_size_, 0, grid_rows_);
+    int cells = (c1 - c0) * (r1 - r0);
+    if (cells <= 0) {
+        return 0.0f;
+    }
+
+    int covered = coverage_integral_.at<int>(r1, c1) - coverage_integral_.at<int>(r0, c1)
+                - coverage_integral_.at<int>(r1, c0) + coverage_integral_.at<int>(r0, c0);
+    return static_cast<float>(covered) / static_cast<float>(cells);
+}
+
+bool CompiledROI::matches(const cv::Rect& bbox) const {
+    if (!enabled_ || !valid_) {
+        return false;
+    }
+
+    if (match_mode_ == ROIMatchMode::OVERLAP && bbox.width > 0 && bbox.height > 0) {
+        return overlapRatio(bbox) >= min_overlap_ratio_;
+    }
+
+    return containsPoint(bbox.x + bbox.width / 2.0f, bbox.y + bbox.height / 2.0f);
+}
+
+CompiledAlgorithmFilter::CompiledAlgorithmFilter(const AlgorithmConfig& config,
+                                                 int frame_width, int frame_height)
+    : channel_id_(config.channel_id),
+      version_(config.version),
+      frame_width_(frame_width),
+      frame_height_(frame_height),
+      enabled_classes_(config.enabled_classes),
+      // 帧尺寸未知时无法换算ROI坐标，与 applyFilters 一样跳过通道级ROI过滤
+      restrict_to_rois_(!config.rois.empty() && frame_width > 0 && frame_height > 0) {
+    rois_.reserve(config.rois.size());
+    for (const auto& roi : config.rois) {
+        rois_.emplace_back(roi, frame_width, frame_height);
+    }
+
+    rules_.reserve(config.alert_rules.size());
+    for (const auto& rule : config.alert_rules) {
+        CompiledAlertRule compiled;
+        compiled.classes = ClassMask(rule.target_classes);
+        compiled.min_confidence = rule.min_confidence;
+        compiled.enabled = rule.enabled;
+        compiled.restrict_to_rois = !rule.roi_ids.empty();
+        for (int roi_id : rule.roi_ids) {
+            for (size_t i = 0; i < rois_.size(); ++i) {
+                if (rois_[i].id() == roi_id) {
+                    compiled.roi_indices.push_back(i);
+                }
+            }
+        }
+        rules_.push_back(std::move(compiled));
+    }
+}
+
+bool CompiledAlgorithmFilter::inAnyEnabledROI(const cv::Rect& bbox) const {
+    for (const auto& roi : rois_) {
+        if (roi.matches(bbox)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Detection> CompiledAlgorithmFilter::filterDetections(const std::vector<Detection>& detections) const {
+    std::vector<Detection> filtered;
+    filtered.reserve(detections.size());
+
+    for (const auto& detection : detections) {
+        if (!enabled_classes_.test(detection.class_id)) {
+            continue;
+        }
+        if (restrict_to_rois_ && !inAnyEnabledROI(detection.bbox)) {
+            continue;
+        }
+        filtered.push_back(detection);
+    }
+
+    return filtered;
+}
+
+std::vector<Detection> CompiledAlgorithmFilter::evaluateRule(size_t rule_index,
+                                                             const std::vector<Detection>& detections) const {
+    std::vector<Detection> matched;
+    if (rule_index >= rules_.size()) {
+        return matched;
+    }
+
+    const auto& rule = rules_[rule_index];
+    if (!rule.enabled) {
+        return matched;
+    }
+
+    for (const auto& detection : detections) {
+        if (!rule.classes.test(detection.class_id)) {
+            continue;
+        }
+        if (detection.confidence < rule.min_confidence) {
+            continue;
+        }
+        if (rule.restrict_to_rois) {
+            bool in_roi = false;
+            for (size_t idx : rule.roi_indices) {
+                if (rois_[idx].matches(detection.bbox)) {
+                    in_roi = true;
+                    break;
+                }
+            }
+            if (!in_roi) {
+                continue;
+            }
+        }
+        matched.push_back(detection);
+    }
+
+    return matched;
+}
+
+} // namespace detector_service
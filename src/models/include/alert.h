@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <memory>
 #include <map>
 #include <chrono>
@@ -17,21 +18,46 @@ struct AlertRecord {
     int alert_rule_id;           // 触发的告警规则ID
     std::string alert_rule_name;  // 触发的告警规则名称
     std::string image_path;
-    std::string image_data;  // base64 encoded (不存储到数据库，仅用于上报)
+    std::string thumbnail_path;  // 缩略图位置（见 AlertImageStore::saveThumbnail），为空表示未保存缩略图
+    std::shared_ptr<const std::vector<unsigned char>> image_jpeg;      // 告警图片 JPEG，与告警快照共享 (不存储到数据库，仅用于上报)
+    std::shared_ptr<const std::vector<unsigned char>> thumbnail_jpeg;  // 告警图片为目标区域时附带的整帧缩略图 (仅用于上报)
+    bool image_cropped;          // 告警图片是否为目标区域（此时 thumbnail_path 为上报附带的整帧缩略图）
     float confidence;
     std::string detected_objects;  // JSON string
     std::string created_at;
+    int64_t created_ts;         // 创建时间（Unix 秒），用于排序和翻页
     double bbox_x;
     double bbox_y;
     double bbox_w;
     double bbox_h;
-    std::string report_status;  // 上报状态: pending, success, failed
+    std::string report_status;  // 上报状态: pending, success, failed, skipped（通道未开启上报）
     std::string report_url;     // 上报地址
     
-    AlertRecord() : id(0), channel_id(0), alert_rule_id(0), confidence(0.0f),
+    AlertRecord() : id(0), channel_id(0), alert_rule_id(0), image_cropped(false), confidence(0.0f), created_ts(0),
                     bbox_x(0), bbox_y(0), bbox_w(0), bbox_h(0) {}
 };
 
+// 上报发件箱条目：待上报或等待重试的报警，持久化在 report_outbox 表中，重启后继续上报
+struct ReportOutboxEntry {
+    int alert_id = 0;
+    int attempts = 0;              // 已尝试次数
+    int64_t next_attempt_ms = 0;   // 下次尝试时间（Unix 毫秒）
+    std::string last_error;        // 最近一次失败原因
+};
+
+// 报警列表翻页游标：上一页最后一条记录的 (created_ts, id)，下一页从它之后（更早）开始
+struct AlertCursor {
+    int64_t created_ts = 0;
+    int id = 0;
+
+    bool valid() const { return id > 0; }
+
+    // 游标文本格式："<created_ts>-<id>"
+    std::string toString() const;
+    static bool parse(const std::string& text, AlertCursor& cursor);
+    static AlertCursor after(const AlertRecord& alert) { return {alert.created_ts, alert.id}; }
+};
+
 class AlertManager {
 public:
     static AlertManager& getInstance() {
@@ -45,13 +71,16 @@ public:
     bool deleteAlertsByChannel(int channel_id);
     std::vector<AlertRecord> getAlerts(int limit = 100, int offset = 0);
     std::vector<AlertRecord> getAlertsByChannel(int channel_id, int limit = 100, int offset = 0);
+    std::vector<AlertRecord> getAlertsPage(const AlertCursor& cursor, int limit, int channel_id = 0);
     AlertRecord getAlert(int alert_id);
     int getAlertCount();
     int getAlertCountByChannel(int channel_id);
     bool updateAlertReportStatus(int alert_id, const std::string& report_status, const std::string& report_url);
+    std::vector<AlertRecord> getAlertsByReportStatus(const std::string& report_status, int before_id, int limit);
+    int getReportStatusCount(const std::string& report_status);
 
-    // 清理旧数据
-    bool cleanupOldAlerts(int days);
+    // 清理旧数据（按批删除，见 Database::deleteAlertsBefore）
+    int deleteAlertsBefore(int64_t cutoff_ts, int limit, std::vector<std::string>& image_paths);
     
     // 检查告警规则是否在抑制窗口内（防止重复告警）
     bool isAlertSuppressed(int channel_id, int rule_id, int suppression_window_seconds);
@@ -3,6 +3,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 #include "image_utils.h"
 
@@ -14,6 +17,12 @@ enum class ROIType {
     POLYGON     // 多边形
 };
 
+// ROI命中判定方式
+enum class ROIMatchMode {
+    CENTER,   // 检测框中心点落在ROI内
+    OVERLAP   // 检测框与ROI的重叠面积占检测框面积的比例达到阈值
+};
+
 // ROI区域结构
 struct ROI {
     int id;
@@ -21,10 +30,16 @@ struct ROI {
     std::string name;
     bool enabled;
     std::vector<cv::Point2f> points;  // 对于矩形，使用前两个点作为左上和右下
+    ROIMatchMode match_mode;          // 命中判定方式
+    float min_overlap_ratio;          // OVERLAP模式下的最小重叠比例（0-1）
     
-    ROI() : id(0), type(ROIType::RECTANGLE), enabled(true) {}
+    ROI() : id(0), type(ROIType::RECTANGLE), enabled(true),
+            match_mode(ROIMatchMode::CENTER), min_overlap_ratio(0.5f) {}
 };
 
+// 告警规则滑动窗口的最大长度（检测次数）
+constexpr int kMaxRuleWindowSize = 1000;
+
 // 告警规则结构
 struct AlertRule {
     int id;
@@ -37,8 +52,15 @@ struct AlertRule {
     int suppression_window_seconds;    // 告警抑制时间窗口（秒），相同告警在此时间内只触发一次
     std::vector<int> roi_ids;         // 关联的ROI ID列表，空表示全图
     
+    // 时序条件（在每次检测后增量更新，默认值等同于单帧判定）
+    int window_size;                   // 滑动窗口长度：最近 M 次检测
+    int min_hits;                      // 窗口内至少 N 次检测满足条件才视为命中
+    int min_duration_seconds;          // 持续命中至少 T 秒才告警（配合 roi_ids 即为区域内停留时长），0表示不要求
+    int count_delta;                   // 大于0时改为判定数量变化：当前数量与 M 次检测前相差至少 Δ（忽略最小/最大数量）
+    
     AlertRule() : id(0), enabled(true), min_confidence(0.5f), 
-                  min_count(1), max_count(0), suppression_window_seconds(60) {}
+                  min_count(1), max_count(0), suppression_window_seconds(60),
+                  window_size(1), min_hits(1), min_duration_seconds(0), count_delta(0) {}
 };
 
 // 算法配置结构（每个通道一个）
@@ -55,6 +77,7 @@ struct AlgorithmConfig {
     std::vector<AlertRule> alert_rules;  // 告警规则列表
     std::string created_at;
     std::string updated_at;
+    uint64_t version;                    // 配置版本（仅内存中使用，每次保存/删除递增）
     
     AlgorithmConfig() : channel_id(0), 
                        model_path("yolov11n.onnx"),
@@ -62,9 +85,12 @@ struct AlgorithmConfig {
                        nms_threshold(0.45f),
                        input_width(640),
                        input_height(640),
-                       detection_interval(3) {}
+                       detection_interval(3),
+                       version(0) {}
 };
 
+class CompiledAlgorithmFilter;
+
 // 算法配置管理器
 class AlgorithmConfigManager {
 public:
@@ -76,6 +102,9 @@ public:
     // 获取通道的算法配置
     bool getAlgorithmConfig(int channel_id, AlgorithmConfig& config);
     
+    // 获取通道算法配置的只读快照（内存缓存，保存/删除时失效），供每帧调用的热路径使用
+    std::shared_ptr<const AlgorithmConfig> getAlgorithmConfigSnapshot(int channel_id);
+    
     // 保存通道的算法配置
     bool saveAlgorithmConfig(const AlgorithmConfig& config);
     
@@ -88,6 +117,19 @@ public:
     // 验证配置有效性
     bool validateConfig(const AlgorithmConfig& config, std::string& error_msg);
     
+    // 获取通道当前的配置版本
+    uint64_t getConfigVersion(int channel_id);
+    
+    // 获取按配置版本和帧尺寸预编译的过滤器（按通道缓存，版本或尺寸变化时重建）
+    std::shared_ptr<const CompiledAlgorithmFilter> getCompiledFilter(
+        const AlgorithmConfig& config, int frame_width, int frame_height);
+    
+    static std::string roiMatchModeToString(ROIMatchMode mode);
+    static ROIMatchMode stringToROIMatchMode(const std::string& mode);
+    
+    // 检查匹配数量是否满足规则的数量条件
+    static bool isRuleCountSatisfied(const AlertRule& rule, size_t matched_count);
+    
     // 检查点是否在ROI内
     // frame_width和frame_height用于将归一化的ROI坐标转换为像素坐标
     static bool isPointInROI(const cv::Point2f& point, const ROI& roi, int frame_width, int frame_height);
@@ -120,6 +162,21 @@ private:
     ~AlgorithmConfigManager() = default;
     AlgorithmConfigManager(const AlgorithmConfigManager&) = delete;
     AlgorithmConfigManager& operator=(const AlgorithmConfigManager&) = delete;
+    
+    void bumpConfigVersion(int channel_id);
+    
+    // 从数据库加载配置，不存在时返回默认配置
+    bool loadAlgorithmConfig(int channel_id, AlgorithmConfig& config);
+    
+    std::mutex config_cache_mutex_;
+    std::map<int, std::shared_ptr<const AlgorithmConfig>> config_cache_;
+    
+    std::mutex version_mutex_;
+    uint64_t next_version_ = 1;
+    std::map<int, uint64_t> config_versions_;
+    
+    std::mutex filter_cache_mutex_;
+    std::map<int, std::shared_ptr<const CompiledAlgorithmFilter>> filter_cache_;
 };
 
 } // namespace detector_service
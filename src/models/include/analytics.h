@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace detector_service {
+
+// 区域客流统计的分钟桶（每个通道、每个ROI、每分钟一条）
+struct AnalyticsBucket {
+    int channel_id = 0;
+    int roi_id = 0;
+    int64_t minute_ts = 0;      // 分钟起始时间（Unix 秒）
+    int entries = 0;            // 进入区域的目标数
+    int exits = 0;              // 离开区域的目标数
+    int max_occupancy = 0;      // 区域内的最大目标数
+    int64_t occupancy_sum = 0;  // 每次检测时区域内目标数之和，除以 samples 即平均人数
+    int samples = 0;            // 检测次数
+
+    double avgOccupancy() const {
+        return samples > 0 ? static_cast<double>(occupancy_sum) / samples : 0.0;
+    }
+
+    // 合并同一分钟的另一份统计（服务重启前后的同一分钟、内存中尚未落库的部分）
+    void merge(const AnalyticsBucket& other) {
+        entries += other.entries;
+        exits += other.exits;
+        max_occupancy = max_occupancy > other.max_occupancy ? max_occupancy : other.max_occupancy;
+        occupancy_sum += other.occupancy_sum;
+        samples += other.samples;
+    }
+};
+
+} // namespace detector_service
@@ -4,9 +4,17 @@
 #include <atomic>
 #include <memory>
 #include <vector>
+#include <map>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <functional>
+#include <condition_variable>
 
 namespace detector_service {
 
+class Database;
+
 enum class ChannelStatus {
     IDLE,
     RUNNING,
@@ -45,6 +53,9 @@ struct Channel {
           updated_at(other.updated_at) {}
 };
 
+// 通道管理器
+// 内存中的通道表是唯一数据源，启动时从数据库加载一次；
+// 所有修改先更新内存，再按顺序由后台线程异步写回数据库，读取不访问数据库
 class ChannelManager {
 public:
     static ChannelManager& getInstance() {
@@ -52,23 +63,62 @@ public:
         return instance;
     }
 
+    // 启动时从数据库加载全部通道（数据库初始化之后调用）
+    bool loadChannels();
+    
     // 通道增删改查
     int createChannel(const Channel& channel);
     bool deleteChannel(int channel_id);
     bool updateChannel(int channel_id, const Channel& channel);
+    // 返回通道的可修改副本
     std::shared_ptr<Channel> getChannel(int channel_id);
     std::vector<std::shared_ptr<Channel>> getAllChannels();
     
+    // 获取通道的只读快照（无锁读取，不拷贝），供每帧调用的热路径和查询接口使用
+    std::shared_ptr<const Channel> getChannelSnapshot(int channel_id);
+    std::vector<std::shared_ptr<const Channel>> getChannelSnapshots();
+    
     // 通道状态管理
     bool startChannel(int channel_id);
     bool stopChannel(int channel_id);
     bool isChannelRunning(int channel_id);
+    // 设置通道运行状态（拉流线程调用）
+    bool setChannelStatus(int channel_id, ChannelStatus status);
+    
+    // 等待所有挂起的数据库写入完成
+    void flushWrites();
 
 private:
-    ChannelManager() = default;
-    ~ChannelManager() = default;
+    ChannelManager();
+    ~ChannelManager();
     ChannelManager(const ChannelManager&) = delete;
     ChannelManager& operator=(const ChannelManager&) = delete;
+    
+    using ChannelMap = std::map<int, std::shared_ptr<const Channel>>;
+    
+    // 读取当前通道表（原子加载，修改时整表复制后替换）
+    std::shared_ptr<const ChannelMap> registry() const;
+    // 替换通道表并提交对应的数据库写入（调用方需持有 write_mutex_，保证写入顺序与内存修改一致）
+    void commit(std::shared_ptr<const ChannelMap> next, const std::string& description,
+                std::function<bool(Database&)> write);
+    
+    void writeWorker();
+    
+    std::shared_ptr<const ChannelMap> registry_;
+    std::mutex write_mutex_;  // 串行化所有修改
+    
+    // 异步写回数据库
+    struct PendingWrite {
+        std::string description;
+        std::function<bool(Database&)> apply;
+    };
+    std::deque<PendingWrite> write_queue_;
+    size_t writes_in_flight_ = 0;  // 已入队但尚未写完的数量
+    std::mutex write_queue_mutex_;
+    std::condition_variable write_queue_cv_;
+    std::condition_variable write_done_cv_;
+    bool write_worker_running_ = true;
+    std::thread write_worker_thread_;
 };
 
 } // namespace detector_service
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "algorithm_config.h"
+#include "image_utils.h"
+
+namespace detector_service {
+
+// 类别位图：替代 enabled_classes / target_classes 的线性查找
+class ClassMask {
+public:
+    ClassMask() = default;
+
+    // ids 为空表示匹配所有类别
+    explicit ClassMask(const std::vector<int>& ids);
+
+    bool test(int class_id) const {
+        if (match_all_) {
+            return true;
+        }
+        if (class_id < 0) {
+            return false;
+        }
+        size_t word = static_cast<size_t>(class_id) >> 6;
+        if (word >= bits_.size()) {
+            return false;
+        }
+        return (bits_[word] >> (class_id & 63)) & 1ULL;
+    }
+
+    bool matchAll() const { return match_all_; }
+
+private:
+    std::vector<uint64_t> bits_;
+    bool match_all_ = true;
+};
+
+// 预编译的ROI：坐标已换算为像素坐标，并栅格化为低分辨率占用网格
+// 网格单元分为三种状态：完全在外 / 完全在内 / 边界（边界单元再做精确射线检测）
+class CompiledROI {
+public:
+    CompiledROI(const ROI& roi, int frame_width, int frame_height);
+
+    int id() const { return id_; }
+    bool enabled() const { return enabled_; }
+
+    // O(1) 点包含判断（边界单元回退到精确判断）
+    bool containsPoint(float x, float y) const;
+
+    // 检测框与ROI的重叠面积占检测框面积的比例（0-1）
+    // 矩形ROI为精确值，多边形ROI按网格分辨率近似
+    float overlapRatio(const cv::Rect& bbox) const;
+
+    // 按ROI的匹配模式判断检测框是否命中
+    bool matches(const cv::Rect& bbox) const;
+
+private:
+    enum CellState : uint8_t {
+        CELL_OUTSIDE = 0,
+        CELL_INSIDE = 1,
+        CELL_BOUNDARY = 2
+    };
+
+    // 预计算的多边形边（用于射线法）
+    struct Edge {
+        float x1, y1, y2;
+        float inv_slope;  // dx/dy
+    };
+
+    bool exactContains(float x, float y) const;
+
+    int id_;
+    bool enabled_;
+    ROIType type_;
+    ROIMatchMode match_mode_;
+    float min_overlap_ratio_;
+    bool valid_;
+
+    cv::Rect2f bounds_;         // 像素坐标下的外接矩形
+    std::vector<Edge> edges_;   // 仅多边形使用
+
+    int cell_size_;             // 网格单元边长（像素）
+    int grid_cols_;
+    int grid_rows_;
+    cv::Mat grid_;              // CV_8U，CellState
+    cv::Mat coverage_integral_; // CV_32S，网格覆盖的积分图，用于重叠比例计算
+};
+
+// 预编译的告警规则
+struct CompiledAlertRule {
+    ClassMask classes;
+    float min_confidence = 0.0f;
+    bool enabled = true;
+    bool restrict_to_rois = false;  // roi_ids 非空时为 true
+    std::vector<size_t> roi_indices; // 指向 CompiledAlgorithmFilter::rois_ 的下标
+};
+
+// 按配置版本和帧尺寸预编译的过滤器
+// 构建一次后只读，可在多个线程间共享
+class CompiledAlgorithmFilter {
+public:
+    CompiledAlgorithmFilter(const AlgorithmConfig& config, int frame_width, int frame_height);
+
+    int channelId() const { return channel_id_; }
+    uint64_t version() const { return version_; }
+    bool matchesSize(int frame_width, int frame_height) const {
+        return frame_width_ == frame_width && frame_height_ == frame_height;
+    }
+
+    // 应用通道级过滤（enabled_classes + ROI），语义与 applyFilters 一致
+    std::vector<Detection> filterDetections(const std::vector<Detection>& detections) const;
+
+    // 评估第 rule_index 条告警规则，返回满足条件的检测结果，语义与 evaluateAlertRule 一致
+    std::vector<Detection> evaluateRule(size_t rule_index, const std::vector<Detection>& detections) const;
+
+    size_t ruleCount() const { return rules_.size(); }
+
+    // 预编译的ROI，与 AlgorithmConfig::rois 一一对应
+    const std::vector<CompiledROI>& rois() const { return rois_; }
+
+private:
+    bool inAnyEnabledROI(const cv::Rect& bbox) const;
+
+    int channel_id_;
+    uint64_t version_;
+    int frame_width_;
+    int frame_height_;
+
+    ClassMask enabled_classes_;
+    bool restrict_to_rois_;
+    std::vector<CompiledROI> rois_;
+    std::vector<CompiledAlertRule> rules_;
+};
+
+} // namespace detector_service
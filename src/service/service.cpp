@@ -1,6 +1,9 @@
 #include "service.h"
 #include "database.h"
 #include "channel.h"
+#include "alert_retention.h"
+#include "alert_image_store.h"
+#include "report_service.h"
 #include "frame_callback.h"
 #include "channel_api.h"
 #include "alert_api.h"
@@ -9,6 +12,7 @@
 #include "ws_api.h"
 #include "report_config_api.h"
 #include "gb28181_config_api.h"
+#include "analytics_api.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -27,6 +31,21 @@ void initializeConfig(Config& config) {
     
     ServerConfig server_config;
     config.setServerConfig(server_config);
+    
+    StreamConfig stream_config;
+    config.setStreamConfig(stream_config);
+    
+    AlertConfig alert_config;
+    config.setAlertConfig(alert_config);
+    
+    ReportDeliveryConfig report_delivery_config;
+    config.setReportDeliveryConfig(report_delivery_config);
+    
+    TrackerConfig tracker_config;
+    config.setTrackerConfig(tracker_config);
+    
+    AnalyticsConfig analytics_config;
+    config.setAnalyticsConfig(analytics_config);
 }
 
 bool initializeDatabase(Config& config) {
@@ -36,6 +55,43 @@ bool initializeDatabase(Config& config) {
         return false;
     }
     
+    // 加载通道表，之后的通道读取均在内存中完成
+    if (!ChannelManager::getInstance().loadChannels()) {
+        std::cerr << "加载通道失败" << std::endl;
+        return false;
+    }
+    
+    // 后台分批清理过期报警
+    AlertRetentionService::getInstance().start();
+    
+    // 启动报警上报线程，继续投递上次退出时发件箱中未完成的上报
+    const auto& delivery_config = config.getReportDeliveryConfig();
+    ReportDeliveryOptions delivery_options;
+    delivery_options.workers = delivery_config.workers;
+    delivery_options.batch_size = delivery_config.batch_size;
+    delivery_options.max_attempts = delivery_config.max_attempts;
+    delivery_options.retry_base_ms = delivery_config.retry_base_ms;
+    delivery_options.retry_max_ms = delivery_config.retry_max_ms;
+    delivery_options.http_timeout_seconds = delivery_config.http_timeout_seconds;
+    delivery_options.mqtt_max_inflight = delivery_config.mqtt_max_inflight;
+    delivery_options.mqtt_ack_timeout_seconds = delivery_config.mqtt_ack_timeout_seconds;
+    switch (delivery_config.image_mode) {
+        case ReportImageMode::RAW:
+            delivery_options.image_mode = ReportDeliveryOptions::ImageMode::RAW;
+            break;
+        case ReportImageMode::URL:
+            delivery_options.image_mode = ReportDeliveryOptions::ImageMode::URL;
+            break;
+        default:
+            delivery_options.image_mode = ReportDeliveryOptions::ImageMode::BASE64;
+            break;
+    }
+    delivery_options.image_base_url = delivery_config.image_base_url;
+    delivery_options.image_loader = [](const std::string& location) {
+        return AlertImageStore::getInstance().load(location);
+    };
+    ReportService::getInstance().start(delivery_options);
+    
     return true;
 }
 
@@ -162,6 +218,7 @@ void setupAllRoutes(LwsServer& svr, const AppContext& context) {
     setupReportConfigRoutes(svr);
     setupAlgorithmConfigRoutes(svr);
     setupGB28181ConfigRoutes(svr);
+    setupAnalyticsRoutes(svr);
     setupModelRoutes(svr);
     setupWebSocketRoutes(svr);
     
@@ -252,6 +309,7 @@ int startService() {
     
     // 设置帧回调函数
     stream_manager.setFrameCallback(processFrameCallback);
+    stream_manager.setPacketCallback(processPacketCallback);
     
     // 创建 HTTP 服务器并设置路由
     LwsServer svr;
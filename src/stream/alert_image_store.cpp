@@ -0,0 +1,379 @@
+#include "alert_image_store.h"
+#include "config.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace detector_service {
+
+namespace {
+
+constexpr const char* kPackFileName = "thumbnails.pack";
+constexpr size_t kHashLength = 16;
+
+// 图片内容哈希（FNV-1a 64 位），作为文件名的一部分和 ETag
+std::string contentHash(const std::vector<uchar>& data) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (uchar byte : data) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setw(kHashLength) << std::setfill('0') << hash;
+    return oss.str();
+}
+
+bool isDigits(const std::string& text, size_t length) {
+    return text.size() == length &&
+           std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+bool isContentHash(const std::string& text) {
+    return text.size() == kHashLength &&
+           std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isxdigit(c); });
+}
+
+bool writeAll(int fd, const uchar* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void fsyncPath(const std::string& path, int flags) {
+    int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+    if (fd < 0) {
+        return;  // 文件已被清理
+    }
+    ::fsync(fd);
+    ::close(fd);
+}
+
+} // namespace
+
+AlertImageStore::AlertImageStore() {
+    const auto& alert_config = Config::getInstance().getAlertConfig();
+    root_ = alert_config.image_dir.empty() ? "alerts" : alert_config.image_dir;
+    thumbnail_pack_ = alert_config.thumbnail_pack;
+    sync_interval_ms_ = std::max(0, alert_config.image_sync_interval_ms);
+
+    if (sync_interval_ms_ > 0) {
+        sync_thread_ = std::thread(&AlertImageStore::syncWorker, this);
+    }
+}
+
+AlertImageStore::~AlertImageStore() {
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        running_ = false;
+    }
+    sync_cv_.notify_all();
+
+    if (sync_thread_.joinable()) {
+        sync_thread_.join();
+    }
+    sync();
+
+    if (pack_fd_ >= 0) {
+        ::close(pack_fd_);
+    }
+}
+
+std::string AlertImageStore::dayOf(std::time_t time) {
+    std::tm tm_time{};
+    localtime_r(&time, &tm_time);
+    char day[16];
+    std::strftime(day, sizeof(day), "%Y%m%d", &tm_time);
+    return day;
+}
+
+bool AlertImageStore::ensureDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(dirs_mutex_);
+    if (known_dirs_.count(dir) > 0) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "创建告警图片目录失败: " << dir << ": " << ec.message() << std::endl;
+        return false;
+    }
+    known_dirs_.insert(dir);
+
+    // 新建目录在上级目录中的目录项也需要同步
+    std::filesystem::path created(dir);
+    std::filesystem::path root(root_);
+    while (created != root && created.has_parent_path()) {
+        created = created.parent_path();
+        scheduleSync("", created.string());
+    }
+    return true;
+}
+
+void AlertImageStore::scheduleSync(const std::string& file, const std::string& dir) {
+    if (sync_interval_ms_ <= 0) {
+        return;  // 不主动 fsync，由系统回写
+    }
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    if (!file.empty()) {
+        pending_files_.insert(file);
+    }
+    if (!dir.empty()) {
+        pending_dirs_.insert(dir);
+    }
+}
+
+std::string AlertImageStore::saveImage(int channel_id, const AlertSnapshot::Buffer& jpeg) {
+    if (!jpeg || jpeg->empty()) {
+        return "";
+    }
+
+    std::time_t now = std::time(nullptr);
+    std::string dir = root_ + "/" + dayOf(now) + "/" + std::to_string(channel_id);
+    if (!ensureDirectory(dir)) {
+        return "";
+    }
+
+    // 文件名为 <时分秒>_<序号>_<内容哈希>，每条告警一个文件：同一画面的多条告警不共用文件，
+    // 按记录删除过期图片时不会删掉其他告警仍在使用的图片
+    std::tm tm_time{};
+    localtime_r(&now, &tm_time);
+    char time_part[8];
+    std::strftime(time_part, sizeof(time_part), "%H%M%S", &tm_time);
+    std::string path = dir + "/" + time_part + "_" + std::to_string(sequence_++) + "_" +
+                       contentHash(*jpeg) + ".jpg";
+
+    // 先写临时文件并 fsync 再改名：读取方只会看到完整的图片，掉电后改名后的文件也不会只有部分内容
+    // （改名本身所在的目录项仍由后台线程批量同步，掉电时最多丢失图片，不会出现内容不完整的图片）
+    std::error_code ec;
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "创建告警图片失败: " << temp_path << std::endl;
+        return "";
+    }
+    bool written = writeAll(fd, jpeg->data(), jpeg->size()) && (sync_interval_ms_ <= 0 || ::fsync(fd) == 0);
+    written = ::close(fd) == 0 && written;
+    if (!written) {
+        std::cerr << "写入告警图片失败: " << temp_path << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return "";
+    }
+
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        std::cerr << "保存告警图片失败: " << path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return "";
+    }
+
+    scheduleSync("", dir);
+    return path;
+}
+
+std::string AlertImageStore::saveThumbnail(const AlertSnapshot::Buffer& jpeg) {
+    if (!thumbnail_pack_ || !jpeg || jpeg->empty()) {
+        return "";
+    }
+
+    std::string day = dayOf(std::time(nullptr));
+    std::lock_guard<std::mutex> lock(pack_mutex_);
+
+    // 每天一个打包文件，跨天时切换
+    if (pack_fd_ < 0 || day != pack_day_) {
+        if (pack_fd_ >= 0) {
+            ::close(pack_fd_);
+            pack_fd_ = -1;
+        }
+
+        std::string dir = root_ + "/" + day;
+        if (!ensureDirectory(dir)) {
+            return "";
+        }
+        pack_path_ = dir + "/" + kPackFileName;
+        pack_fd_ = ::open(pack_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (pack_fd_ < 0) {
+            std::cerr << "打开缩略图打包文件失败: " << pack_path_ << std::endl;
+            return "";
+        }
+
+        struct stat st{};
+        pack_size_ = ::fstat(pack_fd_, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+        pack_day_ = day;
+        scheduleSync("", dir);
+    }
+
+    uint64_t offset = pack_size_;
+    if (!writeAll(pack_fd_, jpeg->data(), jpeg->size())) {
+        // 截掉写了一半的数据，保证已有定位符仍然有效
+        if (::ftruncate(pack_fd_, static_cast<off_t>(offset)) != 0) {
+            std::cerr << "截断缩略图打包文件失败: " << pack_path_ << std::endl;
+        }
+        std::cerr << "写入缩略图打包文件失败: " << pack_path_ << std::endl;
+        return "";
+    }
+    pack_size_ += jpeg->size();
+
+    scheduleSync(pack_path_, "");
+    return pack_path_ + "#" + std::to_string(offset) + "+" + std::to_string(jpeg->size());
+}
+
+bool AlertImageStore::locate(const std::string& location, StoredImage& image) const {
+    std::error_code ec;
+
+    size_t separator = location.rfind('#');
+    if (separator != std::string::npos) {
+        // 打包文件中的缩略图："<打包文件>#<偏移>+<长度>"
+        std::istringstream iss(location.substr(separator + 1));
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        char plus = 0;
+        if (!(iss >> offset >> plus >> length) || plus != '+' || !iss.eof() || length == 0) {
+            return false;
+        }
+
+        image.file = location.substr(0, separator);
+        uint64_t file_size = std::filesystem::file_size(image.file, ec);
+        if (ec || offset + length > file_size) {
+            return false;
+        }
+        image.offset = offset;
+        image.length = length;
+
+        // 打包文件只追加，同一偏移的内容不会改变
+        std::string day = std::filesystem::path(image.file).parent_path().filename().string();
+        image.etag = "\"" + day + "-" + std::to_string(offset) + "\"";
+        return true;
+    }
+
+    image.file = location;
+    image.offset = 0;
+    image.length = std::filesystem::file_size(image.file, ec);
+    if (ec || image.length == 0) {
+        return false;
+    }
+
+    std::string stem = std::filesystem::path(image.file).stem().string();
+    size_t underscore = stem.rfind('_');
+    std::string hash = underscore == std::string::npos ? "" : stem.substr(underscore + 1);
+    if (isContentHash(hash)) {
+        image.etag = "\"" + hash + "\"";
+    } else {
+        // 旧版平铺目录下的图片，按大小和修改时间生成
+        auto mtime = std::filesystem::last_write_time(image.file, ec);
+        image.etag = "\"" + std::to_string(image.length) + "-" +
+                     std::to_string(ec ? 0 : mtime.time_since_epoch().count()) + "\"";
+    }
+    return true;
+}
+
+AlertSnapshot::Buffer AlertImageStore::load(const std::string& location) const {
+    StoredImage image;
+    if (!locate(location, image)) {
+        return nullptr;
+    }
+    std::ifstream file(image.file, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    file.seekg(static_cast<std::streamoff>(image.offset));
+    std::vector<uchar> data(static_cast<size_t>(image.length));
+    if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+        return nullptr;
+    }
+    return std::make_shared<const std::vector<uchar>>(std::move(data));
+}
+
+size_t AlertImageStore::removeDaysBefore(int64_t cutoff_ts) {
+    std::string cutoff_day = dayOf(static_cast<std::time_t>(cutoff_ts));
+
+    std::vector<std::filesystem::path> expired;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(root_, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (isDigits(name, 8) && name < cutoff_day && it->is_directory(ec)) {
+            expired.push_back(it->path());
+        }
+    }
+    if (expired.empty()) {
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pack_mutex_);
+        if (pack_fd_ >= 0 && pack_day_ < cutoff_day) {
+            ::close(pack_fd_);
+            pack_fd_ = -1;
+            pack_day_.clear();
+        }
+    }
+
+    size_t removed = 0;
+    for (const auto& day_dir : expired) {
+        std::filesystem::remove_all(day_dir, ec);
+        if (ec) {
+            std::cerr << "删除过期告警图片目录失败: " << day_dir.string() << ": " << ec.message() << std::endl;
+            continue;
+        }
+        removed++;
+
+        // 目录被删除后需要重新创建
+        std::string prefix = root_ + "/" + day_dir.filename().string();
+        std::lock_guard<std::mutex> lock(dirs_mutex_);
+        for (auto it = known_dirs_.lower_bound(prefix);
+             it != known_dirs_.end() && it->compare(0, prefix.size(), prefix) == 0;) {
+            it = known_dirs_.erase(it);
+        }
+    }
+    return removed;
+}
+
+void AlertImageStore::sync() {
+    std::set<std::string> files;
+    std::set<std::string> dirs;
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        files.swap(pending_files_);
+        dirs.swap(pending_dirs_);
+    }
+
+    // 先同步文件内容，再同步目录项（使改名持久化）
+    for (const auto& file : files) {
+        fsyncPath(file, O_RDONLY);
+    }
+    for (const auto& dir : dirs) {
+        fsyncPath(dir, O_RDONLY | O_DIRECTORY);
+    }
+}
+
+void AlertImageStore::syncWorker() {
+    auto interval = std::chrono::milliseconds(sync_interval_ms_);
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    while (running_) {
+        sync_cv_.wait_for(lock, interval, [this] { return !running_; });
+        lock.unlock();
+        sync();
+        lock.lock();
+    }
+}
+
+} // namespace detector_service
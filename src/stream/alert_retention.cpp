@@ -0,0 +1,121 @@
+#include "alert_retention.h"
+#include "alert.h"
+#include "alert_image_store.h"
+#include "database.h"
+#include "config.h"
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <vector>
+#include <string>
+
+namespace detector_service {
+
+AlertRetentionService::AlertRetentionService() {
+    // 先构造数据库和图片存储单例，保证清理线程退出前它们不会被析构
+    Database::getInstance();
+    AlertImageStore::getInstance();
+}
+
+AlertRetentionService::~AlertRetentionService() {
+    stop();
+}
+
+void AlertRetentionService::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    if (Config::getInstance().getDatabaseConfig().max_storage_days <= 0) {
+        return;  // 未配置保留天数，不清理
+    }
+    running_ = true;
+    thread_ = std::thread(&AlertRetentionService::worker, this);
+}
+
+void AlertRetentionService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t AlertRetentionService::purgeBefore(int64_t cutoff_ts, bool& finished) {
+    const auto& db_config = Config::getInstance().getDatabaseConfig();
+    int batch_size = std::max(1, db_config.retention_batch_size);
+    auto pause = std::chrono::milliseconds(std::max(0, db_config.retention_batch_pause_ms));
+
+    auto& alert_manager = AlertManager::getInstance();
+    uint64_t total = 0;
+    finished = false;
+    while (true) {
+        std::vector<std::string> image_paths;
+        int deleted = alert_manager.deleteAlertsBefore(cutoff_ts, batch_size, image_paths);
+        if (deleted <= 0) {
+            finished = deleted == 0;
+            break;
+        }
+        total += deleted;
+
+        // 记录已提交删除后再删文件，删除失败只会留下孤立文件，不会出现记录指向不存在的图片
+        for (const auto& path : image_paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+
+        if (deleted < batch_size) {
+            finished = true;  // 已清理完
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (cv_.wait_for(lock, pause, [this] { return !running_; })) {
+            break;  // 服务停止，剩余部分下一次启动后再清理
+        }
+    }
+    return total;
+}
+
+void AlertRetentionService::worker() {
+    while (true) {
+        const auto& db_config = Config::getInstance().getDatabaseConfig();
+        int64_t cutoff_ts = static_cast<int64_t>(std::time(nullptr)) -
+                            static_cast<int64_t>(db_config.max_storage_days) * 24 * 3600;
+
+        auto start = std::chrono::steady_clock::now();
+        bool finished = false;
+        uint64_t deleted = purgeBefore(cutoff_ts, finished);
+        if (finished) {
+            // 过期报警已全部删除，整天的图片目录（包括缩略图打包文件）可以直接删除
+            AlertImageStore::getInstance().removeDaysBefore(cutoff_ts);
+            // 客流分钟统计与报警保留相同天数
+            if (Database::getInstance().deleteAnalyticsBefore(cutoff_ts) > 0 && deleted == 0) {
+                Database::getInstance().incrementalVacuum(db_config.retention_vacuum_pages);
+            }
+        }
+        if (deleted > 0) {
+            // 删除后回收部分空闲页，每轮回收量有上限，避免长时间占用写连接
+            Database::getInstance().incrementalVacuum(db_config.retention_vacuum_pages);
+
+            auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "已清理 " << db_config.max_storage_days << " 天前的报警 " << deleted
+                      << " 条，耗时 " << elapsed_ms << " ms" << std::endl;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto interval = std::chrono::seconds(std::max(1, db_config.retention_interval_seconds));
+        if (cv_.wait_for(lock, interval, [this] { return !running_; })) {
+            break;
+        }
+    }
+}
+
+} // namespace detector_service
@@ -0,0 +1,234 @@
+#include "alert_worker_pool.h"
+#include "ws_handler.h"
+#include "alert.h"
+#include "report_config.h"
+#include "report_service.h"
+#include "config.h"
+#include "alert_snapshot.h"
+#include "alert_image_store.h"
+#include <iostream>
+#include <chrono>
+
+namespace detector_service {
+
+namespace {
+
+// 处理耗时平滑系数
+constexpr double kProcessTimeSmoothing = 0.2;
+
+} // namespace
+
+AlertWorkerPool::AlertWorkerPool() {
+    // 先构造依赖的单例，保证它们在线程池之后析构（析构时仍需处理队列中剩余的告警）
+    AlertManager::getInstance();
+    AlertImageStore::getInstance();
+    ReportService::getInstance();
+    WebSocketHandler::getInstance();
+    
+    const auto& alert_config = Config::getInstance().getAlertConfig();
+    int thread_count = std::max(1, alert_config.worker_threads);
+
+    stats_.workers = thread_count;
+    stats_.queue_capacity = std::max<size_t>(1, alert_config.queue_size);
+
+    for (int i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&AlertWorkerPool::worker, this);
+    }
+}
+
+AlertWorkerPool::~AlertWorkerPool() {
+    // 停止工作线程（队列中剩余的告警处理完后退出）
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+bool AlertWorkerPool::submit(AlertTask task) {
+    const auto& alert_config = Config::getInstance().getAlertConfig();
+    size_t capacity = std::max<size_t>(1, alert_config.queue_size);
+
+    bool accepted = true;
+    bool dropped = false;
+    AlertTask evicted;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queue_.size() >= capacity) {
+            dropped = true;
+            if (alert_config.overflow_policy == AlertOverflowPolicy::DROP_OLDEST) {
+                evicted = std::move(queue_.front());
+                queue_.pop_front();
+            } else {
+                accepted = false;
+            }
+        }
+        if (accepted) {
+            queue_.push_back(std::move(task));
+        }
+    }
+    if (accepted) {
+        queue_cv_.notify_one();
+    }
+    if (evicted.on_dropped) {
+        evicted.on_dropped();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.submitted++;
+        if (dropped) {
+            // 告警风暴时只记录首次丢弃，避免刷屏
+            if (stats_.dropped == 0) {
+                std::cerr << "告警处理队列已满（" << capacity << "），开始丢弃告警" << std::endl;
+            }
+            stats_.dropped++;
+        }
+    }
+    return accepted;
+}
+
+AlertPoolStats AlertWorkerPool::getStats() {
+    AlertPoolStats stats;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats = stats_;
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stats.queue_depth = queue_.size();
+    return stats;
+}
+
+void AlertWorkerPool::worker() {
+    while (true) {
+        AlertTask task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // 已停止且队列为空
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool success = false;
+        try {
+            success = process(task);
+        } catch (const std::exception& e) {
+            std::cerr << "处理告警失败 (通道 " << task.channel_id << "): " << e.what() << std::endl;
+        }
+        double elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.processed++;
+        if (!success) {
+            stats_.failed++;
+        }
+        stats_.process_ms = (stats_.process_ms == 0.0)
+            ? elapsed_ms
+            : stats_.process_ms + kProcessTimeSmoothing * (elapsed_ms - stats_.process_ms);
+    }
+}
+
+bool AlertWorkerPool::process(const AlertTask& task) {
+    auto& alert_manager = AlertManager::getInstance();
+    auto& report_service = ReportService::getInstance();
+
+    // 告警图片只编码一次，同一份快照用于图片文件、WebSocket 推送和上报
+    const auto& alert_config = Config::getInstance().getAlertConfig();
+    AlertSnapshotOptions snapshot_options;
+    snapshot_options.jpeg_quality = alert_config.jpeg_quality;
+    snapshot_options.thumbnail_width = alert_config.thumbnail_width;
+    snapshot_options.thumbnail_quality = alert_config.thumbnail_quality;
+    if (alert_config.snapshot_policy != AlertSnapshotPolicy::FULL_FRAME) {
+        snapshot_options.crop_region = AlertSnapshot::expandRegion(
+            task.primary.bbox, alert_config.crop_margin, alert_config.crop_min_size, task.frame.size());
+    }
+    if (alert_config.snapshot_policy == AlertSnapshotPolicy::DETECTION_CROP) {
+        snapshot_options.thumbnail_width = 0;  // 目标区域本身已足够小，直接推送
+    }
+
+    auto snapshot = AlertSnapshot::create(task.frame, snapshot_options);
+    if (!snapshot) {
+        std::cerr << "告警图片编码失败 (通道 " << task.channel_id << ")" << std::endl;
+        return false;
+    }
+
+    // 推送报警信息到 WebSocket（有缩略图时推送缩略图，告警图片通过图片文件查看）
+    AlertMessage alert_msg;
+    alert_msg.channel_id = task.channel_id;
+    alert_msg.channel_name = task.channel->name;
+    alert_msg.alert_type = task.alert_type;
+    alert_msg.image_base64 = *snapshot->thumbnailBase64();
+    alert_msg.confidence = task.primary.confidence;
+    alert_msg.detected_objects = task.detected_objects;
+    alert_msg.timestamp = task.timestamp;
+    WebSocketHandler::getInstance().broadcastAlert(alert_msg);
+
+    // 保存报警图片（按日期/通道分目录），有整帧缩略图时一并保存
+    auto& image_store = AlertImageStore::getInstance();
+    std::string image_path = image_store.saveImage(task.channel_id, snapshot->jpeg());
+    if (image_path.empty()) {
+        std::cerr << "保存告警图片失败 (通道 " << task.channel_id << ")" << std::endl;
+        return false;
+    }
+    std::string thumbnail_path;
+    if (snapshot->hasThumbnail()) {
+        thumbnail_path = image_store.saveThumbnail(snapshot->thumbnail());
+        // 目标区域告警的整帧缩略图随上报发送，未打包保存时单独保存一份，重试上报时可重新加载
+        if (thumbnail_path.empty() && snapshot->isCropped()) {
+            thumbnail_path = image_store.saveImage(task.channel_id, snapshot->thumbnail());
+        }
+    }
+
+    // 创建报警记录
+    AlertRecord alert;
+    alert.channel_id = task.channel_id;
+    alert.channel_name = task.channel->name;
+    alert.alert_type = task.alert_type;
+    alert.alert_rule_id = task.rule_id;
+    alert.alert_rule_name = task.rule_name;
+    alert.image_path = image_path;
+    alert.thumbnail_path = thumbnail_path;
+    alert.image_cropped = snapshot->isCropped();
+    alert.confidence = task.primary.confidence;
+    alert.detected_objects = task.detected_objects;
+    alert.bbox_x = task.primary.bbox.x;
+    alert.bbox_y = task.primary.bbox.y;
+    alert.bbox_w = task.primary.bbox.width;
+    alert.bbox_h = task.primary.bbox.height;
+    alert.report_url = "";
+
+    // 通道和全局上报开关都开启时才上报；不上报的报警标记为 skipped，不进入待上报列表
+    const auto& report_config = ReportConfigManager::getInstance().getReportConfig();
+    bool report = task.channel->report_enabled.load() && report_config.enabled.load();
+    alert.report_status = report ? "pending" : "skipped";
+
+    int alert_id = alert_manager.createAlert(alert);
+    alert.id = alert_id;
+
+    if (report) {
+        // 上报携带告警图片，发件箱中共享快照的 JPEG 缓冲区，按上报编码方式在发送时组包
+        alert.image_jpeg = snapshot->jpeg();
+        if (snapshot->isCropped() && snapshot->hasThumbnail()) {
+            alert.thumbnail_jpeg = snapshot->thumbnail();
+        }
+
+        // 执行上报（异步非阻塞，立即返回）
+        // 实际上报结果由后台线程处理并更新数据库状态
+        report_service.reportAlert(alert, report_config);
+    }
+
+    return true;
+}
+
+} // namespace detector_service
@@ -0,0 +1,305 @@
+#include "analytics_engine.h"
+#include "database.h"
+#include "ws_handler.h"
+#include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+
+namespace detector_service {
+
+namespace {
+
+// 写库失败时内存中最多保留的分钟统计条数，超过后丢弃最早的部分
+constexpr size_t kMaxPendingBuckets = 100000;
+
+int64_t minuteOf(int64_t ms) {
+    return ms / 60000 * 60;
+}
+
+} // namespace
+
+nlohmann::json zoneAnalyticsToJson(const ZoneAnalytics& zone) {
+    nlohmann::json json;
+    json["roi_id"] = zone.roi_id;
+    json["roi_name"] = zone.roi_name;
+    json["occupancy"] = zone.occupancy;
+    json["entries"] = zone.total_entries;
+    json["exits"] = zone.total_exits;
+    json["minute_ts"] = zone.current.minute_ts;
+    json["minute_entries"] = zone.current.entries;
+    json["minute_exits"] = zone.current.exits;
+    json["minute_max_occupancy"] = zone.current.max_occupancy;
+    return json;
+}
+
+AnalyticsEngine::AnalyticsEngine() {
+    // 先构造依赖的单例，保证析构时仍可写库和推送
+    Database::getInstance();
+    WebSocketHandler::getInstance();
+
+    if (Config::getInstance().getAnalyticsConfig().enabled) {
+        flush_thread_ = std::thread(&AnalyticsEngine::flushWorker, this);
+    }
+}
+
+AnalyticsEngine::~AnalyticsEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    flush_cv_.notify_all();
+
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+    flush();
+}
+
+void AnalyticsEngine::closeBucketLocked(AnalyticsBucket& bucket) {
+    if (bucket.samples > 0 || bucket.entries > 0 || bucket.exits > 0) {
+        pending_.push_back(bucket);
+    }
+    bucket.entries = 0;
+    bucket.exits = 0;
+    bucket.max_occupancy = 0;
+    bucket.occupancy_sum = 0;
+    bucket.samples = 0;
+}
+
+void AnalyticsEngine::rebuildLocked(int channel_id, ChannelState& state, const AlgorithmConfig& config,
+                                    const CompiledAlgorithmFilter& filter) {
+    for (auto& zone : state.zones) {
+        closeBucketLocked(zone.live.current);
+    }
+    state.zones.clear();
+    state.version = config.version;
+    state.changed = true;
+
+    const auto& rois = filter.rois();
+    size_t count = std::min(rois.size(), config.rois.size());
+    for (size_t i = 0; i < count; ++i) {
+        if (!rois[i].enabled()) {
+            continue;
+        }
+        state.zones.emplace_back();
+        ZoneState& zone = state.zones.back();
+        zone.roi_index = i;
+        zone.live.roi_id = rois[i].id();
+        zone.live.roi_name = config.rois[i].name;
+        zone.live.current.channel_id = channel_id;
+        zone.live.current.roi_id = rois[i].id();
+        zone.inside.reserve(64);
+    }
+}
+
+void AnalyticsEngine::update(int channel_id, const AlgorithmConfig& config, const CompiledAlgorithmFilter& filter,
+                             const std::vector<Detection>& detections, int64_t pts_ms) {
+    const auto& analytics_config = Config::getInstance().getAnalyticsConfig();
+    if (!analytics_config.enabled) {
+        return;
+    }
+
+    const int64_t minute_ts = minuteOf(pts_ms);
+    std::vector<ZoneAnalytics> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = channels_.find(channel_id);
+        if (it == channels_.end()) {
+            it = channels_.emplace(channel_id, ChannelState()).first;
+            rebuildLocked(channel_id, it->second, config, filter);
+        } else if (it->second.version != config.version) {
+            rebuildLocked(channel_id, it->second, config, filter);
+        }
+        ChannelState& state = it->second;
+
+        const auto& rois = filter.rois();
+        for (auto& zone : state.zones) {
+            if (zone.roi_index >= rois.size()) {
+                continue;
+            }
+            const CompiledROI& roi = rois[zone.roi_index];
+            AnalyticsBucket& bucket = zone.live.current;
+            if (bucket.minute_ts != minute_ts) {
+                closeBucketLocked(bucket);
+                bucket.minute_ts = minute_ts;
+            }
+
+            // 命中区域的轨迹：新轨迹计为进入，已有轨迹刷新时间
+            int untracked = 0;
+            for (const auto& det : detections) {
+                if (!roi.matches(det.bbox)) {
+                    continue;
+                }
+                if (det.track_id < 0) {
+                    untracked++;
+                    continue;
+                }
+                auto presence = std::find_if(zone.inside.begin(), zone.inside.end(),
+                                             [&det](const TrackPresence& p) { return p.track_id == det.track_id; });
+                if (presence != zone.inside.end()) {
+                    presence->last_seen_ms = pts_ms;
+                    continue;
+                }
+                zone.inside.push_back({det.track_id, pts_ms});
+                bucket.entries++;
+                zone.live.total_entries++;
+                state.changed = true;
+            }
+
+            // 超过宽限时间未命中的轨迹计为离开（与末尾交换，不移动其余元素）
+            for (size_t i = zone.inside.size(); i-- > 0;) {
+                if (pts_ms - zone.inside[i].last_seen_ms <= analytics_config.exit_grace_ms) {
+                    continue;
+                }
+                zone.inside[i] = zone.inside.back();
+                zone.inside.pop_back();
+                bucket.exits++;
+                zone.live.total_exits++;
+                state.changed = true;
+            }
+
+            int occupancy = static_cast<int>(zone.inside.size()) + untracked;
+            if (occupancy != zone.live.occupancy) {
+                zone.live.occupancy = occupancy;
+                state.changed = true;
+            }
+            bucket.max_occupancy = std::max(bucket.max_occupancy, occupancy);
+            bucket.occupancy_sum += occupancy;
+            bucket.samples++;
+        }
+
+        if (state.changed && pts_ms - state.last_push_ms >= analytics_config.push_interval_ms) {
+            state.changed = false;
+            state.last_push_ms = pts_ms;
+            snapshot.reserve(state.zones.size());
+            for (const auto& zone : state.zones) {
+                snapshot.push_back(zone.live);
+            }
+        }
+    }
+
+    if (snapshot.empty()) {
+        return;
+    }
+
+    // 锁外序列化和推送
+    nlohmann::json message;
+    message["type"] = "analytics";
+    message["channel_id"] = channel_id;
+    message["pts_ms"] = pts_ms;
+    nlohmann::json zones = nlohmann::json::array();
+    for (const auto& zone : snapshot) {
+        zones.push_back(zoneAnalyticsToJson(zone));
+    }
+    message["zones"] = std::move(zones);
+    WebSocketHandler::getInstance().broadcastAnalytics(channel_id, message.dump());
+}
+
+std::vector<ZoneAnalytics> AnalyticsEngine::getLive(int channel_id) {
+    std::vector<ZoneAnalytics> result;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(channel_id);
+    if (it == channels_.end()) {
+        return result;
+    }
+    result.reserve(it->second.zones.size());
+    for (const auto& zone : it->second.zones) {
+        result.push_back(zone.live);
+    }
+    return result;
+}
+
+std::vector<AnalyticsBucket> AnalyticsEngine::getBuckets(int channel_id, int roi_id, int64_t from_ts, int64_t to_ts) {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+
+    std::map<std::pair<int64_t, int>, AnalyticsBucket> merged;
+    for (const auto& bucket : Database::getInstance().getAnalyticsBuckets(channel_id, roi_id, from_ts, to_ts)) {
+        merged[{bucket.minute_ts, bucket.roi_id}] = bucket;
+    }
+
+    auto add = [&](const AnalyticsBucket& bucket) {
+        if (bucket.channel_id != channel_id || (roi_id >= 0 && bucket.roi_id != roi_id) ||
+            bucket.minute_ts < from_ts || bucket.minute_ts >= to_ts || bucket.samples == 0) {
+            return;
+        }
+        auto result = merged.emplace(std::make_pair(bucket.minute_ts, bucket.roi_id), bucket);
+        if (!result.second) {
+            result.first->second.merge(bucket);
+        }
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& bucket : pending_) {
+            add(bucket);
+        }
+        auto it = channels_.find(channel_id);
+        if (it != channels_.end()) {
+            for (const auto& zone : it->second.zones) {
+                add(zone.live.current);
+            }
+        }
+    }
+
+    std::vector<AnalyticsBucket> result;
+    result.reserve(merged.size());
+    for (auto& pair : merged) {
+        result.push_back(std::move(pair.second));
+    }
+    return result;
+}
+
+void AnalyticsEngine::flush() {
+    writePending(true);
+}
+
+void AnalyticsEngine::writePending(bool include_current) {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+
+    std::vector<AnalyticsBucket> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 超过一分钟没有检测帧的通道（停止或断流），其当前分钟也已结束
+        const int64_t now_minute = static_cast<int64_t>(std::time(nullptr)) / 60 * 60;
+        for (auto& pair : channels_) {
+            for (auto& zone : pair.second.zones) {
+                if (include_current || zone.live.current.minute_ts < now_minute) {
+                    closeBucketLocked(zone.live.current);
+                }
+            }
+        }
+        batch.swap(pending_);
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    if (Database::getInstance().upsertAnalyticsBuckets(batch)) {
+        return;
+    }
+
+    // 写库失败，放回待写入队列下次重试
+    std::cerr << "写入客流统计失败，" << batch.size() << " 条分钟统计稍后重试" << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.insert(pending_.begin(), batch.begin(), batch.end());
+    if (pending_.size() > kMaxPendingBuckets) {
+        size_t dropped = pending_.size() - kMaxPendingBuckets;
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(dropped));
+        std::cerr << "客流统计待写入过多，丢弃最早的 " << dropped << " 条" << std::endl;
+    }
+}
+
+void AnalyticsEngine::flushWorker() {
+    auto interval = std::chrono::seconds(
+        std::max(1, Config::getInstance().getAnalyticsConfig().flush_interval_seconds));
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        flush_cv_.wait_for(lock, interval, [this] { return !running_; });
+        lock.unlock();
+        writePending(false);
+        lock.lock();
+    }
+}
+
+} // namespace detector_service
@@ -4,348 +4,240 @@
 #include "channel.h"
 #include "image_utils.h"
 #include "algorithm_config.h"
-#include "report_config.h"
-#include "report_service.h"
-#include <filesystem>
+#include "compiled_filter.h"
+#include "alert_worker_pool.h"
+#include "temporal_rule.h"
+#include "analytics_engine.h"
+#include "config.h"
+#include <algorithm>
+#include <functional>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <nlohmann/json.hpp>
-#include <thread>
-#include <future>
 
 namespace detector_service {
 
+namespace {
+
+// 构建告警信息并提交到告警处理线程池
+// 图片编码、保存、入库、推送和上报都在线程池中完成，检测线程只拷贝一次画面
+// matched_detections 可以为空（数量变化规则在目标数降为 0 时告警），此时告警目标为整帧
+// 返回告警是否进入处理队列；进入队列后又被丢弃时调用 on_dropped
+bool submitAlert(int channel_id, const std::shared_ptr<const Channel>& channel,
+                 int rule_id, const std::string& rule_name,
+                 const std::vector<Detection>& matched_detections, const cv::Mat& alert_frame,
+                 std::function<void()> on_dropped = nullptr) {
+    AlertTask task;
+    task.channel_id = channel_id;
+    task.channel = channel;
+    task.rule_id = rule_id;
+    task.rule_name = rule_name;
+    
+    // 构建检测对象 JSON（只包含匹配的检测结果）
+    nlohmann::json detected_objects = nlohmann::json::array();
+    for (const auto& det : matched_detections) {
+        nlohmann::json obj;
+        obj["class_id"] = det.class_id;
+        obj["class_name"] = det.class_name;
+        obj["confidence"] = det.confidence;
+        if (det.track_id >= 0) {
+            obj["track_id"] = det.track_id;
+        }
+        obj["bbox"] = {
+            {"x", det.bbox.x},
+            {"y", det.bbox.y},
+            {"w", det.bbox.width},
+            {"h", det.bbox.height}
+        };
+        detected_objects.push_back(obj);
+    }
+    task.detected_objects = detected_objects.dump();
+    
+    // 找到置信度最高的检测结果，没有匹配目标时以整帧作为告警目标
+    if (matched_detections.empty()) {
+        task.primary.class_id = -1;
+        task.primary.confidence = 0.0f;
+        task.primary.bbox = cv::Rect(0, 0, alert_frame.cols, alert_frame.rows);
+    } else {
+        task.primary = matched_detections[0];
+    }
+    for (const auto& det : matched_detections) {
+        if (det.confidence > task.primary.confidence) {
+            task.primary = det;
+        }
+    }
+    
+    // 构建告警类型：使用规则名称或类别名称
+    task.alert_type = rule_name;
+    if (task.alert_type.empty()) {
+        // 收集所有不同的类别名称
+        std::vector<std::string> unique_classes;
+        for (const auto& det : matched_detections) {
+            if (std::find(unique_classes.begin(), unique_classes.end(), det.class_name) == unique_classes.end()) {
+                unique_classes.push_back(det.class_name);
+            }
+        }
+        // 组合所有类别名称
+        for (size_t i = 0; i < unique_classes.size(); ++i) {
+            if (i > 0) {
+                task.alert_type += ",";
+            }
+            task.alert_type += unique_classes[i];
+        }
+    }
+    if (task.alert_type.empty()) {
+        task.alert_type = "规则" + std::to_string(rule_id);
+    }
+    
+    auto now = std::time(nullptr);
+    auto tm = *std::localtime(&now);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    task.timestamp = oss.str();
+    
+    // 原始画面在回调返回后可能被复用，需要克隆
+    task.frame = alert_frame.clone();
+    task.on_dropped = std::move(on_dropped);
+    
+    return AlertWorkerPool::getInstance().submit(std::move(task));
+}
+
+} // namespace
+
+void processPacketCallback(int channel_id, const uint8_t* data, size_t size,
+                           bool keyframe, int64_t pts_ms) {
+    auto& ws_handler = WebSocketHandler::getInstance();
+    if (!data) {
+        ws_handler.endPacketStream(channel_id);
+        return;
+    }
+    ws_handler.broadcastPacket(channel_id, data, size, keyframe, pts_ms);
+}
+
 void processFrameCallback(int channel_id, const cv::Mat& frame, 
-                         const std::vector<Detection>& detections) {
+                         const std::vector<Detection>& detections,
+                         int64_t pts_ms, bool detected) {
     auto& ws_handler = WebSocketHandler::getInstance();
     auto& alert_manager = AlertManager::getInstance();
     auto& channel_manager = ChannelManager::getInstance();
     auto& config_manager = AlgorithmConfigManager::getInstance();
     
+    // 客户端叠加模式：画面未绘制检测框，检测结果打包在帧消息中下发
+    const bool client_overlay = Config::getInstance().getStreamConfig().clientOverlay();
+    
     // 发送帧到 WebSocket
-    ws_handler.broadcastFrame(channel_id, frame);
+    ws_handler.broadcastFrame(channel_id, frame, pts_ms, client_overlay ? &detections : nullptr);
     
-    // 如果没有检测结果，直接返回
-    if (detections.empty()) {
+    // 告警规则只在检测帧上评估，未检测的帧沿用上一次的检测结果，不重复计数
+    if (!detected) {
         return;
     }
     
-    // 加载通道的算法配置（包含告警规则）
-    AlgorithmConfig config;
-    if (!config_manager.getAlgorithmConfig(channel_id, config)) {
+    // 告警图片需要带检测框，客户端叠加模式下在此处为告警快照单独绘制
+    cv::Mat annotated_frame;
+    auto alertFrame = [&]() -> const cv::Mat& {
+        if (!client_overlay) {
+            return frame;
+        }
+        if (annotated_frame.empty()) {
+            annotated_frame = ImageUtils::drawDetections(frame, detections);
+        }
+        return annotated_frame;
+    };
+    
+    // 加载通道的算法配置（包含告警规则），使用内存快照，不访问数据库
+    auto config_snapshot = config_manager.getAlgorithmConfigSnapshot(channel_id);
+    if (!config_snapshot) {
         // 如果加载失败，使用默认配置
-        config = config_manager.getDefaultConfig(channel_id);
+        config_snapshot = std::make_shared<const AlgorithmConfig>(config_manager.getDefaultConfig(channel_id));
     }
+    const AlgorithmConfig& config = *config_snapshot;
     
-    // 检查告警规则并触发告警
-    int frame_width = frame.cols;
-    int frame_height = frame.rows;
+    // 预编译过滤器按配置版本和帧尺寸缓存
+    std::shared_ptr<const CompiledAlgorithmFilter> filter;
     
-    for (const auto& rule : config.alert_rules) {
-        // 检查是否应该触发告警
-        if (!config_manager.shouldTriggerAlert(rule, detections, config.rois, frame_width, frame_height)) {
-            continue;
-        }
-        
-        // 检查告警抑制（时间窗口）
-        if (alert_manager.isAlertSuppressed(channel_id, rule.id, rule.suppression_window_seconds)) {
-            continue;  // 在抑制窗口内，跳过
+    // 区域客流统计：配置了ROI时每个检测帧都更新（没有检测结果的帧用于判定目标离开）
+    if (!config.rois.empty() && Config::getInstance().getAnalyticsConfig().enabled) {
+        filter = config_manager.getCompiledFilter(config, frame.cols, frame.rows);
+        if (filter) {
+            AnalyticsEngine::getInstance().update(channel_id, config, *filter, detections, pts_ms);
         }
-        
-        // 获取满足规则的检测结果
-        std::vector<Detection> matched_detections = 
-            config_manager.evaluateAlertRule(rule, detections, config.rois, frame_width, frame_height);
-        
-        if (matched_detections.empty()) {
-            continue;
+    }
+    
+    // 如果没有告警规则，使用旧的逻辑（向后兼容）
+    if (config.alert_rules.empty()) {
+        if (detections.empty()) {
+            return;
         }
-        
-        auto channel = channel_manager.getChannel(channel_id);
+        auto channel = channel_manager.getChannelSnapshot(channel_id);
         if (!channel) {
-            continue;
-        }
-        
-        // 构建检测对象 JSON（只包含匹配的检测结果）
-        nlohmann::json detected_objects = nlohmann::json::array();
-        for (const auto& det : matched_detections) {
-            nlohmann::json obj;
-            obj["class_id"] = det.class_id;
-            obj["class_name"] = det.class_name;
-            obj["confidence"] = det.confidence;
-            obj["bbox"] = {
-                {"x", det.bbox.x},
-                {"y", det.bbox.y},
-                {"w", det.bbox.width},
-                {"h", det.bbox.height}
-            };
-            detected_objects.push_back(obj);
+            return;
         }
+        submitAlert(channel_id, channel, 0, "", detections, alertFrame());
+        return;
+    }
+    
+    // 检查告警规则并触发告警，每条规则每帧只评估一次
+    if (!filter && !detections.empty()) {
+        filter = config_manager.getCompiledFilter(config, frame.cols, frame.rows);
+    }
+    auto rule_state = TemporalRuleEngine::getInstance().channelState(channel_id, config);
+    
+    for (size_t rule_index = 0; rule_index < config.alert_rules.size(); ++rule_index) {
+        const auto& rule = config.alert_rules[rule_index];
         
-        // 找到置信度最高的检测结果
-        const Detection* highest_conf_det = &matched_detections[0];
-        for (const auto& det : matched_detections) {
-            if (det.confidence > highest_conf_det->confidence) {
-                highest_conf_det = &det;
-            }
+        // 获取满足规则的检测结果（没有检测结果时为空，同样计入时序窗口）
+        std::vector<Detection> matched_detections;
+        if (filter && !detections.empty()) {
+            matched_detections = filter->evaluateRule(rule_index, detections);
         }
         
-        // 构建告警类型：使用规则名称或类别名称
-        std::string alert_type = rule.name;
-        if (alert_type.empty()) {
-            // 如果没有规则名称，使用类别名称
-            if (matched_detections.size() == 1) {
-                alert_type = matched_detections[0].class_name;
-            } else {
-                // 收集所有不同的类别名称
-                std::vector<std::string> unique_classes;
-                for (const auto& det : matched_detections) {
-                    bool found = false;
-                    for (const auto& cls : unique_classes) {
-                        if (cls == det.class_name) {
-                            found = true;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        unique_classes.push_back(det.class_name);
-                    }
-                }
-                // 组合所有类别名称
-                for (size_t i = 0; i < unique_classes.size(); ++i) {
-                    if (i > 0) {
-                        alert_type += ",";
-                    }
-                    alert_type += unique_classes[i];
-                }
-            }
+        // 增量更新规则的时序状态，满足时序条件时才告警
+        if (!rule_state->update(rule_index, rule, matched_detections.size(), pts_ms)) {
+            continue;
         }
         
-        // 快速生成低质量 Base64 图片用于立即发送到 WebSocket（减少延迟）
-        std::string quick_image_base64 = ImageUtils::matToBase64(frame, ".jpg", 50);
-        
-        // 立即发送报警信息到 WebSocket（使用低质量图片以减少延迟）
-        AlertMessage alert_msg;
-        alert_msg.channel_id = channel_id;
-        alert_msg.channel_name = channel->name;
-        alert_msg.alert_type = alert_type;
-        alert_msg.image_base64 = quick_image_base64;
-        alert_msg.confidence = highest_conf_det->confidence;
-        alert_msg.detected_objects = detected_objects.dump();
-        
-        auto now = std::time(nullptr);
-        auto tm = *std::localtime(&now);
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        alert_msg.timestamp = oss.str();
-        
-        ws_handler.broadcastAlert(alert_msg);
-        
-        // 在后台线程中处理耗时的图片保存、高质量编码和数据库操作
-        // 注意：需要克隆 frame，因为原始 frame 可能在函数返回后被释放
-        cv::Mat frame_clone = frame.clone();
-        std::thread([channel_id, frame_clone, matched_detections, rule, channel, alert_type, 
-                     highest_conf_det, detected_objects]() {
-            auto& alert_manager = AlertManager::getInstance();
-            auto& report_service = ReportService::getInstance();
-            // 保存报警图片
-            std::string alert_dir = "alerts";
-            std::filesystem::create_directories(alert_dir);
-            
-            std::string timestamp = std::to_string(std::time(nullptr));
-            std::string image_path = alert_dir + "/alert_" + std::to_string(channel_id) + 
-                                    "_" + std::to_string(rule.id) + "_" + timestamp + ".jpg";
-            
-            if (ImageUtils::saveImage(frame_clone, image_path)) {
-                // 生成高质量 Base64 图片用于数据库存储
-                std::string image_base64 = ImageUtils::matToBase64(frame_clone, ".jpg", 90);
-                
-                // 创建报警记录
-                AlertRecord alert;
-                alert.channel_id = channel_id;
-                alert.channel_name = channel->name;
-                alert.alert_type = alert_type;
-                alert.alert_rule_id = rule.id;
-                alert.alert_rule_name = rule.name;
-                alert.image_path = image_path;
-                alert.image_data = image_base64;
-                alert.confidence = highest_conf_det->confidence;
-                alert.detected_objects = detected_objects.dump();
-                alert.bbox_x = highest_conf_det->bbox.x;
-                alert.bbox_y = highest_conf_det->bbox.y;
-                alert.bbox_w = highest_conf_det->bbox.width;
-                alert.bbox_h = highest_conf_det->bbox.height;
-                alert.report_status = "pending";
-                alert.report_url = "";
-                
-                int alert_id = alert_manager.createAlert(alert);
-                alert.id = alert_id;
-                
-                // 记录告警触发时间（用于抑制机制）
-                alert_manager.recordAlertTrigger(channel_id, rule.id);
-                
-                // 如果通道的上报开关开启，进行上报
-                if (channel->report_enabled.load()) {
-                    auto& report_config_manager = ReportConfigManager::getInstance();
-                    const auto& report_config = report_config_manager.getReportConfig();
-                    
-                    if (report_config.enabled.load()) {
-                        // 设置上报地址
-                        std::string report_url;
-                        if (report_config.type == ReportType::HTTP) {
-                            report_url = report_config.http_url;
-                        } else if (report_config.type == ReportType::MQTT) {
-                            report_url = report_config.mqtt_broker + ":" + std::to_string(report_config.mqtt_port) + "/" + report_config.mqtt_topic;
-                        }
-                        
-                        // 执行上报（异步非阻塞，立即返回）
-                        // 实际上报结果由后台线程处理并更新数据库状态
-                        report_service.reportAlert(alert, report_config);
-                    }
-                }
-            }
-        }).detach();  // 分离线程，不等待完成
-    }
-    
-    // 如果没有告警规则，使用旧的逻辑（向后兼容）
-    if (config.alert_rules.empty() && !detections.empty()) {
-        auto channel = channel_manager.getChannel(channel_id);
-        if (!channel) {
-            return;
+        // 其他规则要求当前帧有匹配目标；数量变化规则在数量降为 0 时同样告警（告警图片为整帧）
+        if (matched_detections.empty() && rule.count_delta <= 0) {
+            continue;
         }
         
-        // 构建检测对象 JSON
-        nlohmann::json detected_objects = nlohmann::json::array();
-        for (const auto& det : detections) {
-            nlohmann::json obj;
-            obj["class_id"] = det.class_id;
-            obj["class_name"] = det.class_name;
-            obj["confidence"] = det.confidence;
-            obj["bbox"] = {
-                {"x", det.bbox.x},
-                {"y", det.bbox.y},
-                {"w", det.bbox.width},
-                {"h", det.bbox.height}
-            };
-            detected_objects.push_back(obj);
+        // 检查告警抑制（时间窗口）
+        if (alert_manager.isAlertSuppressed(channel_id, rule.id, rule.suppression_window_seconds)) {
+            continue;  // 在抑制窗口内，跳过
         }
         
-        // 找到置信度最高的检测结果
-        const Detection* highest_conf_det = &detections[0];
-        for (const auto& det : detections) {
-            if (det.confidence > highest_conf_det->confidence) {
-                highest_conf_det = &det;
-            }
+        auto channel = channel_manager.getChannelSnapshot(channel_id);
+        if (!channel) {
+            continue;
         }
         
-        // 构建告警类型
-        std::string alert_type;
-        if (detections.size() == 1) {
-            alert_type = detections[0].class_name;
-        } else {
-            std::vector<std::string> unique_classes;
-            for (const auto& det : detections) {
-                bool found = false;
-                for (const auto& cls : unique_classes) {
-                    if (cls == det.class_name) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    unique_classes.push_back(det.class_name);
-                }
+        // 按轨迹去重：目标都已告警过时不再告警（抑制窗口过后同一目标也不会重复告警）
+        // 数量变化规则针对的是数量而不是目标，不按轨迹去重
+        // 新轨迹在提交前记录（提交后立即可能被其他通道挤出队列），告警未进入队列或被丢弃时撤销
+        std::vector<int> claimed;
+        std::function<void()> on_dropped;
+        if (rule.count_delta <= 0) {
+            if (!rule_state->claimTracks(rule_index, matched_detections, claimed)) {
+                continue;
             }
-            for (size_t i = 0; i < unique_classes.size(); ++i) {
-                if (i > 0) {
-                    alert_type += ",";
-                }
-                alert_type += unique_classes[i];
+            if (!claimed.empty()) {
+                on_dropped = [rule_state, rule_index, claimed]() {
+                    rule_state->releaseTracks(rule_index, claimed);
+                };
             }
         }
         
-        // 快速生成低质量 Base64 图片用于立即发送到 WebSocket（减少延迟）
-        std::string quick_image_base64 = ImageUtils::matToBase64(frame, ".jpg", 50);
-        
-        // 立即发送报警信息到 WebSocket（使用低质量图片以减少延迟）
-        AlertMessage alert_msg;
-        alert_msg.channel_id = channel_id;
-        alert_msg.channel_name = channel->name;
-        alert_msg.alert_type = alert_type;
-        alert_msg.image_base64 = quick_image_base64;
-        alert_msg.confidence = highest_conf_det->confidence;
-        alert_msg.detected_objects = detected_objects.dump();
-        
-        auto now = std::time(nullptr);
-        auto tm = *std::localtime(&now);
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        alert_msg.timestamp = oss.str();
-        
-        ws_handler.broadcastAlert(alert_msg);
+        if (!submitAlert(channel_id, channel, rule.id, rule.name, matched_detections, alertFrame(),
+                         std::move(on_dropped))) {
+            rule_state->releaseTracks(rule_index, claimed);
+            continue;
+        }
         
-        // 在后台线程中处理耗时的图片保存、高质量编码和数据库操作
-        cv::Mat frame_clone = frame.clone();
-        std::thread([channel_id, frame_clone, detections, channel, alert_type, 
-                     highest_conf_det, detected_objects]() {
-            auto& alert_manager = AlertManager::getInstance();
-            auto& report_service = ReportService::getInstance();
-            
-            // 保存报警图片
-            std::string alert_dir = "alerts";
-            std::filesystem::create_directories(alert_dir);
-            
-            std::string timestamp = std::to_string(std::time(nullptr));
-            std::string image_path = alert_dir + "/alert_" + std::to_string(channel_id) + 
-                                    "_" + timestamp + ".jpg";
-            
-            if (ImageUtils::saveImage(frame_clone, image_path)) {
-                // 生成高质量 Base64 图片用于数据库存储
-                std::string image_base64 = ImageUtils::matToBase64(frame_clone, ".jpg", 90);
-                
-                // 创建报警记录（没有告警规则ID）
-                AlertRecord alert;
-                alert.channel_id = channel_id;
-                alert.channel_name = channel->name;
-                alert.alert_type = alert_type;
-                alert.alert_rule_id = 0;  // 没有规则
-                alert.alert_rule_name = "";  // 没有规则名称
-                alert.image_path = image_path;
-                alert.image_data = image_base64;
-                alert.confidence = highest_conf_det->confidence;
-                alert.detected_objects = detected_objects.dump();
-                alert.bbox_x = highest_conf_det->bbox.x;
-                alert.bbox_y = highest_conf_det->bbox.y;
-                alert.bbox_w = highest_conf_det->bbox.width;
-                alert.bbox_h = highest_conf_det->bbox.height;
-                alert.report_status = "pending";
-                alert.report_url = "";
-                
-                int alert_id = alert_manager.createAlert(alert);
-                alert.id = alert_id;
-                
-                // 如果通道的上报开关开启，进行上报
-                if (channel->report_enabled.load()) {
-                    auto& report_config_manager = ReportConfigManager::getInstance();
-                    const auto& report_config = report_config_manager.getReportConfig();
-                    
-                    if (report_config.enabled.load()) {
-                        // 设置上报地址
-                        std::string report_url;
-                        if (report_config.type == ReportType::HTTP) {
-                            report_url = report_config.http_url;
-                        } else if (report_config.type == ReportType::MQTT) {
-                            report_url = report_config.mqtt_broker + ":" + std::to_string(report_config.mqtt_port) + "/" + report_config.mqtt_topic;
-                        }
-                        
-                        // 执行上报（异步非阻塞，立即返回）
-                        // 实际上报结果由后台线程处理并更新数据库状态
-                        report_service.reportAlert(alert, report_config);
-                    }
-                }
-            }
-        }).detach();  // 分离线程，不等待完成
+        // 告警进入队列后即记录触发时间，告警处理排队期间后续帧不会重复触发
+        alert_manager.recordAlertTrigger(channel_id, rule.id);
     }
 }
 
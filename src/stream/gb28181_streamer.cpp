@@ -24,6 +24,7 @@ bool GB28181Streamer::initialize(const GB28181Config& config,
     this->dest_port = dest_port;
     this->ssrc = ssrc;
     this->is_ps_stream = (config.stream_mode == "PS");
+    this->passthrough = false;
     
 #ifdef ENABLE_BM1684
     this->use_hw_encode = use_hw_encode;
@@ -220,8 +221,147 @@ bool GB28181Streamer::initialize(const GB28181Config& config,
     return true;
 }
 
+bool GB28181Streamer::initializePassthrough(const GB28181Config& config,
+                                            const AVCodecParameters* codecpar,
+                                            AVRational src_time_base,
+                                            const std::string& dest_ip, int dest_port,
+                                            const std::string& ssrc) {
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    
+    if (!codecpar || codecpar->codec_id != AV_CODEC_ID_H264) {
+        std::cerr << "GB28181: 直通模式仅支持H.264源" << std::endl;
+        return false;
+    }
+    
+    this->dest_ip = dest_ip;
+    this->dest_port = dest_port;
+    this->ssrc = ssrc;
+    this->is_ps_stream = (config.stream_mode == "PS");
+    
+    const char* format_name = is_ps_stream ? "mpegts" : "rtp";
+    
+    std::ostringstream url_stream;
+    url_stream << "rtp://" << dest_ip << ":" << dest_port;
+    if (!ssrc.empty()) {
+        url_stream << "?ssrc=" << ssrc;
+    }
+    std::string output_url = url_stream.str();
+    
+    int ret = avformat_alloc_output_context2(&fmt_ctx, nullptr, format_name, output_url.c_str());
+    if (ret < 0 || !fmt_ctx) {
+        std::cerr << "GB28181: 无法创建输出格式上下文: " << avErrorToString(ret) << std::endl;
+        fmt_ctx = nullptr;
+        return false;
+    }
+    
+    video_stream = avformat_new_stream(fmt_ctx, nullptr);
+    if (!video_stream) {
+        std::cerr << "GB28181: 无法创建视频流" << std::endl;
+        avformat_free_context(fmt_ctx);
+        fmt_ctx = nullptr;
+        return false;
+    }
+    
+    // 直接使用源码流参数，不经过编码器
+    ret = avcodec_parameters_copy(video_stream->codecpar, codecpar);
+    if (ret < 0) {
+        std::cerr << "GB28181: 无法复制源码流参数: " << avErrorToString(ret) << std::endl;
+        avformat_free_context(fmt_ctx);
+        fmt_ctx = nullptr;
+        return false;
+    }
+    video_stream->codecpar->codec_tag = 0;
+    video_stream->time_base = src_time_base;
+    
+    ret = avio_open(&fmt_ctx->pb, output_url.c_str(), AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        std::cerr << "GB28181: 无法打开输出URL " << output_url << ": " << avErrorToString(ret) << std::endl;
+        avformat_free_context(fmt_ctx);
+        fmt_ctx = nullptr;
+        return false;
+    }
+    
+    ret = avformat_write_header(fmt_ctx, nullptr);
+    if (ret < 0) {
+        std::cerr << "GB28181: 无法写入文件头: " << avErrorToString(ret) << std::endl;
+        avio_closep(&fmt_ctx->pb);
+        avformat_free_context(fmt_ctx);
+        fmt_ctx = nullptr;
+        return false;
+    }
+    
+    passthrough = true;
+    source_time_base = src_time_base;
+    waiting_keyframe = true;
+    frame_count = 0;
+    start_pts = AV_NOPTS_VALUE;
+    last_dts = -1;
+    is_streaming = true;
+    
+    std::cout << "GB28181: 直通模式推流已启动 " << output_url << std::endl;
+    return true;
+}
+
+bool GB28181Streamer::pushPacket(const AVPacket* packet) {
+    if (!packet || !passthrough || !isInitialized() || !is_streaming) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    
+    // 从关键帧开始发送，保证上级平台可以直接解码
+    if (waiting_keyframe) {
+        if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+            return true;
+        }
+        waiting_keyframe = false;
+    }
+    
+    AVPacket* pkt = av_packet_clone(packet);
+    if (!pkt) {
+        return false;
+    }
+    
+    // 时间戳以首包为零点，缺失时用DTS/PTS互补
+    if (pkt->dts == AV_NOPTS_VALUE) {
+        pkt->dts = pkt->pts;
+    }
+    if (pkt->pts == AV_NOPTS_VALUE) {
+        pkt->pts = pkt->dts;
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        if (start_pts == AV_NOPTS_VALUE) {
+            start_pts = pkt->dts;
+        }
+        pkt->dts -= start_pts;
+        pkt->pts -= start_pts;
+    }
+    
+    pkt->stream_index = video_stream->index;
+    av_packet_rescale_ts(pkt, source_time_base, video_stream->time_base);
+    
+    // 确保DTS单调递增
+    if (pkt->dts == AV_NOPTS_VALUE || (last_dts >= 0 && pkt->dts <= last_dts)) {
+        pkt->dts = last_dts + 1;
+        if (pkt->pts == AV_NOPTS_VALUE || pkt->pts < pkt->dts) {
+            pkt->pts = pkt->dts;
+        }
+    }
+    last_dts = pkt->dts;
+    
+    int ret = av_interleaved_write_frame(fmt_ctx, pkt);
+    av_packet_free(&pkt);
+    frame_count++;
+    
+    if (ret < 0) {
+        std::cerr << "GB28181: 写入直通数据包失败: " << avErrorToString(ret) << std::endl;
+        return false;
+    }
+    return true;
+}
+
 bool GB28181Streamer::pushFrame(const cv::Mat& frame) {
-    if (!isInitialized() || !is_streaming) {
+    if (!isInitialized() || !is_streaming || passthrough) {
         return false;
     }
     
@@ -402,6 +542,9 @@ void GB28181Streamer::close() {
         avformat_free_context(fmt_ctx);
         fmt_ctx = nullptr;
     }
+    
+    passthrough = false;
+    waiting_keyframe = true;
 }
 
 } // namespace detector_service
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include "alert_snapshot.h"
+
+namespace detector_service {
+
+// 已保存图片在磁盘上的位置
+struct StoredImage {
+    std::string file;     // 图片文件或缩略图打包文件
+    uint64_t offset = 0;  // 图片在文件中的起始偏移
+    uint64_t length = 0;  // 图片字节数
+    std::string etag;     // 图片内容不变时不变，用于 HTTP 缓存校验
+};
+
+/**
+ * @brief 告警图片存储
+ * 图片按 <image_dir>/<YYYYMMDD>/<通道ID>/<时分秒>_<序号>_<内容哈希>.jpg 分目录保存，每条告警一个文件：
+ * 先写临时文件并 fsync 再改名，读取方和掉电重启后都不会看到写了一半的图片；
+ * 目录项和缩略图打包文件的 fsync 由后台线程按 AlertConfig::image_sync_interval_ms 批量执行。
+ * 缩略图可追加写入每天一个的打包文件 <image_dir>/<YYYYMMDD>/thumbnails.pack，
+ * 以 "<打包文件>#<偏移>+<长度>" 定位，不再为每张小图片单独建文件。
+ */
+class AlertImageStore {
+public:
+    static AlertImageStore& getInstance() {
+        static AlertImageStore instance;
+        return instance;
+    }
+
+    /**
+     * @brief 保存告警图片
+     * @return 图片路径，保存失败时返回空字符串
+     */
+    std::string saveImage(int channel_id, const AlertSnapshot::Buffer& jpeg);
+
+    /**
+     * @brief 追加缩略图到当天的打包文件
+     * @return 缩略图定位符，未开启 thumbnail_pack 或保存失败时返回空字符串
+     */
+    std::string saveThumbnail(const AlertSnapshot::Buffer& jpeg);
+
+    /**
+     * @brief 解析 saveImage/saveThumbnail 返回的位置（兼容旧版平铺目录下的图片路径）
+     * @return 文件不存在或定位符无效时返回 false
+     */
+    bool locate(const std::string& location, StoredImage& image) const;
+
+    /**
+     * @brief 读取 saveImage/saveThumbnail 保存的图片（上报重试或重启后重新加载图片时使用）
+     * @return 图片不存在或读取失败时返回空指针
+     */
+    AlertSnapshot::Buffer load(const std::string& location) const;
+
+    /**
+     * @brief 删除 cutoff_ts 所在日期之前的日期目录（包括其中的缩略图打包文件）
+     * @return 删除的日期目录数
+     */
+    size_t removeDaysBefore(int64_t cutoff_ts);
+
+    // 立即 fsync 所有已写入但尚未同步的图片
+    void sync();
+
+private:
+    AlertImageStore();
+    ~AlertImageStore();
+    AlertImageStore(const AlertImageStore&) = delete;
+    AlertImageStore& operator=(const AlertImageStore&) = delete;
+
+    static std::string dayOf(std::time_t time);
+
+    // 创建目录（已创建过的目录只检查一次）
+    bool ensureDirectory(const std::string& dir);
+    void scheduleSync(const std::string& file, const std::string& dir);
+    void syncWorker();
+
+    std::string root_;
+    bool thumbnail_pack_ = false;
+    int sync_interval_ms_ = 0;
+    std::atomic<uint64_t> sequence_{0};  // 图片文件名中的序号，同一秒内的图片互不重名
+
+    std::mutex dirs_mutex_;
+    std::set<std::string> known_dirs_;
+
+    // 当天的缩略图打包文件
+    std::mutex pack_mutex_;
+    std::string pack_day_;
+    std::string pack_path_;
+    int pack_fd_ = -1;
+    uint64_t pack_size_ = 0;
+
+    // 待 fsync 的文件和目录（目录 fsync 使改名持久化）
+    std::mutex sync_mutex_;
+    std::condition_variable sync_cv_;
+    std::set<std::string> pending_files_;
+    std::set<std::string> pending_dirs_;
+    bool running_ = true;
+    std::thread sync_thread_;
+};
+
+} // namespace detector_service
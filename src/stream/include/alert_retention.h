@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+
+namespace detector_service {
+
+/**
+ * @brief 过期报警清理
+ * 后台线程按 DatabaseConfig::retention_interval_seconds 周期清理超过 max_storage_days 的报警：
+ * 每个事务只删除 retention_batch_size 条并删除对应图片文件，批次之间暂停，
+ * 清理完成后删除过期的图片日期目录并增量回收数据库空闲页，避免一次大 DELETE 长时间锁库。
+ */
+class AlertRetentionService {
+public:
+    static AlertRetentionService& getInstance() {
+        static AlertRetentionService instance;
+        return instance;
+    }
+
+    void start();
+    void stop();
+
+private:
+    AlertRetentionService();
+    ~AlertRetentionService();
+    AlertRetentionService(const AlertRetentionService&) = delete;
+    AlertRetentionService& operator=(const AlertRetentionService&) = delete;
+
+    void worker();
+
+    // 分批清理早于 cutoff_ts 的报警，stop() 后中断，返回删除的报警数
+    // finished 表示早于 cutoff_ts 的报警已全部删除（未中断、未失败）
+    uint64_t purgeBefore(int64_t cutoff_ts, bool& finished);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    std::thread thread_;
+};
+
+} // namespace detector_service
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <condition_variable>
+#include "image_utils.h"
+#include "channel.h"
+
+namespace detector_service {
+
+// 待处理的告警
+// 检测线程只负责规则判定和收集告警信息，图片编码、保存、入库、推送和上报都在告警处理线程中完成
+struct AlertTask {
+    int channel_id = 0;
+    std::shared_ptr<const Channel> channel;
+    int rule_id = 0;               // 告警规则ID，0 表示未配置规则
+    std::string rule_name;
+    std::string alert_type;
+    Detection primary{};           // 置信度最高的检测结果
+    std::string detected_objects;  // JSON string
+    std::string timestamp;         // 触发时间
+    cv::Mat frame;                 // 告警画面（已绘制检测框），由任务独占
+    std::function<void()> on_dropped;  // 排队后因队列已满被丢弃（DROP_OLDEST）时调用，撤销提交方为该告警记录的状态
+};
+
+// 告警处理统计
+struct AlertPoolStats {
+    uint64_t submitted = 0;   // 提交的告警数
+    uint64_t processed = 0;   // 处理完成的告警数
+    uint64_t dropped = 0;     // 因队列已满被丢弃的告警数
+    uint64_t failed = 0;      // 图片编码或保存失败的告警数
+    size_t queue_depth = 0;   // 当前排队数
+    size_t queue_capacity = 0;
+    int workers = 0;
+    double process_ms = 0.0;  // 单条告警处理耗时（指数滑动平均，毫秒）
+};
+
+/**
+ * @brief 告警处理线程池
+ * 固定数量的工作线程 + 有界队列，告警风暴时按 AlertConfig::overflow_policy 丢弃，
+ * 不会无限创建线程或堆积画面。
+ */
+class AlertWorkerPool {
+public:
+    static AlertWorkerPool& getInstance() {
+        static AlertWorkerPool instance;
+        return instance;
+    }
+
+    /**
+     * @brief 提交告警（不阻塞调用方）
+     * @return 本条告警是否进入队列（DROP_NEWEST 策略下队列已满时返回 false）
+     */
+    bool submit(AlertTask task);
+
+    AlertPoolStats getStats();
+
+private:
+    AlertWorkerPool();
+    ~AlertWorkerPool();
+    AlertWorkerPool(const AlertWorkerPool&) = delete;
+    AlertWorkerPool& operator=(const AlertWorkerPool&) = delete;
+
+    void worker();
+    bool process(const AlertTask& task);
+
+    std::deque<AlertTask> queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    bool running_ = true;
+    std::vector<std::thread> threads_;
+
+    std::mutex stats_mutex_;
+    AlertPoolStats stats_;
+};
+
+} // namespace detector_service
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "algorithm_config.h"
+#include "compiled_filter.h"
+#include "analytics.h"
+#include "image_utils.h"
+
+namespace detector_service {
+
+// 区域的实时统计
+struct ZoneAnalytics {
+    int roi_id = 0;
+    std::string roi_name;
+    int occupancy = 0;          // 当前区域内的目标数
+    uint64_t total_entries = 0; // 统计开始（服务启动或修改配置）以来的进入数
+    uint64_t total_exits = 0;   // 统计开始以来的离开数
+    AnalyticsBucket current;    // 当前分钟的统计（未落库部分）
+};
+
+nlohmann::json zoneAnalyticsToJson(const ZoneAnalytics& zone);
+
+/**
+ * @brief 区域客流统计
+ * 在检测帧上按轨迹ID增量维护每个通道、每个启用ROI内的目标：轨迹首次命中区域计为进入，
+ * 连续 exit_grace_ms 未命中（离开区域或消失）计为离开；没有轨迹ID的目标只计入区域内目标数。
+ * 进入/离开数、最大和平均区域内目标数按分钟汇总在内存中，后台线程每 flush_interval_seconds
+ * 将已结束的分钟批量写入 analytics_minutes 表；统计变化时按 push_interval_ms 节流推送给该通道的
+ * WebSocket 订阅者。
+ */
+class AnalyticsEngine {
+public:
+    static AnalyticsEngine& getInstance() {
+        static AnalyticsEngine instance;
+        return instance;
+    }
+
+    // 检测帧上调用（detections 为过滤后的检测结果，config 与 filter 版本一致）
+    void update(int channel_id, const AlgorithmConfig& config, const CompiledAlgorithmFilter& filter,
+                const std::vector<Detection>& detections, int64_t pts_ms);
+
+    // 通道各区域的实时统计，通道尚无统计时返回空
+    std::vector<ZoneAnalytics> getLive(int channel_id);
+
+    /**
+     * @brief 分钟统计（数据库中的记录合并内存中尚未写入的部分），按分钟和ROI排序
+     * @param roi_id 为负数时返回所有ROI
+     * @param from_ts 起始时间（Unix 秒，包含）
+     * @param to_ts 结束时间（Unix 秒，不包含）
+     */
+    std::vector<AnalyticsBucket> getBuckets(int channel_id, int roi_id, int64_t from_ts, int64_t to_ts);
+
+    // 立即写入所有统计（包括尚未结束的当前分钟）
+    void flush();
+
+private:
+    AnalyticsEngine();
+    ~AnalyticsEngine();
+    AnalyticsEngine(const AnalyticsEngine&) = delete;
+    AnalyticsEngine& operator=(const AnalyticsEngine&) = delete;
+
+    // 区域内的一条轨迹
+    struct TrackPresence {
+        int track_id;
+        int64_t last_seen_ms;  // 最近一次命中区域的时间
+    };
+
+    struct ZoneState {
+        size_t roi_index = 0;  // 在 config.rois 中的下标
+        ZoneAnalytics live;
+        std::vector<TrackPresence> inside;
+    };
+
+    struct ChannelState {
+        uint64_t version = 0;
+        std::vector<ZoneState> zones;
+        int64_t last_push_ms = 0;
+        bool changed = false;  // 上次推送后统计是否变化
+    };
+
+    // 按配置重建通道的区域（需持有 mutex_），原有区域的当前分钟统计转入待写入
+    void rebuildLocked(int channel_id, ChannelState& state, const AlgorithmConfig& config,
+                       const CompiledAlgorithmFilter& filter);
+
+    // 当前分钟统计转入待写入并清零（需持有 mutex_）
+    void closeBucketLocked(AnalyticsBucket& bucket);
+
+    // 写入待写入的分钟统计，include_current 为 true 时包括尚未结束的当前分钟
+    void writePending(bool include_current);
+
+    void flushWorker();
+
+    std::map<int, ChannelState> channels_;
+    std::vector<AnalyticsBucket> pending_;  // 已结束、尚未写入数据库的分钟统计
+    std::mutex mutex_;
+
+    // 写库与查询互斥：查询时内存中的统计要么已在数据库中，要么仍在内存中，不会重复或遗漏
+    std::mutex flush_mutex_;
+
+    std::condition_variable flush_cv_;
+    std::thread flush_thread_;
+    bool running_ = true;
+};
+
+} // namespace detector_service
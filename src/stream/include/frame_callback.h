@@ -2,13 +2,22 @@
 
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <cstdint>
 #include "image_utils.h"
 
 namespace detector_service {
 
 // 处理帧的回调函数
+// pts_ms: 帧的采集时间戳（毫秒），用于客户端将检测元数据与画面对齐
+// detected: 该帧是否执行了检测，告警规则只在检测帧上评估（未检测的帧沿用上一次的结果，不重复计数）
 void processFrameCallback(int channel_id, const cv::Mat& frame, 
-                         const std::vector<Detection>& detections);
+                         const std::vector<Detection>& detections,
+                         int64_t pts_ms, bool detected);
+
+// 处理直通模式的源码流数据包（转发给 WebSocket 观看端）
+// data 为 nullptr 表示该通道的直通结束
+void processPacketCallback(int channel_id, const uint8_t* data, size_t size,
+                           bool keyframe, int64_t pts_ms);
 
 } // namespace detector_service
 
@@ -44,6 +44,9 @@ private:
     int dest_port;                          // 目标RTP端口
     int local_port;                         // 本地RTP端口
     bool is_ps_stream;                      // 是否PS流（否则为H.264）
+    bool passthrough;                       // 是否直通模式（直接封装源码流，不编码）
+    AVRational source_time_base;            // 直通模式下源数据包的时间基
+    bool waiting_keyframe;                  // 直通模式下等待首个关键帧
     
     std::atomic<bool> is_streaming;         // 是否正在推流
     std::mutex stream_mutex;
@@ -65,6 +68,9 @@ public:
           dest_port(0),
           local_port(0),
           is_ps_stream(true),
+          passthrough(false),
+          source_time_base(AVRational{1, 90000}),
+          waiting_keyframe(true),
           is_streaming(false) {}
     
     /**
@@ -87,6 +93,22 @@ public:
                    std::optional<int> bitrate = std::nullopt,
                    bool use_hw_encode = false);
     
+    /**
+     * @brief 以直通模式初始化GB28181推流（不创建编码器，直接封装源H.264数据包）
+     * @param config GB28181配置
+     * @param codecpar 源码流的编码参数（Annex-B）
+     * @param src_time_base 源数据包的时间基
+     * @param dest_ip 目标IP地址
+     * @param dest_port 目标RTP端口
+     * @param ssrc 媒体流SSRC
+     * @return 是否成功
+     */
+    bool initializePassthrough(const GB28181Config& config,
+                               const AVCodecParameters* codecpar,
+                               AVRational src_time_base,
+                               const std::string& dest_ip, int dest_port,
+                               const std::string& ssrc);
+    
     /**
      * @brief 推送一帧视频
      * @param frame OpenCV Mat格式的视频帧（BGR格式）
@@ -94,6 +116,21 @@ public:
      */
     bool pushFrame(const cv::Mat& frame);
     
+    /**
+     * @brief 推送一个源码流数据包（仅直通模式）
+     * @param packet 源H.264数据包（Annex-B），函数内部复制引用，不修改原包
+     * @return 是否成功
+     */
+    bool pushPacket(const AVPacket* packet);
+    
+    /**
+     * @brief 是否为直通模式
+     * @return 是否直通
+     */
+    bool isPassthrough() const {
+        return passthrough;
+    }
+    
     /**
      * @brief 关闭推流并清理资源
      */
@@ -111,7 +148,7 @@ public:
      * @return 是否已初始化
      */
     bool isInitialized() const {
-        return fmt_ctx != nullptr && codec_ctx != nullptr;
+        return fmt_ctx != nullptr && (codec_ctx != nullptr || passthrough);
     }
     
     /**
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+namespace detector_service {
+
+/**
+ * @brief 基于FFmpeg的视频源
+ * 同时提供源码流的压缩数据包（用于直通转发）和解码后的BGR帧（用于检测）。
+ * H.264源的数据包经过 h264_mp4toannexb 转换为Annex-B格式，关键帧自带SPS/PPS。
+ */
+class FFmpegPacketSource {
+public:
+    FFmpegPacketSource() = default;
+    ~FFmpegPacketSource();
+
+    FFmpegPacketSource(const FFmpegPacketSource&) = delete;
+    FFmpegPacketSource& operator=(const FFmpegPacketSource&) = delete;
+
+    /**
+     * @brief 打开视频源并初始化解码器
+     * @param url 源地址
+     * @param timeout_ms 网络超时（毫秒）
+     * @return 是否成功
+     */
+    bool open(const std::string& url, int timeout_ms);
+
+    /**
+     * @brief 关闭视频源并释放资源
+     */
+    void close();
+
+    bool isOpened() const { return fmt_ctx_ != nullptr; }
+
+    /**
+     * @brief 源是否为H.264（只有H.264源支持直通）
+     */
+    bool isH264() const;
+
+    /**
+     * @brief 设置解码输出尺寸，缩放在像素格式转换时一并完成
+     * @param width 输出宽度，<=0 表示保持源尺寸
+     * @param height 输出高度，<=0 表示保持源尺寸
+     */
+    void setOutputSize(int width, int height) {
+        out_width_ = width;
+        out_height_ = height;
+    }
+
+    /**
+     * @brief 读取下一个视频数据包并送入解码器
+     * @param frame 解码出图像时填充的BGR帧
+     * @param got_frame 本次是否解码出图像
+     * @return 是否读取到数据包（失败表示流结束或出错）
+     */
+    bool read(cv::Mat& frame, bool& got_frame);
+
+    /**
+     * @brief 最近一次 read 得到的待转发数据包（Annex-B），在下一次 read 前有效
+     * @return 数据包，若本次没有可转发的数据则为 nullptr
+     */
+    const AVPacket* relayPacket() const {
+        return (relay_packet_ && relay_packet_->size > 0) ? relay_packet_ : nullptr;
+    }
+
+    /**
+     * @brief 转发数据包对应的编码参数（Annex-B，供GB28181直通封装使用）
+     */
+    const AVCodecParameters* relayCodecParameters() const;
+
+    /**
+     * @brief 转发数据包的时间基
+     */
+    AVRational relayTimeBase() const;
+
+private:
+    bool receiveFrame(cv::Mat& frame);
+
+    AVFormatContext* fmt_ctx_ = nullptr;
+    AVCodecContext* dec_ctx_ = nullptr;
+    AVBSFContext* bsf_ctx_ = nullptr;
+    SwsContext* sws_ctx_ = nullptr;
+    AVFrame* decoded_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    AVPacket* relay_packet_ = nullptr;
+    int video_index_ = -1;
+    int out_width_ = 0;
+    int out_height_ = 0;
+};
+
+} // namespace detector_service
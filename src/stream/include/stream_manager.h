@@ -20,9 +20,12 @@ extern "C" {
 #include "channel.h"
 #include "yolov11_detector.h"
 #include "algorithm_config.h"
+#include "compiled_filter.h"
 #include "gb28181_streamer.h"
+#include "overlay_renderer.h"
 #include "gb28181_config.h"
 #include "gb28181_sip_client.h"
+#include "packet_source.h"
 
 #ifdef ENABLE_BM1684
 #include "bm1684_video_decoder.h"
@@ -33,8 +36,14 @@ namespace detector_service {
 
 class StreamManager {
 public:
+    // detected 为 false 表示该帧未执行检测，detections 沿用上一次的检测结果（仅用于显示）
     using FrameCallback = std::function<void(int channel_id, const cv::Mat& frame, 
-                                            const std::vector<Detection>& detections)>;
+                                            const std::vector<Detection>& detections,
+                                            int64_t pts_ms, bool detected)>;
+    // 直通模式下的源码流数据包回调（Annex-B 访问单元）
+    // data 为 nullptr 表示该通道的直通结束
+    using PacketCallback = std::function<void(int channel_id, const uint8_t* data, size_t size,
+                                             bool keyframe, int64_t pts_ms)>;
     
     StreamManager();
     ~StreamManager();
@@ -57,6 +66,9 @@ public:
     
     // 设置帧回调
     void setFrameCallback(FrameCallback callback);
+    
+    // 设置直通数据包回调
+    void setPacketCallback(PacketCallback callback);
 
 private:
     // StreamContext 结构体定义（需要在函数声明之前定义）
@@ -70,21 +82,41 @@ private:
 #endif
         
         AlgorithmConfig algorithm_config;  // 通道的算法配置
+        std::shared_ptr<const CompiledAlgorithmFilter> compiled_filter;  // 按当前配置和帧尺寸预编译的过滤器
         std::mutex config_mutex;           // 配置更新锁
         std::vector<Detection> last_detections;  // 上一次的检测结果，用于避免跳帧时检测框闪烁
+        OverlayRenderer overlay_renderer;        // 检测框叠加渲染器（仅工作线程使用）
         
         // GB28181推流相关
         GB28181ChannelInfo gb28181_info;   // GB28181通道信息
         
+        // 源码流直通相关（由 config_mutex 保护），GB28181 点播时据此直接封装源码流
+        AVCodecParameters* passthrough_codecpar = nullptr;
+        AVRational passthrough_time_base{1, 90000};
+        
         StreamContext() {}
+        ~StreamContext() {
+            if (passthrough_codecpar) {
+                avcodec_parameters_free(&passthrough_codecpar);
+            }
+        }
     };
     
     void streamWorker(int channel_id, std::shared_ptr<Channel> channel,
                      std::shared_ptr<YOLOv11Detector> detector);
     
+    // 源码流直通工作线程：转发源H.264数据包，解码帧仅用于检测；源不是H.264时回退到 streamWorker
+    void streamWorkerPassthrough(int channel_id, std::shared_ptr<Channel> channel,
+                                 std::shared_ptr<YOLOv11Detector> detector);
+    
+    // 获取与帧尺寸匹配的预编译过滤器，配置更新或尺寸变化后重新编译（调用方需持有 config_mutex）
+    static std::shared_ptr<const CompiledAlgorithmFilter> getCompiledFilter(
+        StreamContext& context, int frame_width, int frame_height);
+    
     std::mutex streams_mutex_;
     std::map<int, std::unique_ptr<StreamContext>> streams_;
     FrameCallback frame_callback_;
+    PacketCallback packet_callback_;
     
     // GB28181 SIP客户端
     std::unique_ptr<GB28181SipClient> gb28181_sip_client_;
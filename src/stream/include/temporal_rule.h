@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "algorithm_config.h"
+
+namespace detector_service {
+
+/**
+ * @brief 单个通道的告警规则时序状态
+ * 每条规则一个环形缓冲区，保存最近 window_size 次检测的匹配数量和是否命中，
+ * 并维护窗口内的命中次数和持续命中的起始时间，每次检测 O(1) 更新，不重新扫描历史。
+ * 另外记录每条规则最近已告警的轨迹ID，同一目标只告警一次。
+ * 时序窗口只由该通道的检测线程访问，不加锁；已告警的轨迹在告警被丢弃时可能由其他线程撤销，单独加锁。
+ */
+class ChannelRuleState {
+public:
+    explicit ChannelRuleState(const AlgorithmConfig& config);
+
+    uint64_t version() const { return version_; }
+
+    /**
+     * @brief 记录一次检测中规则匹配的目标数量（没有匹配时 matched_count 为 0，也要记录）
+     * @param pts_ms 帧时间戳（毫秒），用于计算持续命中时长
+     * @return 是否满足规则的时序条件
+     */
+    bool update(size_t rule_index, const AlertRule& rule, size_t matched_count, int64_t pts_ms);
+
+    /**
+     * @brief 按轨迹去重：记录匹配目标中尚未告警过的轨迹ID
+     * @param claimed 返回本次新记录的轨迹ID（告警未能提交或被丢弃时通过 releaseTracks 撤销）
+     * @return 是否包含尚未告警过的目标（未跟踪的目标视为新目标）
+     */
+    bool claimTracks(size_t rule_index, const std::vector<Detection>& matched, std::vector<int>& claimed);
+
+    // 撤销 claimTracks 记录的轨迹ID，这些目标之后可以再次告警（可由任意线程调用）
+    void releaseTracks(size_t rule_index, const std::vector<int>& track_ids);
+
+private:
+    static constexpr size_t kAlertedTrackSlots = 64;
+
+
+    struct RuleWindow {
+        struct Slot {
+            int count = 0;     // 匹配数量
+            bool hit = false;  // 该次检测是否满足单次条件
+        };
+        std::vector<Slot> slots;       // 环形缓冲区，容量为 window_size
+        size_t head = 0;               // 下一次写入的位置（窗口已满时即最早的一次）
+        size_t filled = 0;
+        int hits = 0;                  // 窗口内的命中次数
+        int64_t streak_start_ms = -1;  // 连续满足 min_hits 的起始时间，-1 表示当前未满足
+        int64_t last_pts_ms = 0;
+
+        std::array<int, kAlertedTrackSlots> alerted_tracks{};  // 最近已告警的轨迹ID（环形，0 表示空）
+        size_t alerted_next = 0;
+
+        void reset();
+    };
+
+    uint64_t version_;
+    std::vector<RuleWindow> windows_;  // 与 AlgorithmConfig::alert_rules 一一对应
+    std::mutex tracks_mutex_;          // 保护各窗口的 alerted_tracks 和 alerted_next
+};
+
+/**
+ * @brief 告警规则时序状态管理
+ * 按通道保存 ChannelRuleState，算法配置版本变化时重建该通道的状态。
+ */
+class TemporalRuleEngine {
+public:
+    static TemporalRuleEngine& getInstance() {
+        static TemporalRuleEngine instance;
+        return instance;
+    }
+
+    // 获取通道与配置版本对应的规则状态
+    std::shared_ptr<ChannelRuleState> channelState(int channel_id, const AlgorithmConfig& config);
+
+private:
+    TemporalRuleEngine() = default;
+    TemporalRuleEngine(const TemporalRuleEngine&) = delete;
+    TemporalRuleEngine& operator=(const TemporalRuleEngine&) = delete;
+
+    std::mutex mutex_;
+    std::map<int, std::shared_ptr<ChannelRuleState>> states_;
+};
+
+} // namespace detector_service
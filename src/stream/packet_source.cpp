@@ -0,0 +1,209 @@
+#include "packet_source.h"
+#include "ffmpeg_utils.h"
+#include <iostream>
+
+namespace detector_service {
+
+FFmpegPacketSource::~FFmpegPacketSource() {
+    close();
+}
+
+bool FFmpegPacketSource::open(const std::string& url, int timeout_ms) {
+    close();
+
+    // 网络超时（微秒），RTSP/HTTP 等协议均识别 timeout 选项
+    AVDictionary* options = nullptr;
+    std::string timeout_us = std::to_string(static_cast<int64_t>(timeout_ms) * 1000);
+    av_dict_set(&options, "timeout", timeout_us.c_str(), 0);
+
+    int ret = avformat_open_input(&fmt_ctx_, url.c_str(), nullptr, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        std::cerr << "FFmpegPacketSource: 无法打开视频源 " << url << ": " << avErrorToString(ret) << std::endl;
+        fmt_ctx_ = nullptr;
+        return false;
+    }
+
+    ret = avformat_find_stream_info(fmt_ctx_, nullptr);
+    if (ret < 0) {
+        std::cerr << "FFmpegPacketSource: 无法获取流信息: " << avErrorToString(ret) << std::endl;
+        close();
+        return false;
+    }
+
+    const AVCodec* decoder = nullptr;
+    video_index_ = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (video_index_ < 0 || !decoder) {
+        std::cerr << "FFmpegPacketSource: 未找到可解码的视频流" << std::endl;
+        close();
+        return false;
+    }
+
+    AVStream* stream = fmt_ctx_->streams[video_index_];
+
+    dec_ctx_ = avcodec_alloc_context3(decoder);
+    if (!dec_ctx_ ||
+        avcodec_parameters_to_context(dec_ctx_, stream->codecpar) < 0 ||
+        avcodec_open2(dec_ctx_, decoder, nullptr) < 0) {
+        std::cerr << "FFmpegPacketSource: 无法打开解码器" << std::endl;
+        close();
+        return false;
+    }
+
+    // H.264 数据包统一转换为Annex-B，并在关键帧前插入SPS/PPS，观看端可从任意关键帧开始解码
+    if (stream->codecpar->codec_id == AV_CODEC_ID_H264) {
+        const AVBitStreamFilter* filter = av_bsf_get_by_name("h264_mp4toannexb");
+        if (!filter ||
+            av_bsf_alloc(filter, &bsf_ctx_) < 0 ||
+            avcodec_parameters_copy(bsf_ctx_->par_in, stream->codecpar) < 0) {
+            std::cerr << "FFmpegPacketSource: 无法创建 h264_mp4toannexb 过滤器" << std::endl;
+            close();
+            return false;
+        }
+        bsf_ctx_->time_base_in = stream->time_base;
+        if (av_bsf_init(bsf_ctx_) < 0) {
+            std::cerr << "FFmpegPacketSource: 无法初始化 h264_mp4toannexb 过滤器" << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    decoded_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    relay_packet_ = av_packet_alloc();
+    if (!decoded_ || !packet_ || !relay_packet_) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void FFmpegPacketSource::close() {
+    if (sws_ctx_) {
+        sws_freeContext(sws_ctx_);
+        sws_ctx_ = nullptr;
+    }
+    if (bsf_ctx_) {
+        av_bsf_free(&bsf_ctx_);
+    }
+    if (dec_ctx_) {
+        avcodec_free_context(&dec_ctx_);
+    }
+    if (fmt_ctx_) {
+        avformat_close_input(&fmt_ctx_);
+    }
+    if (decoded_) {
+        av_frame_free(&decoded_);
+    }
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
+    if (relay_packet_) {
+        av_packet_free(&relay_packet_);
+    }
+    video_index_ = -1;
+}
+
+bool FFmpegPacketSource::isH264() const {
+    return fmt_ctx_ && video_index_ >= 0 &&
+           fmt_ctx_->streams[video_index_]->codecpar->codec_id == AV_CODEC_ID_H264;
+}
+
+const AVCodecParameters* FFmpegPacketSource::relayCodecParameters() const {
+    if (bsf_ctx_) {
+        return bsf_ctx_->par_out;
+    }
+    if (fmt_ctx_ && video_index_ >= 0) {
+        return fmt_ctx_->streams[video_index_]->codecpar;
+    }
+    return nullptr;
+}
+
+AVRational FFmpegPacketSource::relayTimeBase() const {
+    if (bsf_ctx_) {
+        return bsf_ctx_->time_base_out;
+    }
+    if (fmt_ctx_ && video_index_ >= 0) {
+        return fmt_ctx_->streams[video_index_]->time_base;
+    }
+    return AVRational{1, 90000};
+}
+
+bool FFmpegPacketSource::receiveFrame(cv::Mat& frame) {
+    if (avcodec_receive_frame(dec_ctx_, decoded_) < 0) {
+        return false;
+    }
+
+    int dst_width = out_width_ > 0 ? out_width_ : decoded_->width;
+    int dst_height = out_height_ > 0 ? out_height_ : decoded_->height;
+
+    sws_ctx_ = sws_getCachedContext(sws_ctx_,
+                                    decoded_->width, decoded_->height,
+                                    static_cast<AVPixelFormat>(decoded_->format),
+                                    dst_width, dst_height, AV_PIX_FMT_BGR24,
+                                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_ctx_) {
+        av_frame_unref(decoded_);
+        return false;
+    }
+
+    frame.create(dst_height, dst_width, CV_8UC3);
+    uint8_t* dst_data[1] = { frame.data };
+    int dst_linesize[1] = { static_cast<int>(frame.step[0]) };
+    sws_scale(sws_ctx_, decoded_->data, decoded_->linesize, 0, decoded_->height,
+              dst_data, dst_linesize);
+
+    av_frame_unref(decoded_);
+    return true;
+}
+
+bool FFmpegPacketSource::read(cv::Mat& frame, bool& got_frame) {
+    got_frame = false;
+    if (!isOpened()) {
+        return false;
+    }
+
+    av_packet_unref(relay_packet_);
+
+    // 跳过非视频流的数据包
+    while (true) {
+        int ret = av_read_frame(fmt_ctx_, packet_);
+        if (ret < 0) {
+            return false;
+        }
+        if (packet_->stream_index == video_index_) {
+            break;
+        }
+        av_packet_unref(packet_);
+    }
+
+    // 生成待转发的数据包（引用计数，不拷贝数据）
+    if (bsf_ctx_) {
+        if (av_packet_ref(relay_packet_, packet_) == 0 &&
+            av_bsf_send_packet(bsf_ctx_, relay_packet_) == 0) {
+            if (av_bsf_receive_packet(bsf_ctx_, relay_packet_) < 0) {
+                av_packet_unref(relay_packet_);
+            }
+        }
+    } else {
+        av_packet_ref(relay_packet_, packet_);
+    }
+
+    // 解码
+    int ret = avcodec_send_packet(dec_ctx_, packet_);
+    if (ret == AVERROR(EAGAIN)) {
+        // 解码器输出缓冲已满，先取出一帧再重新送入
+        got_frame = receiveFrame(frame);
+        ret = avcodec_send_packet(dec_ctx_, packet_);
+    }
+    av_packet_unref(packet_);
+
+    if (!got_frame && ret >= 0) {
+        got_frame = receiveFrame(frame);
+    }
+
+    return true;
+}
+
+} // namespace detector_service
@@ -1,12 +1,12 @@
 #include "stream_manager.h"
 #include "config.h"
-#include "database.h"
 #include "channel.h"
 #include "algorithm_config.h"
 #include "gb28181_config.h"
 #include "common_utils.h"
 #include "ffmpeg_utils.h"
 #include "image_utils.h"
+#include "object_tracker.h"
 
 #ifdef ENABLE_BM1684
 #include "bm1684_video_decoder.h"
@@ -24,6 +24,20 @@
 
 namespace detector_service {
 
+namespace {
+
+ObjectTrackerOptions trackerOptions() {
+    const auto& tracker_config = Config::getInstance().getTrackerConfig();
+    ObjectTrackerOptions options;
+    options.enabled = tracker_config.enabled;
+    options.min_iou = tracker_config.min_iou;
+    options.max_lost_detections = tracker_config.max_lost_detections;
+    options.max_tracks = tracker_config.max_tracks;
+    return options;
+}
+
+} // namespace
+
 StreamManager::StreamManager() {
     // 注意：GB28181 SIP客户端初始化延迟到 initialize() 方法中
     // 因为需要等待数据库初始化完成
@@ -91,6 +105,10 @@ void StreamManager::setFrameCallback(FrameCallback callback) {
     frame_callback_ = callback;
 }
 
+void StreamManager::setPacketCallback(PacketCallback callback) {
+    packet_callback_ = callback;
+}
+
 
 bool StreamManager::startAnalysis(int channel_id, std::shared_ptr<Channel> channel,
                                  std::shared_ptr<YOLOv11Detector> detector) {
@@ -108,8 +126,14 @@ bool StreamManager::startAnalysis(int channel_id, std::shared_ptr<Channel> chann
     streams_[channel_id] = std::move(context);
     
     // 启动工作线程（在工作线程中异步打开流，避免阻塞主线程）
-    streams_[channel_id]->thread = std::thread(&StreamManager::streamWorker, this,
-                                                channel_id, channel, detector);
+    // 开启直通时使用直通工作线程，源不是H.264时由其回退到普通工作线程
+    if (Config::getInstance().getStreamConfig().passthrough) {
+        streams_[channel_id]->thread = std::thread(&StreamManager::streamWorkerPassthrough, this,
+                                                    channel_id, channel, detector);
+    } else {
+        streams_[channel_id]->thread = std::thread(&StreamManager::streamWorker, this,
+                                                    channel_id, channel, detector);
+    }
     
     // 立即返回，不等待流打开（避免阻塞）
     // 流打开操作在工作线程中异步执行
@@ -157,13 +181,11 @@ bool StreamManager::stopAnalysis(int channel_id) {
     streams_.erase(it);
     
     // 更新状态为stopped（如果enabled为false，则保持stopped；如果enabled为true，状态会在重新启动分析时更新）
-    auto& db = Database::getInstance();
     auto& channel_manager = ChannelManager::getInstance();
-    auto channel = channel_manager.getChannel(channel_id);
+    auto channel = channel_manager.getChannelSnapshot(channel_id);
     if (channel && !channel->enabled.load()) {
         // 如果enabled为false，更新状态为stopped
-        std::string updated_at = getCurrentTime();
-        db.updateChannelStatus(channel_id, "stopped", updated_at);
+        channel_manager.setChannelStatus(channel_id, ChannelStatus::STOPPED);
     }
     
     return true;
@@ -186,11 +208,22 @@ bool StreamManager::updateAlgorithmConfig(int channel_id, const AlgorithmConfig&
     {
         std::lock_guard<std::mutex> config_lock(it->second->config_mutex);
         it->second->algorithm_config = config;
+        it->second->compiled_filter.reset();
     }
     
     return true;
 }
 
+std::shared_ptr<const CompiledAlgorithmFilter> StreamManager::getCompiledFilter(
+    StreamContext& context, int frame_width, int frame_height) {
+    if (!context.compiled_filter ||
+        !context.compiled_filter->matchesSize(frame_width, frame_height)) {
+        context.compiled_filter = std::make_shared<const CompiledAlgorithmFilter>(
+            context.algorithm_config, frame_width, frame_height);
+    }
+    return context.compiled_filter;
+}
+
 void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channel,
                                  std::shared_ptr<YOLOv11Detector> detector) {
     // 获取 context 引用（需要加锁）
@@ -237,9 +270,7 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
             context->cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('H', '2', '6', '4'));
             
             // 拉流成功，更新状态为running
-            auto& db = Database::getInstance();
-            std::string updated_at = getCurrentTime();
-            db.updateChannelStatus(channel_id, "running", updated_at);
+            ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::RUNNING);
             std::cerr << "通道 " << channel_id << " 成功打开视频源: " << decoded_url << std::endl;
         } else {
             retry_count++;
@@ -248,9 +279,7 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
             } else {
                 std::cerr << "通道 " << channel_id << " 无法打开视频源（已重试 " << MAX_RETRIES << " 次）: " << decoded_url << std::endl;
                 // 更新状态为错误
-                auto& db = Database::getInstance();
-                std::string updated_at = getCurrentTime();
-                db.updateChannelStatus(channel_id, "error", updated_at);
+                ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::ERROR);
                 return;  // 打开失败，退出工作线程
             }
         }
@@ -308,6 +337,11 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
         detection_interval = context->algorithm_config.detection_interval;
     }
     int frame_counter = 0;  // 帧计数器
+
+    // 多目标跟踪：检测帧上分配轨迹ID，未检测的帧按运动模型移动上一次的检测框
+    ObjectTracker tracker(trackerOptions());
+    
+    const bool burn_in_overlay = !Config::getInstance().getStreamConfig().clientOverlay();
     
     // 重连相关变量
     int consecutive_failures = 0;
@@ -339,18 +373,14 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
             context->cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('H', '2', '6', '4'));
             consecutive_failures = 0;
             // 更新状态为running
-            auto& db = Database::getInstance();
-            std::string updated_at = getCurrentTime();
-            db.updateChannelStatus(channel_id, "running", updated_at);
+            ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::RUNNING);
             std::cerr << "通道 " << channel_id << " 重连成功" << std::endl;
             return true;
         } else {
             std::cerr << "通道 " << channel_id << " 流重连失败: " 
                       << decoded_url << std::endl;
             // 更新状态为error
-            auto& db = Database::getInstance();
-            std::string updated_at = getCurrentTime();
-            db.updateChannelStatus(channel_id, "error", updated_at);
+            ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::ERROR);
             return false;
         }
     };
@@ -379,6 +409,10 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
         consecutive_failures = 0;
         frame_counter++;
         
+        // 帧采集时间戳（毫秒），随帧和检测元数据一起下发
+        int64_t pts_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        
         // 检查是否需要检测（降低检测频率）
         bool need_detection = (frame_counter % detection_interval == 0);
         
@@ -394,35 +428,32 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
             // 只在指定间隔时进行检测
             detections = detector->detect(frame);
             
-            // 应用算法配置的过滤（类别、ROI等）
+            // 应用算法配置的过滤（类别、ROI等），过滤器在配置或帧尺寸变化时才重新编译
+            std::shared_ptr<const CompiledAlgorithmFilter> filter;
             {
                 std::lock_guard<std::mutex> config_lock(context->config_mutex);
-                detections = detector->applyFilters(
-                    detections,
-                    context->algorithm_config.enabled_classes,
-                    context->algorithm_config.rois,
-                    frame.cols,
-                    frame.rows
-                );
+                filter = getCompiledFilter(*context, frame.cols, frame.rows);
             }
+            detections = detector->applyFilters(detections, *filter);
+            tracker.update(detections);
             
             // 保存检测结果，用于后续帧的显示
             context->last_detections = detections;
-            
-            processed_frame = ImageUtils::drawDetections(frame, detections);
-        } else {
+        } else if (detector) {
             // 如果不需要检测，使用上一次的检测结果来绘制检测框，避免闪烁
-            if (detector && !context->last_detections.empty()) {
-                // 使用上一次的检测结果绘制检测框
-                processed_frame = ImageUtils::drawDetections(frame, context->last_detections);
-                // 使用上一次的检测结果作为当前帧的检测结果（用于回调）
-                detections = context->last_detections;
-            } else {
-                // 如果没有检测器或没有之前的检测结果，使用原始帧
-                processed_frame = frame.clone();
-            }
+            // 开启跟踪时检测框移动到各轨迹的预测位置，跳帧时检测框跟随目标
+            tracker.predict(context->last_detections);
+            detections = context->last_detections;
         }
         
+        // 检测框直接绘制在解码帧上（该帧每次读取都会被覆盖），不再克隆整帧
+        // 下游（WebSocket、GB28181、告警）需要保留时各自拷贝
+        // 客户端叠加模式下不绘制，检测结果由回调作为元数据下发
+        if (burn_in_overlay) {
+            context->overlay_renderer.drawInPlace(frame, detections);
+        }
+        processed_frame = frame;
+        
         // GB28181推流处理（如果通道激活）
         if (context->gb28181_info.is_active && context->gb28181_info.streamer && 
             context->gb28181_info.streamer->isStreaming()) {
@@ -442,7 +473,7 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
         // 调用回调函数 - 无论是否有检测结果，都要发送帧数据
         if (frame_callback_) {
             try {
-                frame_callback_(channel_id, processed_frame, detections);
+                frame_callback_(channel_id, processed_frame, detections, pts_ms, detector && need_detection);
             } catch (const std::exception& e) {
                 // 减少异常日志输出频率，避免日志刷屏
                 if (frame_counter % 100 == 0) {
@@ -468,6 +499,197 @@ void StreamManager::streamWorker(int channel_id, std::shared_ptr<Channel> channe
     }
 }
 
+void StreamManager::streamWorkerPassthrough(int channel_id, std::shared_ptr<Channel> channel,
+                                            std::shared_ptr<YOLOv11Detector> detector) {
+    std::unique_lock<std::mutex> lock(streams_mutex_);
+    auto it = streams_.find(channel_id);
+    if (it == streams_.end()) {
+        std::cerr << "StreamManager: 通道 " << channel_id << " 的 context 不存在" << std::endl;
+        return;
+    }
+    auto& context = it->second;
+    lock.unlock();
+    
+    std::string decoded_url = decodeUrlEntities(channel->source_url);
+    const int CONNECT_TIMEOUT_MS = 5000;
+    
+    FFmpegPacketSource source;
+    bool opened = false;
+    int retry_count = 0;
+    const int MAX_RETRIES = 3;
+    
+    while (!opened && retry_count < MAX_RETRIES && context->running.load()) {
+        if (retry_count > 0) {
+            std::cerr << "通道 " << channel_id << " 尝试重新连接 (第 " << retry_count << " 次)..." << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        }
+        opened = source.open(decoded_url, CONNECT_TIMEOUT_MS);
+        if (!opened) {
+            retry_count++;
+        }
+    }
+    
+    if (!context->running.load()) {
+        return;
+    }
+    
+    // 无法直通（打开失败或源不是H.264），回退到解码+编码的普通模式
+    if (!opened || !source.isH264()) {
+        std::cerr << "通道 " << channel_id << " 无法使用直通模式，回退到普通模式: " << decoded_url << std::endl;
+        source.close();
+        streamWorker(channel_id, channel, detector);
+        return;
+    }
+    
+    source.setOutputSize(channel->width, channel->height);
+    
+    {
+        ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::RUNNING);
+        std::cerr << "通道 " << channel_id << " 成功打开视频源（直通模式）: " << decoded_url << std::endl;
+    }
+    
+    // 加载通道的算法配置，并记录源码流参数供GB28181点播使用
+    {
+        std::lock_guard<std::mutex> config_lock(context->config_mutex);
+        auto& config_manager = AlgorithmConfigManager::getInstance();
+        if (!config_manager.getAlgorithmConfig(channel_id, context->algorithm_config)) {
+            std::cerr << "StreamManager: 无法加载通道 " << channel_id << " 的算法配置，使用默认配置" << std::endl;
+            context->algorithm_config = config_manager.getDefaultConfig(channel_id);
+        }
+        if (detector) {
+            detector->updateConfThreshold(context->algorithm_config.conf_threshold);
+            detector->updateNmsThreshold(context->algorithm_config.nms_threshold);
+        }
+        
+        if (!context->passthrough_codecpar) {
+            context->passthrough_codecpar = avcodec_parameters_alloc();
+        }
+        if (context->passthrough_codecpar) {
+            avcodec_parameters_copy(context->passthrough_codecpar, source.relayCodecParameters());
+        }
+        context->passthrough_time_base = source.relayTimeBase();
+    }
+    
+    // 初始化GB28181通道信息（如果启用）
+    auto& gb28181_config_mgr = GB28181ConfigManager::getInstance();
+    GB28181Config gb28181_config = gb28181_config_mgr.getGB28181Config();
+    if (gb28181_config.enabled.load()) {
+        std::string channel_code;
+        if (gb28181_config.device_id.length() >= 10) {
+            char channel_str[5];
+            snprintf(channel_str, sizeof(channel_str), "%04d", channel_id);
+            channel_code = gb28181_config.device_id.substr(0, 10) + "132" + std::string(channel_str) + 
+                          gb28181_config.device_id.substr(gb28181_config.device_id.length() - 3);
+        }
+        
+        context->gb28181_info.channel_id = channel_id;
+        context->gb28181_info.channel_code = channel_code;
+        context->gb28181_info.is_active = false;
+    }
+    
+    int detection_interval = 3;
+    {
+        std::lock_guard<std::mutex> config_lock(context->config_mutex);
+        detection_interval = context->algorithm_config.detection_interval;
+    }
+    int frame_counter = 0;
+
+    // 多目标跟踪：检测帧上分配轨迹ID，未检测的帧按运动模型移动上一次的检测框
+    ObjectTracker tracker(trackerOptions());
+    
+    int consecutive_failures = 0;
+    const int MAX_CONSECUTIVE_FAILURES = 10;
+    const int RECONNECT_DELAY_MS = 2000;
+    
+    cv::Mat frame;
+    
+    // 直通模式不做帧率控制：实时源的读取速度即源帧率，额外等待只会造成积压
+    while (context->running.load()) {
+        bool got_frame = false;
+        if (!source.read(frame, got_frame)) {
+            consecutive_failures++;
+            if (consecutive_failures >= MAX_CONSECUTIVE_FAILURES) {
+                std::cerr << "通道 " << channel_id << " 连续读取失败 " << consecutive_failures 
+                          << " 次，尝试重新连接流..." << std::endl;
+                source.close();
+                std::this_thread::sleep_for(std::chrono::milliseconds(RECONNECT_DELAY_MS));
+                
+                auto& channel_manager = ChannelManager::getInstance();
+                if (source.open(decoded_url, CONNECT_TIMEOUT_MS) && source.isH264()) {
+                    source.setOutputSize(channel->width, channel->height);
+                    consecutive_failures = 0;
+                    channel_manager.setChannelStatus(channel_id, ChannelStatus::RUNNING);
+                    std::cerr << "通道 " << channel_id << " 重连成功" << std::endl;
+                } else {
+                    std::cerr << "通道 " << channel_id << " 流重连失败: " << decoded_url << std::endl;
+                    channel_manager.setChannelStatus(channel_id, ChannelStatus::ERROR);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+                }
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            continue;
+        }
+        consecutive_failures = 0;
+        
+        int64_t pts_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        
+        // 转发源码流数据包：WebSocket 观看端和 GB28181 都不再重新编码
+        if (const AVPacket* pkt = source.relayPacket()) {
+            bool keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+            if (packet_callback_) {
+                packet_callback_(channel_id, pkt->data, static_cast<size_t>(pkt->size), keyframe, pts_ms);
+            }
+            
+            if (context->gb28181_info.is_active && context->gb28181_info.streamer &&
+                context->gb28181_info.streamer->isStreaming() &&
+                context->gb28181_info.streamer->isPassthrough()) {
+                context->gb28181_info.streamer->pushPacket(pkt);
+            }
+        }
+        
+        if (!got_frame) {
+            continue;
+        }
+        frame_counter++;
+        
+        // 解码帧仅用于检测，检测结果由回调作为元数据下发（画面不绘制检测框）
+        bool need_detection = (frame_counter % detection_interval == 0);
+        std::vector<Detection> detections;
+        if (detector && need_detection) {
+            detections = detector->detect(frame);
+            
+            std::shared_ptr<const CompiledAlgorithmFilter> filter;
+            {
+                std::lock_guard<std::mutex> config_lock(context->config_mutex);
+                filter = getCompiledFilter(*context, frame.cols, frame.rows);
+            }
+            detections = detector->applyFilters(detections, *filter);
+            tracker.update(detections);
+            context->last_detections = detections;
+        } else if (detector) {
+            tracker.predict(context->last_detections);
+            detections = context->last_detections;
+        }
+        
+        if (frame_callback_) {
+            try {
+                frame_callback_(channel_id, frame, detections, pts_ms, detector && need_detection);
+            } catch (const std::exception& e) {
+                if (frame_counter % 100 == 0) {
+                    std::cerr << "调用帧回调函数时发生异常: " << e.what() << std::endl;
+                }
+            }
+        }
+    }
+    
+    // 通知观看端直通结束
+    if (packet_callback_) {
+        packet_callback_(channel_id, nullptr, 0, false, 0);
+    }
+}
+
 bool StreamManager::initGB28181SipClient() {
     auto& config_mgr = GB28181ConfigManager::getInstance();
     GB28181Config config = config_mgr.getGB28181Config();
@@ -555,8 +777,23 @@ void StreamManager::handleGB28181Invite(const GB28181Session& session) {
                     detector_config.use_bm1684_hw_decode;
 #endif
     
+    // 通道处于直通模式时直接封装源码流，否则编码分析后的画面
+    bool initialized = false;
+    {
+        std::lock_guard<std::mutex> config_lock(context->config_mutex);
+        if (context->passthrough_codecpar) {
+            initialized = context->gb28181_info.streamer->initializePassthrough(
+                gb28181_config,
+                context->passthrough_codecpar,
+                context->passthrough_time_base,
+                session.dest_ip,
+                session.dest_port,
+                session.ssrc);
+        }
+    }
+    
     // 初始化推流器
-    if (!context->gb28181_info.streamer->initialize(
+    if (!initialized && !context->gb28181_info.streamer->initialize(
             gb28181_config,
             channel->width,
             channel->height,
@@ -672,17 +909,13 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
                                                detector_config.bm1684_pcie_no_copyback);
         
         if (opened) {
-            auto& db = Database::getInstance();
-            std::string updated_at = getCurrentTime();
-            db.updateChannelStatus(channel_id, "running", updated_at);
+            ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::RUNNING);
             std::cerr << "通道 " << channel_id << " 成功打开BM1684视频源: " << decoded_url << std::endl;
         } else {
             retry_count++;
             if (retry_count >= MAX_RETRIES) {
                 std::cerr << "通道 " << channel_id << " 无法打开BM1684视频源（已重试 " << MAX_RETRIES << " 次）: " << decoded_url << std::endl;
-                auto& db = Database::getInstance();
-                std::string updated_at = getCurrentTime();
-                db.updateChannelStatus(channel_id, "error", updated_at);
+                ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::ERROR);
                 return;
             }
         }
@@ -733,6 +966,11 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
         detection_interval = context->algorithm_config.detection_interval;
     }
     int frame_counter = 0;
+
+    // 多目标跟踪：检测帧上分配轨迹ID，未检测的帧按运动模型移动上一次的检测框
+    ObjectTracker tracker(trackerOptions());
+    
+    const bool burn_in_overlay = !Config::getInstance().getStreamConfig().clientOverlay();
     
     int consecutive_failures = 0;
     const int MAX_CONSECUTIVE_FAILURES = 10;
@@ -754,15 +992,11 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
                                                    detector_config.bm1684_sophon_idx,
                                                    detector_config.bm1684_pcie_no_copyback)) {
                     std::cerr << "通道 " << channel_id << " BM1684重连失败" << std::endl;
-                    auto& db = Database::getInstance();
-                    std::string updated_at = getCurrentTime();
-                    db.updateChannelStatus(channel_id, "error", updated_at);
+                    ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::ERROR);
                     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
                 } else {
                     consecutive_failures = 0;
-                    auto& db = Database::getInstance();
-                    std::string updated_at = getCurrentTime();
-                    db.updateChannelStatus(channel_id, "running", updated_at);
+                    ChannelManager::getInstance().setChannelStatus(channel_id, ChannelStatus::RUNNING);
                 }
             } else {
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -773,6 +1007,9 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
         consecutive_failures = 0;
         frame_counter++;
         
+        int64_t pts_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        
         bool need_detection = (frame_counter % detection_interval == 0);
         
         // 调整大小
@@ -785,27 +1022,24 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
         if (detector && need_detection) {
             detections = detector->detect(frame);
             
+            std::shared_ptr<const CompiledAlgorithmFilter> filter;
             {
                 std::lock_guard<std::mutex> config_lock(context->config_mutex);
-                detections = detector->applyFilters(
-                    detections,
-                    context->algorithm_config.enabled_classes,
-                    context->algorithm_config.rois,
-                    frame.cols,
-                    frame.rows
-                );
+                filter = getCompiledFilter(*context, frame.cols, frame.rows);
             }
+            detections = detector->applyFilters(detections, *filter);
+            tracker.update(detections);
             
             context->last_detections = detections;
-            processed_frame = ImageUtils::drawDetections(frame, detections);
-        } else {
-            if (detector && !context->last_detections.empty()) {
-                processed_frame = ImageUtils::drawDetections(frame, context->last_detections);
-                detections = context->last_detections;
-            } else {
-                processed_frame = frame.clone();
-            }
+        } else if (detector) {
+            tracker.predict(context->last_detections);
+            detections = context->last_detections;
+        }
+        
+        if (burn_in_overlay) {
+            context->overlay_renderer.drawInPlace(frame, detections);
         }
+        processed_frame = frame;
         
         // GB28181推流处理
         if (context->gb28181_info.is_active && context->gb28181_info.streamer && 
@@ -821,7 +1055,7 @@ void StreamManager::streamWorkerBM1684(int channel_id, std::shared_ptr<Channel>
         // 调用回调函数
         if (frame_callback_) {
             try {
-                frame_callback_(channel_id, processed_frame, detections);
+                frame_callback_(channel_id, processed_frame, detections, pts_ms, detector && need_detection);
             } catch (const std::exception& e) {
                 if (frame_counter % 100 == 0) {
                     std::cerr << "调用帧回调函数时发生异常: " << e.what() << std::endl;
@@ -0,0 +1,130 @@
+#include "temporal_rule.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace detector_service {
+
+namespace {
+
+// 两次检测间隔超过该值（通道重启或断流恢复）时清空窗口，不沿用中断前的历史
+constexpr int64_t kResumeGapMs = 10000;
+
+} // namespace
+
+void ChannelRuleState::RuleWindow::reset() {
+    head = 0;
+    filled = 0;
+    hits = 0;
+    streak_start_ms = -1;
+}
+
+ChannelRuleState::ChannelRuleState(const AlgorithmConfig& config)
+    : version_(config.version),
+      windows_(config.alert_rules.size()) {
+    for (size_t i = 0; i < windows_.size(); ++i) {
+        int window_size = std::clamp(config.alert_rules[i].window_size, 1, kMaxRuleWindowSize);
+        windows_[i].slots.resize(static_cast<size_t>(window_size));
+    }
+}
+
+bool ChannelRuleState::update(size_t rule_index, const AlertRule& rule, size_t matched_count, int64_t pts_ms) {
+    if (rule_index >= windows_.size()) {
+        return false;
+    }
+    RuleWindow& window = windows_[rule_index];
+
+    if (window.filled > 0 && pts_ms - window.last_pts_ms > kResumeGapMs) {
+        window.reset();
+    }
+    window.last_pts_ms = pts_ms;
+
+    const size_t capacity = window.slots.size();
+    const bool full = window.filled == capacity;
+    RuleWindow::Slot& slot = window.slots[window.head];
+    const int count = static_cast<int>(matched_count);
+
+    bool hit;
+    if (rule.count_delta > 0) {
+        // 与 M 次检测前的数量比较（窗口未满时与最早的一次比较），窗口已满时待覆盖的槽位即为 M 次前
+        int previous = full ? slot.count : (window.filled > 0 ? window.slots[0].count : count);
+        hit = std::abs(count - previous) >= rule.count_delta;
+    } else {
+        hit = AlgorithmConfigManager::isRuleCountSatisfied(rule, matched_count);
+    }
+
+    // 覆盖最早的一次，命中次数同步增减
+    if (full && slot.hit) {
+        window.hits--;
+    }
+    slot.count = count;
+    slot.hit = hit;
+    if (hit) {
+        window.hits++;
+    }
+    window.head = (window.head + 1) % capacity;
+    if (!full) {
+        window.filled++;
+    }
+
+    if (window.hits < rule.min_hits) {
+        window.streak_start_ms = -1;
+        return false;
+    }
+    if (window.streak_start_ms < 0) {
+        window.streak_start_ms = pts_ms;
+    }
+    return pts_ms - window.streak_start_ms >= static_cast<int64_t>(rule.min_duration_seconds) * 1000;
+}
+
+bool ChannelRuleState::claimTracks(size_t rule_index, const std::vector<Detection>& matched,
+                                   std::vector<int>& claimed) {
+    claimed.clear();
+    if (rule_index >= windows_.size()) {
+        return true;
+    }
+    RuleWindow& window = windows_[rule_index];
+
+    std::lock_guard<std::mutex> lock(tracks_mutex_);
+    bool has_new = false;
+    for (const auto& detection : matched) {
+        if (detection.track_id < 0) {
+            has_new = true;
+            continue;
+        }
+        if (std::find(window.alerted_tracks.begin(), window.alerted_tracks.end(), detection.track_id) !=
+            window.alerted_tracks.end()) {
+            continue;
+        }
+        has_new = true;
+        window.alerted_tracks[window.alerted_next] = detection.track_id;
+        window.alerted_next = (window.alerted_next + 1) % window.alerted_tracks.size();
+        claimed.push_back(detection.track_id);
+    }
+    return has_new;
+}
+
+void ChannelRuleState::releaseTracks(size_t rule_index, const std::vector<int>& track_ids) {
+    if (rule_index >= windows_.size() || track_ids.empty()) {
+        return;
+    }
+    RuleWindow& window = windows_[rule_index];
+
+    std::lock_guard<std::mutex> lock(tracks_mutex_);
+    for (int track_id : track_ids) {
+        auto it = std::find(window.alerted_tracks.begin(), window.alerted_tracks.end(), track_id);
+        if (it != window.alerted_tracks.end()) {
+            *it = 0;
+        }
+    }
+}
+
+std::shared_ptr<ChannelRuleState> TemporalRuleEngine::channelState(int channel_id, const AlgorithmConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = states_[channel_id];
+    if (!state || state->version() != config.version) {
+        state = std::make_shared<ChannelRuleState>(config);
+    }
+    return state;
+}
+
+} // namespace detector_service
@@ -0,0 +1,193 @@
+// 报警上报压测工具
+// 启动本地 mosquitto broker，通过 ReportService 持续上报合成报警，统计收到 PUBACK 的吞吐量。
+//
+// 用法: report_bench [--count N] [--image-kb K] [--port P] [--topic T]
+//                    [--inflight N] [--workers N] [--db PATH] [--no-broker]
+// 全部报警确认后退出码为 0，有报警失败或超时时为 1。
+
+#include "database.h"
+#include "alert.h"
+#include "report_config.h"
+#include "report_service.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace detector_service;
+
+namespace {
+
+struct BenchOptions {
+    int count = 10000;
+    int image_kb = 64;
+    int port = 18830;
+    std::string topic = "bench/{channel_id}/{rule_id}";
+    int inflight = 100;
+    int workers = 2;
+    std::string db_path = "report_bench.db";
+    bool spawn_broker = true;
+};
+
+bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--no-broker") {
+            options.spawn_broker = false;
+            continue;
+        }
+        if ((value = next()) == nullptr) {
+            std::cerr << "缺少参数值: " << arg << std::endl;
+            return false;
+        }
+        if (arg == "--count") {
+            options.count = std::atoi(value);
+        } else if (arg == "--image-kb") {
+            options.image_kb = std::atoi(value);
+        } else if (arg == "--port") {
+            options.port = std::atoi(value);
+        } else if (arg == "--topic") {
+            options.topic = value;
+        } else if (arg == "--inflight") {
+            options.inflight = std::atoi(value);
+        } else if (arg == "--workers") {
+            options.workers = std::atoi(value);
+        } else if (arg == "--db") {
+            options.db_path = value;
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    return options.count > 0;
+}
+
+// 启动本地 broker（mosquitto 需在 PATH 中）
+pid_t spawnBroker(int port) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::string port_str = std::to_string(port);
+        execlp("mosquitto", "mosquitto", "-p", port_str.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    if (pid > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));  // 等待 broker 开始监听
+        int status = 0;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            std::cerr << "mosquitto 启动失败（端口 " << port << " 已被占用或未安装 mosquitto）" << std::endl;
+            return -1;
+        }
+    }
+    return pid;
+}
+
+void stopBroker(pid_t pid) {
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    pid_t broker = -1;
+    if (options.spawn_broker) {
+        broker = spawnBroker(options.port);
+        if (broker < 0) {
+            return 2;
+        }
+    }
+
+    std::remove(options.db_path.c_str());
+    if (!Database::getInstance().initialize(options.db_path)) {
+        stopBroker(broker);
+        return 2;
+    }
+
+    ReportConfig config;
+    config.type = ReportType::MQTT;
+    config.mqtt_broker = "127.0.0.1";
+    config.mqtt_port = options.port;
+    config.mqtt_topic = options.topic;
+    config.mqtt_client_id = "report_bench";
+    config.enabled = true;
+    ReportConfigManager::getInstance().updateReportConfig(config);
+
+    ReportDeliveryOptions delivery;
+    delivery.workers = options.workers;
+    delivery.mqtt_max_inflight = options.inflight;
+    delivery.image_mode = ReportDeliveryOptions::ImageMode::RAW;
+    auto& report_service = ReportService::getInstance();
+    report_service.start(delivery);
+
+    // 合成报警：所有报警共享同一份图片缓冲区，与告警线程池的用法一致
+    auto jpeg = std::make_shared<const std::vector<unsigned char>>(
+        static_cast<size_t>(std::max(0, options.image_kb)) * 1024, static_cast<unsigned char>(0xAB));
+    std::vector<AlertRecord> alerts(options.count);
+    auto& alert_manager = AlertManager::getInstance();
+    for (int i = 0; i < options.count; ++i) {
+        AlertRecord& alert = alerts[i];
+        alert.channel_id = 1 + i % 16;
+        alert.channel_name = "bench-" + std::to_string(alert.channel_id);
+        alert.alert_type = "person";
+        alert.alert_rule_id = 1 + i % 4;
+        alert.alert_rule_name = "rule-" + std::to_string(alert.alert_rule_id);
+        alert.confidence = 0.9f;
+        alert.detected_objects = R"([{"class_name":"person","confidence":0.9,"bbox":[10,20,100,200]}])";
+        alert.report_status = "pending";
+        alert.id = alert_manager.createAlert(alert);
+        alert.image_jpeg = jpeg;
+    }
+
+    // 等待 MQTT 连接建立后再计时
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    auto start = std::chrono::steady_clock::now();
+    const auto& report_config = ReportConfigManager::getInstance().getReportConfig();
+    for (const auto& alert : alerts) {
+        report_service.reportAlert(alert, report_config);
+    }
+    auto submitted = std::chrono::steady_clock::now();
+
+    ReportStats stats;
+    auto deadline = submitted + std::chrono::seconds(60);
+    while (std::chrono::steady_clock::now() < deadline) {
+        stats = report_service.getStats();
+        if (stats.pending == 0) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto finished = std::chrono::steady_clock::now();
+
+    double submit_s = std::chrono::duration<double>(submitted - start).count();
+    double total_s = std::chrono::duration<double>(finished - start).count();
+    std::cout << "报警数: " << options.count << "，图片: " << options.image_kb << " KB"
+              << "，在途上限: " << options.inflight << "，上报线程: " << options.workers << std::endl;
+    std::cout << "提交耗时: " << submit_s << " s，全部确认耗时: " << total_s << " s" << std::endl;
+    std::cout << "吞吐量: " << (total_s > 0 ? stats.delivered / total_s : 0.0) << " 条/秒" << std::endl;
+    std::cout << "成功: " << stats.delivered << "，失败: " << stats.failed
+              << "，重试: " << stats.retried << "，未完成: " << stats.pending << std::endl;
+
+    report_service.cleanup();
+    stopBroker(broker);
+
+    bool ok = stats.delivered == static_cast<uint64_t>(options.count) && stats.pending == 0;
+    return ok ? 0 : 1;
+}
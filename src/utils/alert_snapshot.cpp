@@ -0,0 +1,77 @@
+#include "alert_snapshot.h"
+#include "image_utils.h"
+#include <algorithm>
+
+namespace detector_service {
+
+std::shared_ptr<const AlertSnapshot> AlertSnapshot::create(const cv::Mat& frame, const AlertSnapshotOptions& options) {
+    if (frame.empty()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<AlertSnapshot> snapshot(new AlertSnapshot());
+    cv::Rect full(0, 0, frame.cols, frame.rows);
+    snapshot->region_ = full;
+    if (!options.crop_region.empty()) {
+        snapshot->region_ = options.crop_region & full;
+        if (snapshot->region_.empty()) {
+            return nullptr;
+        }
+        snapshot->cropped_ = snapshot->region_ != full;
+    }
+
+    // 截取区域直接引用原画面（ROI），不复制像素
+    auto jpeg = std::make_shared<std::vector<uchar>>();
+    if (!ImageUtils::encodeJpeg(frame(snapshot->region_), options.jpeg_quality, *jpeg)) {
+        return nullptr;
+    }
+    snapshot->jpeg_ = std::move(jpeg);
+
+    // 缩略图只在整帧比目标宽度大时生成
+    if (options.thumbnail_width > 0 && frame.cols > options.thumbnail_width) {
+        int thumb_height = std::max(1, frame.rows * options.thumbnail_width / frame.cols);
+        cv::Mat thumb;
+        cv::resize(frame, thumb, cv::Size(options.thumbnail_width, thumb_height), 0, 0, cv::INTER_AREA);
+
+        auto thumbnail = std::make_shared<std::vector<uchar>>();
+        if (ImageUtils::encodeJpeg(thumb, options.thumbnail_quality, *thumbnail)) {
+            snapshot->thumbnail_ = std::move(thumbnail);
+        }
+    }
+
+    return snapshot;
+}
+
+cv::Rect AlertSnapshot::expandRegion(const cv::Rect& bbox, float margin, int min_size, const cv::Size& frame_size) {
+    int width = std::max(bbox.width + 2 * static_cast<int>(bbox.width * margin), min_size);
+    int height = std::max(bbox.height + 2 * static_cast<int>(bbox.height * margin), min_size);
+    width = std::min(width, frame_size.width);
+    height = std::min(height, frame_size.height);
+
+    // 以检测框中心为中心，超出画面时整体平移回画面内
+    int x = bbox.x + bbox.width / 2 - width / 2;
+    int y = bbox.y + bbox.height / 2 - height / 2;
+    x = std::max(0, std::min(x, frame_size.width - width));
+    y = std::max(0, std::min(y, frame_size.height - height));
+    return cv::Rect(x, y, width, height);
+}
+
+AlertSnapshot::Text AlertSnapshot::encodeBase64Once(const Buffer& buffer, std::once_flag& flag, Text& cache) {
+    std::call_once(flag, [&buffer, &cache] {
+        cache = std::make_shared<const std::string>(ImageUtils::base64Encode(*buffer));
+    });
+    return cache;
+}
+
+AlertSnapshot::Text AlertSnapshot::jpegBase64() const {
+    return encodeBase64Once(jpeg_, jpeg_base64_once_, jpeg_base64_);
+}
+
+AlertSnapshot::Text AlertSnapshot::thumbnailBase64() const {
+    if (!thumbnail_) {
+        return jpegBase64();
+    }
+    return encodeBase64Once(thumbnail_, thumbnail_base64_once_, thumbnail_base64_);
+}
+
+} // namespace detector_service
@@ -1,4 +1,5 @@
 #include "image_utils.h"
+#include "overlay_renderer.h"
 #include <vector>
 #include <sstream>
 #include <iomanip>
@@ -22,12 +23,28 @@ std::string ImageUtils::matToBase64(const cv::Mat& image, const std::string& for
     
     cv::imencode(format, image, buffer, params);
     
-    // Base64 编码
+    return base64Encode(buffer);
+}
+
+bool ImageUtils::encodeJpeg(const cv::Mat& image, int quality, std::vector<uchar>& buffer) {
+    if (image.empty()) {
+        return false;
+    }
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, std::max(0, std::min(100, quality))};
+    return cv::imencode(".jpg", image, buffer, params);
+}
+
+std::string ImageUtils::base64Encode(const std::vector<uchar>& buffer) {
+    std::string result;
+    appendBase64(buffer, result);
+    return result;
+}
+
+void ImageUtils::appendBase64(const std::vector<uchar>& buffer, std::string& result) {
     const char base64_chars[] = 
         "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     
-    std::string result;
-    result.reserve((buffer.size() + 2) / 3 * 4);
+    result.reserve(result.size() + (buffer.size() + 2) / 3 * 4);
     
     for (size_t i = 0; i < buffer.size(); i += 3) {
         uint32_t value = 0;
@@ -47,8 +64,6 @@ std::string ImageUtils::matToBase64(const cv::Mat& image, const std::string& for
             }
         }
     }
-    
-    return result;
 }
 
 cv::Mat ImageUtils::base64ToMat(const std::string& base64_string) {
@@ -86,32 +101,11 @@ cv::Mat ImageUtils::base64ToMat(const std::string& base64_string) {
 }
 
 cv::Mat ImageUtils::drawDetections(const cv::Mat& image, const std::vector<Detection>& detections) {
-    cv::Mat result = image.clone();
-    
-    for (const auto& det : detections) {
-        // 绘制边界框
-        cv::rectangle(result, det.bbox, cv::Scalar(0, 255, 0), 2);
-        
-        // 准备标签文本
-        std::ostringstream label;
-        label << det.class_name << " " << std::fixed << std::setprecision(2) << det.confidence;
-        
-        // 计算文本大小
-        int baseline = 0;
-        cv::Size text_size = cv::getTextSize(label.str(), cv::FONT_HERSHEY_SIMPLEX, 
-                                              0.5, 1, &baseline);
-        
-        // 绘制标签背景
-        cv::Rect label_bg(det.bbox.x, det.bbox.y - text_size.height - 10,
-                         text_size.width + 10, text_size.height + 10);
-        cv::rectangle(result, label_bg, cv::Scalar(0, 255, 0), -1);
-        
-        // 绘制标签文本
-        cv::putText(result, label.str(), 
-                   cv::Point(det.bbox.x + 5, det.bbox.y - 5),
-                   cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
-    }
+    // 每个线程复用一个渲染器，共享标签贴图缓存
+    thread_local OverlayRenderer renderer;
     
+    cv::Mat result = image.clone();
+    renderer.drawInPlace(result, detections);
     return result;
 }
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace detector_service {
+
+// 告警快照编码参数
+struct AlertSnapshotOptions {
+    int jpeg_quality = 90;       // 告警图片 JPEG 质量
+    cv::Rect crop_region;        // 告警图片截取区域，为空时使用整帧
+    int thumbnail_width = 0;     // 整帧缩略图宽度（像素），0 表示不生成缩略图
+    int thumbnail_quality = 70;  // 缩略图 JPEG 质量
+};
+
+/**
+ * @brief 告警快照
+ * 告警画面只编码一次，编码结果以只读共享缓冲区的形式交给图片文件、WebSocket 推送和上报使用，
+ * base64 文本在第一次使用时生成并缓存，各路使用方之间不再复制图片数据。
+ * 告警图片（整帧或目标区域）和整帧缩略图从同一帧画面一次生成，截取区域不复制像素。
+ */
+class AlertSnapshot {
+public:
+    using Buffer = std::shared_ptr<const std::vector<uchar>>;
+    using Text = std::shared_ptr<const std::string>;
+
+    /**
+     * @brief 编码告警画面
+     * @return 编码失败（画面为空、截取区域在画面外或 JPEG 编码出错）时返回 nullptr
+     */
+    static std::shared_ptr<const AlertSnapshot> create(const cv::Mat& frame, const AlertSnapshotOptions& options);
+
+    /**
+     * @brief 计算检测框的截取区域
+     * 检测框向四周各扩展 margin 倍宽高，边长不小于 min_size，并限制在画面内
+     */
+    static cv::Rect expandRegion(const cv::Rect& bbox, float margin, int min_size, const cv::Size& frame_size);
+
+    // 告警图片在原始画面中的位置（整帧时为整个画面）
+    const cv::Rect& region() const { return region_; }
+    bool isCropped() const { return cropped_; }
+
+    // 告警图片 JPEG（整帧或目标区域）
+    const Buffer& jpeg() const { return jpeg_; }
+    Text jpegBase64() const;
+
+    // 整帧缩略图 JPEG，未生成缩略图时返回告警图片，保证预览总有图可用
+    bool hasThumbnail() const { return thumbnail_ != nullptr; }
+    const Buffer& thumbnail() const { return thumbnail_ ? thumbnail_ : jpeg_; }
+    Text thumbnailBase64() const;
+
+    AlertSnapshot(const AlertSnapshot&) = delete;
+    AlertSnapshot& operator=(const AlertSnapshot&) = delete;
+
+private:
+    AlertSnapshot() = default;
+
+    static Text encodeBase64Once(const Buffer& buffer, std::once_flag& flag, Text& cache);
+
+    cv::Rect region_;
+    bool cropped_ = false;
+    Buffer jpeg_;
+    Buffer thumbnail_;
+
+    mutable std::once_flag jpeg_base64_once_;
+    mutable Text jpeg_base64_;
+    mutable std::once_flag thumbnail_base64_once_;
+    mutable Text thumbnail_base64_;
+};
+
+} // namespace detector_service
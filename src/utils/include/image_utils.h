@@ -11,6 +11,7 @@ struct Detection {
     std::string class_name;
     float confidence;
     cv::Rect bbox;
+    int track_id = -1;  // 跟踪轨迹ID，-1 表示未跟踪
 };
 
 class ImageUtils {
@@ -19,6 +20,15 @@ public:
     // quality: JPEG 质量 (0-100)，默认 90
     static std::string matToBase64(const cv::Mat& image, const std::string& format = ".jpg", int quality = 90);
     
+    // 编码为 JPEG，quality: JPEG 质量 (0-100)
+    static bool encodeJpeg(const cv::Mat& image, int quality, std::vector<uchar>& buffer);
+    
+    // 将二进制数据编码为 base64 字符串
+    static std::string base64Encode(const std::vector<uchar>& buffer);
+    
+    // 将二进制数据编码为 base64 并追加到 result 末尾（拼接大报文时不产生中间字符串）
+    static void appendBase64(const std::vector<uchar>& buffer, std::string& result);
+    
     // 将 base64 字符串转换为 OpenCV Mat
     static cv::Mat base64ToMat(const std::string& base64_string);
     
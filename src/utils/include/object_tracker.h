@@ -0,0 +1,79 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include "image_utils.h"
+
+namespace detector_service {
+
+// 多目标跟踪参数（由 stream 按 TrackerConfig 设置）
+struct ObjectTrackerOptions {
+    bool enabled = true;
+    float min_iou = 0.3f;          // 检测框与轨迹预测框关联的最小 IoU
+    int max_lost_detections = 5;   // 轨迹连续多少次检测未关联后删除
+    int max_tracks = 64;           // 同时跟踪的最大目标数
+};
+
+/**
+ * @brief 多目标跟踪器（SORT）
+ * 每条轨迹用匀速卡尔曼滤波器估计检测框的中心和宽高（速度以帧为单位），检测帧上以 1-IoU 为代价，
+ * 用匈牙利算法将检测结果与轨迹的预测框一一关联（类别不同不关联），未关联的检测结果创建新轨迹；
+ * 未检测的帧只推进运动模型，检测框跟随目标移动。
+ * 轨迹、代价矩阵和匈牙利算法的缓冲区在构造时按 max_tracks 一次分配，滤波使用定长矩阵，逐帧更新不分配内存。
+ * 轨迹ID在进程内唯一（跨通道、通道重启后也不会重复）。
+ * 非线程安全：每个通道的工作线程持有自己的实例
+ */
+class ObjectTracker {
+public:
+    explicit ObjectTracker(const ObjectTrackerOptions& options);
+
+    bool enabled() const { return options_.enabled; }
+
+    // 检测帧：推进运动模型后与检测结果关联，填写 Detection::track_id（检测框保持检测器的输出）
+    // 超过 max_tracks 的检测结果不跟踪，track_id 为 -1
+    void update(std::vector<Detection>& detections);
+
+    // 未检测的帧：推进运动模型，将上一次检测结果中各目标的检测框替换为对应轨迹的预测位置
+    void predict(std::vector<Detection>& detections);
+
+    // 清空所有轨迹
+    void reset() { tracks_.clear(); }
+
+private:
+    using StateVec = cv::Vec<float, 8>;      // cx, cy, w, h 及各自的速度
+    using StateMat = cv::Matx<float, 8, 8>;
+
+    struct Track {
+        int id = 0;
+        int class_id = 0;
+        StateVec mean;
+        StateMat covariance;
+        int lost = 0;  // 连续未关联的检测次数
+    };
+
+    static void initiate(Track& track, const cv::Rect& bbox);
+    static void predictTrack(Track& track);
+    static void correct(Track& track, const cv::Rect& bbox);
+    static cv::Rect2f stateRect(const StateVec& mean);
+
+    // 求解 n×n 代价矩阵 cost_ 的最小代价分配，结果写入 assignment_（行 -> 列）
+    void solveAssignment(int n);
+
+    ObjectTrackerOptions options_;
+    size_t capacity_;
+    std::vector<Track> tracks_;
+
+    std::vector<float> cost_;      // 行为轨迹，列为检测结果，不足 n 时以代价 1 补齐
+    std::vector<int> assignment_;
+    std::vector<char> matched_;    // 检测帧上各轨迹是否已关联
+
+    // 匈牙利算法缓冲区（下标从 1 开始）
+    std::vector<float> u_;
+    std::vector<float> v_;
+    std::vector<float> minv_;
+    std::vector<int> p_;
+    std::vector<int> way_;
+    std::vector<char> used_;
+};
+
+} // namespace detector_service
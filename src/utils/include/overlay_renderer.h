@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "image_utils.h"
+
+namespace detector_service {
+
+// 检测框叠加渲染器
+// - 直接在调用方的帧上绘制，或绘制到复用的画布缓冲区，避免每帧克隆整帧
+// - 标签按 (类别, 置信度百分位) 缓存为预渲染的贴图，避免每帧重复排版文字
+// 非线程安全：每个通道的工作线程持有自己的实例
+class OverlayRenderer {
+public:
+    OverlayRenderer() = default;
+
+    // 在 frame 上原地绘制检测框和标签
+    void drawInPlace(cv::Mat& frame, const std::vector<Detection>& detections);
+
+    // 将 frame 复制到内部复用的画布后绘制，frame 保持不变
+    // 返回的画布在下一次调用 render 之前有效
+    const cv::Mat& render(const cv::Mat& frame, const std::vector<Detection>& detections);
+
+    // 清空标签贴图缓存
+    void clearLabelCache() { label_cache_.clear(); }
+
+private:
+    struct LabelSprite {
+        std::string class_name;
+        cv::Mat image;
+    };
+
+    const cv::Mat& getLabelSprite(const Detection& det);
+    static void blit(cv::Mat& frame, const cv::Mat& sprite, int x, int y);
+
+    cv::Mat canvas_;  // render 使用的复用画布
+    std::unordered_map<uint64_t, LabelSprite> label_cache_;
+};
+
+} // namespace detector_service
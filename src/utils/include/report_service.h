@@ -1,19 +1,78 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <map>
+#include <unordered_set>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <thread>
-#include <queue>
 #include <chrono>
+#include <functional>
+#include <cstdint>
 #include "report_config.h"
 #include "alert.h"
 #include <mosquitto.h>
 
+namespace httplib {
+class Client;
+}
+
 namespace detector_service {
 
+// 上报投递参数（由 service 按 ReportDeliveryConfig 设置）
+struct ReportDeliveryOptions {
+    int workers = 2;                // 并发上报线程数
+    int batch_size = 1;             // HTTP 每次 POST 合并的报警数，大于 1 时请求体为 JSON 数组
+    int max_attempts = 10;          // 最多尝试次数
+    int retry_base_ms = 2000;       // 首次重试延迟（毫秒），之后每次加倍
+    int retry_max_ms = 300000;      // 重试延迟上限（毫秒）
+    int http_timeout_seconds = 5;   // HTTP 连接和读取超时
+    int mqtt_max_inflight = 100;    // MQTT 已发布但未收到 PUBACK 的最大消息数
+    int mqtt_ack_timeout_seconds = 30;  // 超过该时间未收到 PUBACK 的消息重新排队
+    
+    // 报警图片的编码方式
+    enum class ImageMode {
+        BASE64,  // 图片 base64 后内嵌在 JSON 中
+        RAW,     // 原始 JPEG 字节：HTTP 使用 multipart/form-data，MQTT 使用二进制负载
+        URL      // 只上报图片地址，接收端按需从 /api/alerts/<id>/image 下载
+    };
+    ImageMode image_mode = ImageMode::BASE64;
+    std::string image_base_url;     // URL 模式下的图片地址前缀
+    
+    // 按保存位置读取告警图片或缩略图（由 service 设置为 AlertImageStore::load）
+    // 重试、积压或重启后图片数据已释放，投递前通过它重新加载；未设置时按文件路径读取告警图片
+    std::function<std::shared_ptr<const std::vector<unsigned char>>(const std::string&)> image_loader;
+};
+
+// MQTT 主题（ReportConfig::mqtt_topic）支持按报警替换的占位符：
+//   {channel_id} {channel_name} {rule_id} {rule_name} {alert_type}
+// 替换值中的 '/'、'+'、'#' 替换为 '_'，避免产生额外的主题层级或通配符。
+//
+// MQTT 二进制负载（ImageMode::RAW，多字节字段均为大端序）：
+//   magic "DSA1" | json_len u32 | 报警 JSON（不含图片）| image_len u32 | 告警图片 JPEG |
+//   thumbnail_len u32 | 整帧缩略图 JPEG（没有缩略图时长度为 0）
+
+// 上报统计
+struct ReportStats {
+    uint64_t delivered = 0;     // 上报成功数（MQTT 以收到 PUBACK 为准）
+    uint64_t failed = 0;        // 不再重试的失败数
+    uint64_t retried = 0;       // 失败后重新排队的次数
+    size_t pending = 0;         // 发件箱中尚未完成的上报数（含正在投递和等待确认的）
+    size_t mqtt_inflight = 0;   // 等待 PUBACK 的 MQTT 消息数
+};
+
+/**
+ * @brief 报警上报服务
+ * 待上报的报警先写入持久化的发件箱（report_outbox 表），由固定数量的上报线程按到期时间取出投递：
+ * 失败后按指数退避重试，超过最大次数标记为 failed；连续失败时整体暂停投递，恢复后先用单个请求探测，
+ * 上报端恢复时不会被积压的报警瞬间压垮。服务重启后继续投递发件箱中剩余的报警。
+ * MQTT 以 QoS 1 流水线发布：发布后不等待确认，PUBACK 在 mosquitto 网络线程中异步回调并更新上报状态，
+ * 同时在途的消息数不超过 mqtt_max_inflight。
+ */
 class ReportService {
 public:
     static ReportService& getInstance() {
@@ -21,14 +80,16 @@ public:
         return instance;
     }
     
-    // 上报报警信息（异步非阻塞，立即返回）
+    // 加载发件箱中未完成的上报并启动上报线程（数据库初始化之后调用）
+    void start(const ReportDeliveryOptions& options);
+    
+    // 上报报警信息（写入发件箱，立即返回）
     bool reportAlert(const AlertRecord& alert, const ReportConfig& config);
     
-    // HTTP 上报（内部使用，可能阻塞）
-    bool reportViaHttp(const AlertRecord& alert, const std::string& url);
+    // 重新上报（失败或待上报的报警）：上报状态改回 pending 并加入发件箱，返回加入的条数
+    size_t replayAlerts(const std::vector<AlertRecord>& alerts);
     
-    // MQTT 上报（内部使用，可能阻塞）
-    bool reportViaMqtt(const AlertRecord& alert, const ReportConfig& config);
+    ReportStats getStats();
     
     // 清理资源
     void cleanup();
@@ -42,36 +103,26 @@ private:
     ReportService(const ReportService&) = delete;
     ReportService& operator=(const ReportService&) = delete;
     
-    // 获取或创建 MQTT 客户端
-    struct mosquitto* getOrCreateMqttClient(const ReportConfig& config);
+    // 追加报警 JSON 到 out 末尾（图片按 image_mode 内嵌 base64、只带地址或不包含）
+    void appendAlertJson(const AlertRecord& alert, std::string& out) const;
     
-    // 释放 MQTT 客户端
-    void releaseMqttClient();
+    // 构建 MQTT 消息负载
+    std::string buildMqttPayload(const AlertRecord& alert) const;
     
-    // 统一的 MQTT 客户端创建和连接方法（内部使用，需要已持有 mqtt_mutex_ 锁）
-    // lock: 已持有的 mqtt_mutex_ 锁的引用
-    // 返回 true 表示成功，false 表示失败
-    bool createAndConnectMqttClient(const ReportConfig& config, std::unique_lock<std::mutex>& lock);
-    
-    // 构建报警 JSON 数据
-    std::string buildAlertJson(const AlertRecord& alert);
-    
-    // MQTT 连接回调函数（静态函数，用于传递给 mosquitto）
+    // MQTT 回调函数（静态函数，用于传递给 mosquitto，在 mosquitto 网络线程中调用）
     static void on_connect(struct mosquitto* mosq, void* obj, int rc);
     static void on_disconnect(struct mosquitto* mosq, void* obj, int rc);
+    static void on_publish(struct mosquitto* mosq, void* obj, int mid);
     
     // MQTT 客户端句柄
     struct mosquitto* mqtt_client_;
     std::mutex mqtt_mutex_;
-    std::condition_variable mqtt_connect_cv_;
     std::string current_broker_;
     int current_port_;
     bool mqtt_initialized_;
     bool mqtt_connected_;
-    bool mqtt_connect_failed_;
-    std::chrono::steady_clock::time_point last_reconnect_attempt_;  // 上次重连尝试时间
     
-    // 异步上报任务结构（使用可复制的配置，避免 atomic 复制问题）
+    // 投递时的上报配置快照（使用可复制的配置，避免 atomic 复制问题）
     struct ReportTaskConfig {
         ReportType type;
         std::string http_url;
@@ -90,24 +141,106 @@ private:
               enabled(false) {}
     };
     
-    struct ReportTask {
-        AlertRecord alert;
-        ReportTaskConfig config;
+    // 发件箱中的一条上报
+    struct OutboxItem {
+        ReportOutboxEntry entry;
+        AlertRecord alert;    // 报警记录，重启后从数据库加载
+        bool loaded = false;  // alert 是否已加载
+    };
+    
+    // 单次投递结果
+    enum class DeliveryResult {
+        DELIVERED,  // 上报成功
+        RETRY,      // 上报端不可达或暂时不可用，稍后重试
+        REJECTED,   // 上报端拒绝（4xx），不再重试
+        DISCARDED   // 上报已关闭或报警已删除，移出发件箱，不更新上报状态
+    };
+    
+    // HTTP 请求体：按顺序发送的若干片段，图片片段直接引用报警的 JPEG 缓冲区，不复制
+    struct HttpBody;
+    void buildHttpBody(const std::vector<OutboxItem*>& items, HttpBody& body) const;
+    
+    // 上报线程持有的 HTTP 长连接
+    struct HttpSession {
+        std::string base_url;  // scheme://host:port
+        std::unique_ptr<httplib::Client> client;
+        
+        HttpSession();
+        ~HttpSession();
     };
     
-    // 异步上报队列和工作线程
-    std::queue<ReportTask> report_queue_;
-    std::mutex report_queue_mutex_;
-    std::condition_variable report_queue_cv_;
-    std::thread report_worker_thread_;
-    std::atomic<bool> report_worker_running_;
+    // 上报线程函数
+    void deliveryWorker();
     
-    // 上报工作线程函数
-    void reportWorker();
+    // 投递一批上报（在上报线程中调用），返回后各条目的结果已处理
+    void deliver(std::vector<OutboxItem>& batch, HttpSession& session);
     
-    // 实际执行上报（在工作线程中调用）
-    void executeReport(const AlertRecord& alert, const ReportTaskConfig& task_config);
+    // 通过长连接 POST 到 HTTP 上报地址
+    DeliveryResult postHttp(HttpSession& session, const std::string& url, const HttpBody& body,
+                            std::string& error);
+    
+    // 加载报警记录和图片（重启后或重试时图片数据已释放）
+    bool loadItem(OutboxItem& item);
+    
+    // 记录投递结果：成功或不再重试时移出发件箱并更新上报状态，否则按退避时间重新排队
+    void finishItem(OutboxItem& item, DeliveryResult result, const std::string& report_url,
+                    const std::string& error);
+    
+    // 加入内存发件箱（需持有 outbox_mutex_）
+    void enqueueLocked(OutboxItem item);
+    
+    int64_t retryDelayMs(int attempts) const;
+    ReportTaskConfig snapshotConfig();
+    
+    // 获取已连接的 MQTT 客户端（需持有 mqtt_mutex_）：未创建或配置变化时发起异步连接，
+    // 不等待连接结果，尚未连接时返回 nullptr；被替换的旧客户端通过 stale 返回，由调用方在锁外销毁
+    struct mosquitto* connectedMqttClientLocked(const ReportTaskConfig& config, struct mosquitto*& stale);
+    
+    // 创建客户端并发起异步连接（需持有 mqtt_mutex_）
+    bool createAndConnectMqttClient(const ReportTaskConfig& config);
+    
+    // 取出 MQTT 客户端（需持有 mqtt_mutex_），由调用方在释放锁后销毁
+    struct mosquitto* detachMqttClientLocked();
+    static void destroyMqttClient(struct mosquitto* client);
+    
+    // 流水线发布一批报警（在上报线程中调用），已发布的条目转入等待确认
+    DeliveryResult publishMqtt(const std::vector<OutboxItem*>& items, const ReportTaskConfig& config);
+    
+    // 收到 PUBACK
+    void onMqttPublished(int mid);
+    
+    // 等待确认超时或客户端已销毁的消息重新排队
+    void expireMqttInflight();
+    void failMqttInflight(const std::string& error);
+    
+    // 发件箱（按下次尝试时间排序）和上报线程
+    std::multimap<int64_t, OutboxItem> outbox_;
+    std::unordered_set<int> outbox_ids_;  // 发件箱中和正在投递的报警ID
+    std::mutex outbox_mutex_;
+    std::condition_variable outbox_cv_;
+    std::vector<std::thread> workers_;
+    bool running_ = false;
+    bool stopping_ = false;
+    ReportDeliveryOptions options_;
+    
+    // 连续投递失败时整体暂停，暂停结束后只放行一个探测请求
+    int consecutive_failures_ = 0;
+    int64_t paused_until_ms_ = 0;
+    bool probing_ = false;
+    
+    // 已发布、等待 PUBACK 的 MQTT 消息（按 message id 索引）
+    struct InflightItem {
+        OutboxItem item;
+        std::string report_url;
+        int64_t deadline_ms = 0;
+    };
+    std::unordered_map<int, InflightItem> mqtt_inflight_;
+    std::unordered_set<int> mqtt_early_acks_;  // 登记前已收到确认的 message id
+    std::mutex mqtt_inflight_mutex_;
+    std::condition_variable mqtt_inflight_cv_;
+    std::atomic<size_t> mqtt_inflight_count_{0};
+    
+    ReportStats stats_;  // 由 outbox_mutex_ 保护
 };
 
 } // namespace detector_service
-
@@ -0,0 +1,284 @@
+#include "object_tracker.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace detector_service {
+
+namespace {
+
+// 过程噪声和观测噪声按目标尺寸缩放（与 SORT/ByteTrack 相同的经验值）
+constexpr float kStdWeightPosition = 1.0f / 20.0f;
+constexpr float kStdWeightVelocity = 1.0f / 160.0f;
+
+// 轨迹ID在进程内递增，跨通道和通道重启不重复，告警按轨迹去重时不会混淆
+std::atomic<int> g_next_track_id{1};
+
+using MeasureMat = cv::Matx<float, 4, 8>;
+
+// 匀速模型状态转移矩阵：位置 += 速度（单位为帧）
+const cv::Matx<float, 8, 8>& transitionMatrix() {
+    static const cv::Matx<float, 8, 8> transition = [] {
+        cv::Matx<float, 8, 8> m = cv::Matx<float, 8, 8>::eye();
+        for (int i = 0; i < 4; ++i) {
+            m(i, i + 4) = 1.0f;
+        }
+        return m;
+    }();
+    return transition;
+}
+
+// 观测矩阵：只观测 cx, cy, w, h
+const MeasureMat& measurementMatrix() {
+    static const MeasureMat measurement = [] {
+        MeasureMat m = MeasureMat::zeros();
+        for (int i = 0; i < 4; ++i) {
+            m(i, i) = 1.0f;
+        }
+        return m;
+    }();
+    return measurement;
+}
+
+float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    float inter = (a & b).area();
+    if (inter <= 0.0f) {
+        return 0.0f;
+    }
+    return inter / (a.area() + b.area() - inter);
+}
+
+} // namespace
+
+ObjectTracker::ObjectTracker(const ObjectTrackerOptions& options)
+    : options_(options),
+      capacity_(static_cast<size_t>(std::max(1, options.max_tracks))) {
+    tracks_.reserve(capacity_);
+    cost_.resize(capacity_ * capacity_);
+    assignment_.resize(capacity_);
+    matched_.resize(capacity_);
+    u_.resize(capacity_ + 1);
+    v_.resize(capacity_ + 1);
+    minv_.resize(capacity_ + 1);
+    p_.resize(capacity_ + 1);
+    way_.resize(capacity_ + 1);
+    used_.resize(capacity_ + 1);
+}
+
+void ObjectTracker::initiate(Track& track, const cv::Rect& bbox) {
+    float w = static_cast<float>(std::max(1, bbox.width));
+    float h = static_cast<float>(std::max(1, bbox.height));
+    track.mean = StateVec(bbox.x + w / 2.0f, bbox.y + h / 2.0f, w, h, 0.0f, 0.0f, 0.0f, 0.0f);
+
+    float pos_w = 2.0f * kStdWeightPosition * w;
+    float pos_h = 2.0f * kStdWeightPosition * h;
+    float vel_w = 10.0f * kStdWeightVelocity * w;
+    float vel_h = 10.0f * kStdWeightVelocity * h;
+    track.covariance = StateMat::diag(StateVec(
+        pos_w * pos_w, pos_h * pos_h, pos_w * pos_w, pos_h * pos_h,
+        vel_w * vel_w, vel_h * vel_h, vel_w * vel_w, vel_h * vel_h));
+    track.lost = 0;
+}
+
+void ObjectTracker::predictTrack(Track& track) {
+    float w = track.mean[2];
+    float h = track.mean[3];
+    float pos_w = kStdWeightPosition * w;
+    float pos_h = kStdWeightPosition * h;
+    float vel_w = kStdWeightVelocity * w;
+    float vel_h = kStdWeightVelocity * h;
+    StateMat noise = StateMat::diag(StateVec(
+        pos_w * pos_w, pos_h * pos_h, pos_w * pos_w, pos_h * pos_h,
+        vel_w * vel_w, vel_h * vel_h, vel_w * vel_w, vel_h * vel_h));
+
+    const StateMat& transition = transitionMatrix();
+    track.mean = transition * track.mean;
+    track.covariance = transition * track.covariance * transition.t() + noise;
+
+    // 宽高持续缩小时不允许变为非正数
+    track.mean[2] = std::max(track.mean[2], 1.0f);
+    track.mean[3] = std::max(track.mean[3], 1.0f);
+}
+
+void ObjectTracker::correct(Track& track, const cv::Rect& bbox) {
+    float w = static_cast<float>(std::max(1, bbox.width));
+    float h = static_cast<float>(std::max(1, bbox.height));
+    cv::Vec4f measurement(bbox.x + w / 2.0f, bbox.y + h / 2.0f, w, h);
+
+    float pos_w = kStdWeightPosition * track.mean[2];
+    float pos_h = kStdWeightPosition * track.mean[3];
+    cv::Matx44f measurement_noise = cv::Matx44f::diag(cv::Vec4f(
+        pos_w * pos_w, pos_h * pos_h, pos_w * pos_w, pos_h * pos_h));
+
+    const MeasureMat& measure = measurementMatrix();
+    cv::Matx<float, 8, 4> pht = track.covariance * measure.t();
+    cv::Matx44f innovation_cov = measure * pht + measurement_noise;
+    cv::Matx<float, 8, 4> gain = pht * innovation_cov.inv(cv::DECOMP_CHOLESKY);
+
+    cv::Vec4f innovation = measurement - measure * track.mean;
+    track.mean += gain * innovation;
+    track.covariance -= gain * (measure * track.covariance);
+    track.lost = 0;
+}
+
+cv::Rect2f ObjectTracker::stateRect(const StateVec& mean) {
+    return cv::Rect2f(mean[0] - mean[2] / 2.0f, mean[1] - mean[3] / 2.0f, mean[2], mean[3]);
+}
+
+void ObjectTracker::update(std::vector<Detection>& detections) {
+    for (auto& detection : detections) {
+        detection.track_id = -1;
+    }
+    if (!options_.enabled) {
+        return;
+    }
+
+    for (auto& track : tracks_) {
+        predictTrack(track);
+    }
+
+    const size_t track_count = tracks_.size();
+    const size_t detection_count = std::min(detections.size(), capacity_);
+    std::fill(matched_.begin(), matched_.end(), 0);
+
+    if (track_count > 0 && detection_count > 0) {
+        // 代价为 1-IoU，类别不同或补齐的位置代价为 1（不关联）
+        const int n = static_cast<int>(std::max(track_count, detection_count));
+        for (int i = 0; i < n; ++i) {
+            float* row = &cost_[static_cast<size_t>(i) * n];
+            if (i >= static_cast<int>(track_count)) {
+                std::fill(row, row + n, 1.0f);
+                continue;
+            }
+            const Track& track = tracks_[i];
+            cv::Rect2f predicted = stateRect(track.mean);
+            for (int j = 0; j < n; ++j) {
+                if (j >= static_cast<int>(detection_count) || detections[j].class_id != track.class_id) {
+                    row[j] = 1.0f;
+                } else {
+                    row[j] = 1.0f - iou(predicted, cv::Rect2f(detections[j].bbox));
+                }
+            }
+        }
+        solveAssignment(n);
+
+        for (size_t i = 0; i < track_count; ++i) {
+            int j = assignment_[i];
+            if (j < 0 || j >= static_cast<int>(detection_count) ||
+                1.0f - cost_[i * n + j] < options_.min_iou) {
+                continue;
+            }
+            correct(tracks_[i], detections[j].bbox);
+            detections[j].track_id = tracks_[i].id;
+            matched_[i] = 1;
+        }
+    }
+
+    // 未关联的轨迹累计丢失次数，超过上限后删除（与末尾交换，不移动其余轨迹）
+    for (size_t i = tracks_.size(); i-- > 0;) {
+        if (matched_[i]) {
+            continue;
+        }
+        if (++tracks_[i].lost > options_.max_lost_detections) {
+            tracks_[i] = tracks_.back();
+            tracks_.pop_back();
+        }
+    }
+
+    // 未关联的检测结果创建新轨迹
+    for (size_t j = 0; j < detection_count && tracks_.size() < capacity_; ++j) {
+        if (detections[j].track_id >= 0) {
+            continue;
+        }
+        tracks_.emplace_back();
+        Track& track = tracks_.back();
+        track.id = g_next_track_id.fetch_add(1, std::memory_order_relaxed);
+        track.class_id = detections[j].class_id;
+        initiate(track, detections[j].bbox);
+        detections[j].track_id = track.id;
+    }
+}
+
+void ObjectTracker::predict(std::vector<Detection>& detections) {
+    if (!options_.enabled) {
+        return;
+    }
+
+    for (auto& track : tracks_) {
+        predictTrack(track);
+    }
+
+    for (auto& detection : detections) {
+        if (detection.track_id < 0) {
+            continue;
+        }
+        auto it = std::find_if(tracks_.begin(), tracks_.end(),
+                               [&detection](const Track& track) { return track.id == detection.track_id; });
+        if (it == tracks_.end()) {
+            continue;
+        }
+        cv::Rect2f predicted = stateRect(it->mean);
+        detection.bbox = cv::Rect(cvRound(predicted.x), cvRound(predicted.y),
+                                  std::max(1, cvRound(predicted.width)), std::max(1, cvRound(predicted.height)));
+    }
+}
+
+void ObjectTracker::solveAssignment(int n) {
+    // 匈牙利算法（势函数 + 最短增广路），O(n^3)，缓冲区均已按容量分配
+    const float inf = std::numeric_limits<float>::infinity();
+    std::fill(u_.begin(), u_.begin() + n + 1, 0.0f);
+    std::fill(v_.begin(), v_.begin() + n + 1, 0.0f);
+    std::fill(p_.begin(), p_.begin() + n + 1, 0);
+    std::fill(way_.begin(), way_.begin() + n + 1, 0);
+
+    for (int i = 1; i <= n; ++i) {
+        p_[0] = i;
+        int j0 = 0;
+        std::fill(minv_.begin(), minv_.begin() + n + 1, inf);
+        std::fill(used_.begin(), used_.begin() + n + 1, 0);
+        do {
+            used_[j0] = 1;
+            int i0 = p_[j0];
+            float delta = inf;
+            int j1 = 0;
+            const float* row = &cost_[static_cast<size_t>(i0 - 1) * n];
+            for (int j = 1; j <= n; ++j) {
+                if (used_[j]) {
+                    continue;
+                }
+                float cur = row[j - 1] - u_[i0] - v_[j];
+                if (cur < minv_[j]) {
+                    minv_[j] = cur;
+                    way_[j] = j0;
+                }
+                if (minv_[j] < delta) {
+                    delta = minv_[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j) {
+                if (used_[j]) {
+                    u_[p_[j]] += delta;
+                    v_[j] -= delta;
+                } else {
+                    minv_[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p_[j0] != 0);
+        do {
+            int j1 = way_[j0];
+            p_[j0] = p_[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    std::fill(assignment_.begin(), assignment_.begin() + n, -1);
+    for (int j = 1; j <= n; ++j) {
+        if (p_[j] > 0) {
+            assignment_[p_[j] - 1] = j - 1;
+        }
+    }
+}
+
+} // namespace detector_service
@@ -0,0 +1,108 @@
+#include "overlay_renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <opencv2/imgproc.hpp>
+
+namespace detector_service {
+
+namespace {
+
+// 与原 drawDetections 保持一致的样式
+const cv::Scalar kBoxColor(0, 255, 0);
+const cv::Scalar kTextColor(0, 0, 0);
+constexpr int kBoxThickness = 2;
+constexpr int kFontFace = cv::FONT_HERSHEY_SIMPLEX;
+constexpr double kFontScale = 0.5;
+constexpr int kLabelPadding = 5;
+
+// 标签贴图缓存上限，超出后整体清空（类别数 × 101 个置信度档位）
+constexpr size_t kMaxLabelCacheSize = 4096;
+
+int confidenceBucket(float confidence) {
+    return std::clamp(static_cast<int>(std::lround(confidence * 100.0f)), 0, 100);
+}
+
+std::string formatLabel(const std::string& class_name, int bucket) {
+    char conf[8];
+    std::snprintf(conf, sizeof(conf), "%d.%02d", bucket / 100, bucket % 100);
+    return class_name + " " + conf;
+}
+
+} // namespace
+
+const cv::Mat& OverlayRenderer::getLabelSprite(const Detection& det) {
+    int bucket = confidenceBucket(det.confidence);
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(det.class_id)) << 8) |
+                   static_cast<uint64_t>(bucket);
+
+    auto it = label_cache_.find(key);
+    if (it != label_cache_.end() && it->second.class_name == det.class_name) {
+        return it->second.image;
+    }
+
+    if (label_cache_.size() >= kMaxLabelCacheSize) {
+        label_cache_.clear();
+    }
+
+    std::string label = formatLabel(det.class_name, bucket);
+    int baseline = 0;
+    cv::Size text_size = cv::getTextSize(label, kFontFace, kFontScale, 1, &baseline);
+
+    LabelSprite sprite;
+    sprite.class_name = det.class_name;
+    sprite.image = cv::Mat(text_size.height + 2 * kLabelPadding,
+                           text_size.width + 2 * kLabelPadding,
+                           CV_8UC3, kBoxColor);
+    cv::putText(sprite.image, label,
+                cv::Point(kLabelPadding, text_size.height + kLabelPadding),
+                kFontFace, kFontScale, kTextColor, 1);
+
+    auto& slot = label_cache_[key];
+    slot = std::move(sprite);
+    return slot.image;
+}
+
+void OverlayRenderer::blit(cv::Mat& frame, const cv::Mat& sprite, int x, int y) {
+    // 裁剪到帧范围内，标签超出画面的部分直接丢弃
+    cv::Rect dst(x, y, sprite.cols, sprite.rows);
+    cv::Rect clipped = dst & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (clipped.empty()) {
+        return;
+    }
+
+    cv::Rect src(clipped.x - x, clipped.y - y, clipped.width, clipped.height);
+    sprite(src).copyTo(frame(clipped));
+}
+
+void OverlayRenderer::drawInPlace(cv::Mat& frame, const std::vector<Detection>& detections) {
+    if (frame.empty() || detections.empty()) {
+        return;
+    }
+
+    const bool can_blit = (frame.type() == CV_8UC3);
+
+    for (const auto& det : detections) {
+        cv::rectangle(frame, det.bbox, kBoxColor, kBoxThickness);
+
+        if (can_blit) {
+            const cv::Mat& sprite = getLabelSprite(det);
+            blit(frame, sprite, det.bbox.x, det.bbox.y - sprite.rows);
+        } else {
+            // 非 BGR 帧无法直接拷贝贴图，退回逐帧绘制文字
+            std::string label = formatLabel(det.class_name, confidenceBucket(det.confidence));
+            cv::putText(frame, label,
+                        cv::Point(det.bbox.x + kLabelPadding, det.bbox.y - kLabelPadding),
+                        kFontFace, kFontScale, kTextColor, 1);
+        }
+    }
+}
+
+const cv::Mat& OverlayRenderer::render(const cv::Mat& frame, const std::vector<Detection>& detections) {
+    // copyTo 在尺寸和类型不变时复用 canvas_ 的内存
+    frame.copyTo(canvas_);
+    drawInPlace(canvas_, detections);
+    return canvas_;
+}
+
+} // namespace detector_service
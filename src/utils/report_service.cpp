@@ -1,7 +1,14 @@
 #include "report_service.h"
 #include "alert.h"
+#include "database.h"
+#include "image_utils.h"
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <iterator>
+#include <deque>
+#include <algorithm>
+#include <random>
 #include <httplib.h>
 #include <nlohmann/json.hpp>
 #include <mosquitto.h>
@@ -12,6 +19,104 @@
 
 namespace detector_service {
 
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 拆分 HTTP 上报地址为 scheme://host[:port] 和请求路径
+bool splitHttpUrl(const std::string& url, std::string& base_url, std::string& path) {
+    size_t protocol_end = url.find("://");
+    if (protocol_end == std::string::npos) {
+        return false;
+    }
+    std::string protocol = url.substr(0, protocol_end);
+    if (protocol != "http" && protocol != "https") {
+        return false;
+    }
+    
+    size_t host_start = protocol_end + 3;
+    size_t path_start = url.find('/', host_start);
+    if (path_start == std::string::npos) {
+        path_start = url.length();
+    }
+    if (path_start == host_start) {
+        return false;
+    }
+    
+    base_url = url.substr(0, path_start);
+    path = path_start < url.length() ? url.substr(path_start) : "/";
+    return true;
+}
+
+// 追加 JSON 字符串（含引号和转义）
+void appendJsonString(std::string& out, const std::string& value) {
+    out += nlohmann::json(value).dump();
+}
+
+void appendU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (24 - 8 * i)) & 0xFF));
+    }
+}
+
+std::string makeBoundary() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    std::ostringstream oss;
+    oss << "----DetectorServiceBoundary" << std::hex << rng();
+    return oss.str();
+}
+
+// 有等待确认的 MQTT 消息时，上报线程检查确认超时的间隔
+constexpr std::chrono::milliseconds kInflightCheckInterval(1000);
+
+// 替换 MQTT 主题模板中的占位符，见 report_service.h
+std::string renderMqttTopic(const std::string& topic, const AlertRecord& alert) {
+    if (topic.find('{') == std::string::npos) {
+        return topic;
+    }
+    
+    auto appendLevel = [](std::string& out, const std::string& value) {
+        for (char c : value) {
+            out.push_back(c == '/' || c == '+' || c == '#' ? '_' : c);
+        }
+    };
+    
+    std::string result;
+    result.reserve(topic.size() + 32);
+    size_t pos = 0;
+    while (pos < topic.size()) {
+        size_t open = topic.find('{', pos);
+        size_t close = open == std::string::npos ? std::string::npos : topic.find('}', open);
+        if (close == std::string::npos) {
+            result.append(topic, pos, std::string::npos);
+            break;
+        }
+        result.append(topic, pos, open - pos);
+        
+        std::string name = topic.substr(open + 1, close - open - 1);
+        if (name == "channel_id") {
+            result += std::to_string(alert.channel_id);
+        } else if (name == "channel_name") {
+            appendLevel(result, alert.channel_name);
+        } else if (name == "rule_id") {
+            result += std::to_string(alert.alert_rule_id);
+        } else if (name == "rule_name") {
+            appendLevel(result, alert.alert_rule_name);
+        } else if (name == "alert_type") {
+            appendLevel(result, alert.alert_type);
+        } else {
+            result.append(topic, open, close - open + 1);  // 未知占位符原样保留
+        }
+        pos = close + 1;
+    }
+    return result;
+}
+
+} // namespace
+
 // MQTT 连接回调函数
 void ReportService::on_connect(struct mosquitto* mosq, void* obj, int rc) {
     (void)mosq;  // 未使用参数
@@ -21,16 +126,12 @@ void ReportService::on_connect(struct mosquitto* mosq, void* obj, int rc) {
     if (rc == 0) {
         // 连接成功
         service->mqtt_connected_ = true;
-        service->mqtt_connect_failed_ = false;
     } else {
-        // 连接失败，销毁客户端
+        // 连接失败，mosquitto 按重连延迟自动重试
         service->mqtt_connected_ = false;
-        service->mqtt_connect_failed_ = true;
         std::cerr << "MQTT 连接失败: " << mosquitto_connack_string(rc) 
                   << " (错误代码: " << rc << ")" << std::endl;
     }
-    
-    service->mqtt_connect_cv_.notify_one();
 }
 
 // MQTT 断开连接回调函数
@@ -40,9 +141,15 @@ void ReportService::on_disconnect(struct mosquitto* mosq, void* obj, int rc) {
     ReportService* service = static_cast<ReportService*>(obj);
     std::unique_lock<std::mutex> lock(service->mqtt_mutex_);
     
+    // 未确认的 QoS 1 消息由 mosquitto 在重连后重发，超时仍未确认时重新排队
     service->mqtt_connected_ = false;
 }
 
+// MQTT 发布确认回调函数（QoS 1 收到 PUBACK）
+void ReportService::on_publish(struct mosquitto* mosq, void* obj, int mid) {
+    (void)mosq;  // 未使用参数
+    static_cast<ReportService*>(obj)->onMqttPublished(mid);
+}
 
 bool ReportService::reportAlert(const AlertRecord& alert, const ReportConfig& config) {
     // 检查配置是否启用
@@ -50,476 +157,872 @@ bool ReportService::reportAlert(const AlertRecord& alert, const ReportConfig& co
         return false;
     }
     
-    // 将上报任务加入队列，异步处理，立即返回，不阻塞
+    OutboxItem item;
+    item.entry.alert_id = alert.id;
+    item.entry.next_attempt_ms = nowMs();
+    item.alert = alert;
+    item.loaded = true;
+    
+    // 先写入持久化发件箱再排队，进程退出时未完成的上报在重启后继续
     {
-        std::lock_guard<std::mutex> lock(report_queue_mutex_);
-        if (!report_worker_running_.load()) {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (stopping_) {
             return false;
         }
-        
-        ReportTask task;
-        task.alert = alert;
-        // 将 ReportConfig 转换为可复制的 ReportTaskConfig
-        task.config.type = config.type;
-        task.config.http_url = config.http_url;
-        task.config.mqtt_broker = config.mqtt_broker;
-        task.config.mqtt_port = config.mqtt_port;
-        task.config.mqtt_topic = config.mqtt_topic;
-        task.config.mqtt_username = config.mqtt_username;
-        task.config.mqtt_password = config.mqtt_password;
-        task.config.mqtt_client_id = config.mqtt_client_id;
-        task.config.enabled = config.enabled.load();  // 读取 atomic 值
-        report_queue_.push(task);
-    }
-    
-    // 通知工作线程有新任务
-    report_queue_cv_.notify_one();
-    
-    // 立即返回 true，表示任务已加入队列
-    // 实际上报结果由后台线程处理
+        if (outbox_ids_.count(alert.id) > 0) {
+            return true;  // 已在发件箱中
+        }
+        Database::getInstance().putReportOutbox(item.entry);
+        enqueueLocked(std::move(item));
+    }
+    
+    // 通知上报线程有新任务
+    outbox_cv_.notify_one();
     return true;
 }
 
-std::string ReportService::buildAlertJson(const AlertRecord& alert) {
-    nlohmann::json alert_json;
-    alert_json["id"] = alert.id;
-    alert_json["channel_id"] = alert.channel_id;
-    alert_json["channel_name"] = alert.channel_name;
-    alert_json["alert_type"] = alert.alert_type;
-    alert_json["alert_rule_name"] = alert.alert_rule_name;
-    alert_json["image_data"] = alert.image_data;
-    alert_json["confidence"] = alert.confidence;
-    alert_json["detected_objects"] = nlohmann::json::parse(alert.detected_objects.empty() ? "[]" : alert.detected_objects);
-    alert_json["created_at"] = alert.created_at;
+// HTTP 请求体片段（文本片段由请求体持有，图片片段引用报警的 JPEG 缓冲区）
+struct ReportService::HttpBody {
+    std::string content_type;
+    size_t size = 0;
     
-    return alert_json.dump();
-}
-
-bool ReportService::reportViaHttp(const AlertRecord& alert, const std::string& url) {
-    if (url.empty()) {
-        std::cerr << "上报失败: HTTP URL 为空" << std::endl;
-        return false;
+    void appendText(std::string text) {
+        texts_.push_back(std::move(text));  // deque 追加元素不会使已有元素的地址失效
+        segments_.emplace_back(texts_.back().data(), texts_.back().size());
+        size += texts_.back().size();
     }
     
-    try {
-        // 解析 URL
-        std::string protocol, host, path;
-        int port = 80;
-        bool is_https = false;
-        
-        size_t protocol_end = url.find("://");
-        if (protocol_end != std::string::npos) {
-            protocol = url.substr(0, protocol_end);
-            is_https = (protocol == "https");
-            
-            size_t host_start = protocol_end + 3;
-            size_t path_start = url.find("/", host_start);
-            size_t port_start = url.find(":", host_start);
-            
-            if (path_start == std::string::npos) {
-                path_start = url.length();
-            }
-            
-            if (port_start != std::string::npos && port_start < path_start) {
-                host = url.substr(host_start, port_start - host_start);
-                size_t port_end = (path_start < url.length()) ? path_start : url.length();
-                port = std::stoi(url.substr(port_start + 1, port_end - port_start - 1));
-            } else {
-                host = url.substr(host_start, path_start - host_start);
-                if (is_https) {
-                    port = 443;
-                }
+    void appendBuffer(const std::shared_ptr<const std::vector<unsigned char>>& buffer) {
+        buffers_.push_back(buffer);
+        segments_.emplace_back(reinterpret_cast<const char*>(buffer->data()), buffer->size());
+        size += buffer->size();
+    }
+    
+    // 按 httplib content provider 的约定写出 [offset, offset + length) 区间
+    bool write(size_t offset, size_t length, httplib::DataSink& sink) const {
+        size_t position = 0;
+        for (const auto& segment : segments_) {
+            if (length == 0) {
+                break;
             }
-            
-            if (path_start < url.length()) {
-                path = url.substr(path_start);
-            } else {
-                path = "/";
+            size_t end = position + segment.second;
+            if (offset < end) {
+                size_t begin = offset - position;
+                size_t count = std::min(segment.second - begin, length);
+                sink.write(segment.first + begin, count);
+                offset += count;
+                length -= count;
             }
-        } else {
-            std::cerr << "上报失败: 无效的 URL 格式" << std::endl;
-            return false;
+            position = end;
         }
-        
-        // 构建 JSON 数据
-        std::string json_str = buildAlertJson(alert);
-        
-        // 创建 HTTP 客户端
-        httplib::Client client(host, port);
-        client.set_connection_timeout(5, 0);  // 5秒连接超时
-        client.set_read_timeout(5, 0);       // 5秒读取超时
-        
-        // 如果是 HTTPS，注意：cpp-httplib 需要编译时启用 SSL 支持
-        // 如果 httplib 编译时未启用 SSL，HTTPS 请求将失败
-        // 对于开发环境，如果需要禁用证书验证，可以在编译 httplib 时配置
-        // 这里不设置证书验证相关选项，使用默认行为
-        
-        // 发送 POST 请求
-        httplib::Headers headers = {
-            {"Content-Type", "application/json"}
-        };
-        
-        auto res = client.Post(path.c_str(), headers, json_str, "application/json");
-        
-        if (!res) {
-            std::cerr << "HTTP 上报失败: 无法连接到服务器" << std::endl;
-            return false;
+        return true;
+    }
+    
+private:
+    std::deque<std::string> texts_;
+    std::vector<std::shared_ptr<const std::vector<unsigned char>>> buffers_;
+    std::vector<std::pair<const char*, size_t>> segments_;
+};
+
+void ReportService::appendAlertJson(const AlertRecord& alert, std::string& out) const {
+    using ImageMode = ReportDeliveryOptions::ImageMode;
+    
+    // 先按图片大小预留空间，base64 直接编码到报文中，不产生中间字符串
+    size_t reserve = 512 + alert.detected_objects.size();
+    if (options_.image_mode == ImageMode::BASE64) {
+        reserve += alert.image_jpeg ? (alert.image_jpeg->size() + 2) / 3 * 4 : 0;
+        reserve += alert.thumbnail_jpeg ? (alert.thumbnail_jpeg->size() + 2) / 3 * 4 : 0;
+    }
+    out.reserve(out.size() + reserve);
+    
+    out += "{\"id\":" + std::to_string(alert.id);
+    out += ",\"channel_id\":" + std::to_string(alert.channel_id);
+    out += ",\"channel_name\":";
+    appendJsonString(out, alert.channel_name);
+    out += ",\"alert_type\":";
+    appendJsonString(out, alert.alert_type);
+    out += ",\"alert_rule_name\":";
+    appendJsonString(out, alert.alert_rule_name);
+    out += ",\"confidence\":" + nlohmann::json(alert.confidence).dump();
+    // detected_objects 入库前已序列化为 JSON，原样拼入，不再解析和重新序列化
+    out += ",\"detected_objects\":";
+    out += alert.detected_objects.empty() ? "[]" : alert.detected_objects;
+    out += ",\"created_at\":";
+    appendJsonString(out, alert.created_at);
+    
+    if (options_.image_mode == ImageMode::BASE64) {
+        out += ",\"image_data\":\"";
+        if (alert.image_jpeg) {
+            ImageUtils::appendBase64(*alert.image_jpeg, out);
         }
-        
-        if (res->status != 200 && res->status != 201) {
-            std::cerr << "HTTP 上报失败: 服务器返回状态码 " << res->status << std::endl;
-            return false;
+        out += "\"";
+        if (alert.thumbnail_jpeg) {
+            out += ",\"thumbnail_data\":\"";
+            ImageUtils::appendBase64(*alert.thumbnail_jpeg, out);
+            out += "\"";
         }
-        
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "HTTP 上报异常: " << e.what() << std::endl;
-        return false;
+    } else if (options_.image_mode == ImageMode::URL) {
+        std::string image_url = options_.image_base_url + "/api/alerts/" + std::to_string(alert.id);
+        out += ",\"image_url\":";
+        appendJsonString(out, image_url + "/image");
+        if (!alert.thumbnail_path.empty()) {
+            out += ",\"thumbnail_url\":";
+            appendJsonString(out, image_url + "/thumbnail");
+        }
+    }
+    out += "}";
+}
+
+std::string ReportService::buildMqttPayload(const AlertRecord& alert) const {
+    std::string payload;
+    if (options_.image_mode != ReportDeliveryOptions::ImageMode::RAW) {
+        appendAlertJson(alert, payload);
+        return payload;
+    }
+    
+    // 二进制负载：报警 JSON + 原始 JPEG，格式见 report_service.h
+    std::string json;
+    appendAlertJson(alert, json);
+    size_t image_size = alert.image_jpeg ? alert.image_jpeg->size() : 0;
+    size_t thumbnail_size = alert.thumbnail_jpeg ? alert.thumbnail_jpeg->size() : 0;
+    payload.reserve(16 + json.size() + image_size + thumbnail_size);
+    
+    payload += "DSA1";
+    appendU32(payload, static_cast<uint32_t>(json.size()));
+    payload += json;
+    appendU32(payload, static_cast<uint32_t>(image_size));
+    if (image_size > 0) {
+        payload.append(reinterpret_cast<const char*>(alert.image_jpeg->data()), image_size);
+    }
+    appendU32(payload, static_cast<uint32_t>(thumbnail_size));
+    if (thumbnail_size > 0) {
+        payload.append(reinterpret_cast<const char*>(alert.thumbnail_jpeg->data()), thumbnail_size);
+    }
+    return payload;
+}
+
+void ReportService::buildHttpBody(const std::vector<OutboxItem*>& items, HttpBody& body) const {
+    // batch_size 大于 1 时报警 JSON 始终为数组，便于接收端统一处理
+    bool as_array = options_.batch_size > 1;
+    std::string json;
+    if (as_array) {
+        json += "[";
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i > 0) {
+            json += ",";
+        }
+        appendAlertJson(items[i]->alert, json);
+    }
+    if (as_array) {
+        json += "]";
+    }
+    
+    if (options_.image_mode != ReportDeliveryOptions::ImageMode::RAW) {
+        body.content_type = "application/json";
+        body.appendText(std::move(json));
+        return;
+    }
+    
+    // multipart/form-data：alert 字段为报警 JSON，图片以原始 JPEG 作为 image / thumbnail 字段
+    // （批量上报时字段名带报警ID：image_<id> / thumbnail_<id>）
+    std::string boundary = makeBoundary();
+    body.content_type = "multipart/form-data; boundary=" + boundary;
+    body.appendText("--" + boundary + "\r\n"
+                    "Content-Disposition: form-data; name=\"alert\"\r\n"
+                    "Content-Type: application/json\r\n\r\n");
+    body.appendText(std::move(json));
+    
+    auto appendImage = [&body, &boundary, as_array](const char* field, int alert_id,
+                                                    const std::shared_ptr<const std::vector<unsigned char>>& jpeg) {
+        if (!jpeg || jpeg->empty()) {
+            return;
+        }
+        std::string name = as_array ? std::string(field) + "_" + std::to_string(alert_id) : field;
+        body.appendText("\r\n--" + boundary + "\r\n"
+                        "Content-Disposition: form-data; name=\"" + name + "\"; filename=\"" + name + ".jpg\"\r\n"
+                        "Content-Type: image/jpeg\r\n\r\n");
+        body.appendBuffer(jpeg);
+    };
+    for (const auto* item : items) {
+        appendImage("image", item->alert.id, item->alert.image_jpeg);
+        appendImage("thumbnail", item->alert.id, item->alert.thumbnail_jpeg);
+    }
+    body.appendText("\r\n--" + boundary + "--\r\n");
+}
+
+ReportService::HttpSession::HttpSession() = default;
+ReportService::HttpSession::~HttpSession() = default;
+
+ReportService::DeliveryResult ReportService::postHttp(HttpSession& session, const std::string& url,
+                                                      const HttpBody& body, std::string& error) {
+    std::string base_url;
+    std::string path;
+    if (!splitHttpUrl(url, base_url, path)) {
+        error = "无效的 HTTP 上报地址: " + url;
+        return DeliveryResult::REJECTED;
+    }
+    
+    // 上报地址不变时复用同一连接（keep-alive），不再为每条报警建立 TCP/TLS 连接
+    // 注意：https 需要 cpp-httplib 编译时启用 SSL 支持
+    if (!session.client || session.base_url != base_url) {
+        session.client = std::make_unique<httplib::Client>(base_url);
+        session.client->set_keep_alive(true);
+        session.client->set_connection_timeout(options_.http_timeout_seconds, 0);
+        session.client->set_read_timeout(options_.http_timeout_seconds, 0);
+        session.base_url = base_url;
+    }
+    
+    // 请求体按片段流式写出，图片不拼接成完整报文
+    auto res = session.client->Post(
+        path, body.size,
+        [&body](size_t offset, size_t length, httplib::DataSink& sink) {
+            return body.write(offset, length, sink);
+        },
+        body.content_type);
+    if (!res) {
+        error = "无法连接到服务器";
+        session.client.reset();  // 连接可能已失效，下次重新建立
+        return DeliveryResult::RETRY;
+    }
+    
+    if (res->status >= 200 && res->status < 300) {
+        return DeliveryResult::DELIVERED;
+    }
+    
+    error = "服务器返回状态码 " + std::to_string(res->status);
+    // 超时、限流和服务端错误稍后重试，其他 4xx 说明请求本身有问题，重试也不会成功
+    if (res->status == 408 || res->status == 429 || res->status >= 500) {
+        return DeliveryResult::RETRY;
     }
+    return DeliveryResult::REJECTED;
 }
 
 ReportService::ReportService() 
     : mqtt_client_(nullptr), current_port_(0), mqtt_initialized_(false),
-      mqtt_connected_(false), mqtt_connect_failed_(false),
-      last_reconnect_attempt_(std::chrono::steady_clock::now() - std::chrono::seconds(10)),
-      report_worker_running_(true) {
+      mqtt_connected_(false) {
+    // 先构造数据库单例，保证上报线程退出前数据库不会被析构
+    Database::getInstance();
+    
     // 初始化 mosquitto 库
     mosquitto_lib_init();
-    
-    // 启动上报工作线程
-    report_worker_thread_ = std::thread(&ReportService::reportWorker, this);
 }
 
 ReportService::~ReportService() {
-    // 停止上报工作线程
+    // 停止上报线程（正在进行的投递完成后退出，未投递的上报保留在发件箱中）
     {
-        std::lock_guard<std::mutex> lock(report_queue_mutex_);
-        report_worker_running_ = false;
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        stopping_ = true;
     }
-    report_queue_cv_.notify_all();
+    outbox_cv_.notify_all();
     
-    if (report_worker_thread_.joinable()) {
-        report_worker_thread_.join();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
     }
     
     cleanup();
     mosquitto_lib_cleanup();
 }
 
+void ReportService::start(const ReportDeliveryOptions& options) {
+    auto entries = Database::getInstance().loadReportOutbox();
+    size_t restored = 0;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (running_ || stopping_) {
+            return;
+        }
+        running_ = true;
+        options_ = options;
+        
+        for (auto& entry : entries) {
+            if (outbox_ids_.count(entry.alert_id) > 0) {
+                continue;
+            }
+            OutboxItem item;
+            item.entry = std::move(entry);
+            enqueueLocked(std::move(item));
+            restored++;
+        }
+        
+        int worker_count = std::max(1, options_.workers);
+        for (int i = 0; i < worker_count; ++i) {
+            workers_.emplace_back(&ReportService::deliveryWorker, this);
+        }
+    }
+    
+    if (restored > 0) {
+        std::cout << "发件箱中有 " << restored << " 条未完成的上报，继续投递" << std::endl;
+    }
+    
+    // 提前建立 MQTT 连接，第一条报警不必等待连接
+    ReportTaskConfig task_config = snapshotConfig();
+    if (task_config.enabled && task_config.type == ReportType::MQTT && !task_config.mqtt_broker.empty()) {
+        struct mosquitto* stale = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mqtt_mutex_);
+            connectedMqttClientLocked(task_config, stale);
+        }
+        destroyMqttClient(stale);
+    }
+}
+
+size_t ReportService::replayAlerts(const std::vector<AlertRecord>& alerts) {
+    if (!ReportConfigManager::getInstance().getReportConfig().enabled.load()) {
+        return 0;
+    }
+    
+    auto& db = Database::getInstance();
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (stopping_) {
+            return 0;
+        }
+        for (const auto& alert : alerts) {
+            if (alert.id == 0 || outbox_ids_.count(alert.id) > 0) {
+                continue;  // 已在发件箱中
+            }
+            OutboxItem item;
+            item.entry.alert_id = alert.id;
+            item.entry.next_attempt_ms = nowMs();
+            item.alert = alert;
+            item.alert.report_status = "pending";
+            item.loaded = true;
+            
+            // 状态更新与发件箱写入由写入线程合并提交
+            db.updateAlertReportStatus(alert.id, "pending", "");
+            db.putReportOutbox(item.entry);
+            enqueueLocked(std::move(item));
+            queued++;
+        }
+    }
+    
+    outbox_cv_.notify_all();
+    return queued;
+}
+
+ReportStats ReportService::getStats() {
+    ReportStats stats;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        stats = stats_;
+        stats.pending = outbox_ids_.size();
+    }
+    stats.mqtt_inflight = mqtt_inflight_count_.load();
+    return stats;
+}
+
 void ReportService::cleanup() {
-    std::lock_guard<std::mutex> lock(mqtt_mutex_);
-    if (mqtt_client_ != nullptr) {
-        // mosquitto_disconnect 可以安全地在未连接状态下调用
-        mosquitto_disconnect(mqtt_client_);
-        mosquitto_loop_stop(mqtt_client_, false);
-        mosquitto_destroy(mqtt_client_);
-        mqtt_client_ = nullptr;
+    struct mosquitto* client = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mqtt_mutex_);
+        client = detachMqttClientLocked();
     }
-    mqtt_initialized_ = false;
-    mqtt_connected_ = false;
-    mqtt_connect_failed_ = false;
-    current_broker_.clear();
-    current_port_ = 0;
+    // 在锁外停止网络线程，网络线程中的回调也需要获取 mqtt_mutex_
+    destroyMqttClient(client);
 }
 
 // 停止 MQTT 连接（当上报被禁用时调用）
 void ReportService::stopMqttConnection() {
-    // 清理 MQTT 客户端
+    // 清理 MQTT 客户端，未确认的消息随客户端丢弃，重新排队
     cleanup();
+    failMqttInflight("MQTT 连接已关闭");
+}
+
+struct mosquitto* ReportService::detachMqttClientLocked() {
+    struct mosquitto* client = mqtt_client_;
+    mqtt_client_ = nullptr;
+    mqtt_initialized_ = false;
+    mqtt_connected_ = false;
+    current_broker_.clear();
+    current_port_ = 0;
+    return client;
 }
 
-// 统一的 MQTT 客户端创建和连接方法
-// 注意：调用此方法前必须已持有 mqtt_mutex_ 锁，并通过 lock 参数传入
-// 注意：此方法会在调用 mosquitto_connect 前释放锁，避免阻塞
-bool ReportService::createAndConnectMqttClient(const ReportConfig& config, std::unique_lock<std::mutex>& lock) {
-    // 释放旧客户端
-    if (mqtt_client_ != nullptr) {
-        mosquitto_disconnect(mqtt_client_);
-        mosquitto_loop_stop(mqtt_client_, false);
-        mosquitto_destroy(mqtt_client_);
-        mqtt_client_ = nullptr;
+void ReportService::destroyMqttClient(struct mosquitto* client) {
+    if (client != nullptr) {
+        // mosquitto_disconnect 可以安全地在未连接状态下调用
+        mosquitto_disconnect(client);
+        mosquitto_loop_stop(client, false);
+        mosquitto_destroy(client);
     }
-    
+}
+
+// 创建 MQTT 客户端并发起异步连接
+// 注意：调用此方法前必须已持有 mqtt_mutex_ 锁
+bool ReportService::createAndConnectMqttClient(const ReportTaskConfig& config) {
     // 创建新客户端
     const char* client_id = config.mqtt_client_id.empty() ? 
         "detector_service" : config.mqtt_client_id.c_str();
     
-    mqtt_client_ = mosquitto_new(client_id, true, this);
-    if (mqtt_client_ == nullptr) {
+    struct mosquitto* client = mosquitto_new(client_id, true, this);
+    if (client == nullptr) {
         std::cerr << "MQTT 失败: 无法创建客户端" << std::endl;
         return false;
     }
     
     // 设置回调函数
-    mosquitto_connect_callback_set(mqtt_client_, on_connect);
-    mosquitto_disconnect_callback_set(mqtt_client_, on_disconnect);
+    mosquitto_connect_callback_set(client, on_connect);
+    mosquitto_disconnect_callback_set(client, on_disconnect);
+    mosquitto_publish_callback_set(client, on_publish);
+    
+    // 在途消息窗口与发件箱的流水线深度一致（mosquitto 默认只有 20）
+    mosquitto_max_inflight_messages_set(client, static_cast<unsigned int>(std::max(1, options_.mqtt_max_inflight)));
 
     // 设置自动重连
     int reconnect_delay_s = 5;          // 初始重连延迟（秒）
     int max_reconnect_delay_s = 60;     // 最大重连延迟（秒）
     bool exponential_backoff = true;    // 指数退避
 
-    mosquitto_reconnect_delay_set(mqtt_client_, reconnect_delay_s, max_reconnect_delay_s, exponential_backoff);
+    mosquitto_reconnect_delay_set(client, reconnect_delay_s, max_reconnect_delay_s, exponential_backoff);
     
     // 设置用户名和密码
     if (!config.mqtt_username.empty() && !config.mqtt_password.empty()) {
-        int rc = mosquitto_username_pw_set(mqtt_client_, 
+        int rc = mosquitto_username_pw_set(client, 
                                             config.mqtt_username.c_str(),
                                             config.mqtt_password.c_str());
         if (rc != MOSQ_ERR_SUCCESS) {
             std::cerr << "MQTT 失败: 设置用户名密码失败" << std::endl;
-            mosquitto_destroy(mqtt_client_);
-            mqtt_client_ = nullptr;
+            mosquitto_destroy(client);
             return false;
         }
     }
     
-    // 重置连接状态
-    mqtt_connected_ = false;
-    mqtt_connect_failed_ = false;
-    
     // 启动网络循环（必须在连接之前启动）
-    int rc = mosquitto_loop_start(mqtt_client_);
+    int rc = mosquitto_loop_start(client);
     if (rc != MOSQ_ERR_SUCCESS) {
         std::cerr << "MQTT 失败: 启动网络循环失败 - " << mosquitto_strerror(rc) << std::endl;
-        mosquitto_destroy(mqtt_client_);
-        mqtt_client_ = nullptr;
-        return false;
-    }
-    
-    // 保存配置信息（在释放锁之前）
-    current_broker_ = config.mqtt_broker;
-    current_port_ = config.mqtt_port;
-    mqtt_initialized_ = true;
-    
-    // 在调用 mosquitto_connect 之前释放锁，避免阻塞其他线程
-    // mosquitto_connect 可能会进行DNS解析，这可能会阻塞
-    lock.unlock();
-    
-    // 连接到 broker（异步连接，但可能进行DNS解析）
-    // 验证 broker 地址格式（基本检查）
-    if (config.mqtt_broker.empty()) {
-        std::cerr << "MQTT 连接失败: broker 地址为空" << std::endl;
-        lock.lock();
-        if (mqtt_client_ != nullptr) {
-            mosquitto_loop_stop(mqtt_client_, false);
-            mosquitto_destroy(mqtt_client_);
-            mqtt_client_ = nullptr;
-        }
-        lock.unlock();
+        mosquitto_destroy(client);
         return false;
     }
     
-    rc = mosquitto_connect(mqtt_client_, 
-                           config.mqtt_broker.c_str(), 
-                           config.mqtt_port, 
-                           60); // keepalive 60秒
-    
+    // 异步连接：连接结果通过 on_connect 回调处理，不阻塞上报线程
+    rc = mosquitto_connect_async(client, 
+                                 config.mqtt_broker.c_str(), 
+                                 config.mqtt_port, 
+                                 60); // keepalive 60秒
     if (rc != MOSQ_ERR_SUCCESS) {
         std::cerr << "MQTT 连接失败: " << mosquitto_strerror(rc) 
                   << " (错误代码: " << rc << ")" << std::endl;
         std::cerr << "  broker: " << config.mqtt_broker 
                   << ", port: " << config.mqtt_port << std::endl;
-        // 需要重新获取锁来清理资源
-        lock.lock();
-        if (mqtt_client_ != nullptr) {
-            mosquitto_loop_stop(mqtt_client_, false);
-            mosquitto_destroy(mqtt_client_);
-            mqtt_client_ = nullptr;
-        }
-        lock.unlock();
+        mosquitto_loop_stop(client, true);
+        mosquitto_destroy(client);
         return false;
     }
     
-    // 不等待连接结果，立即返回（连接结果通过回调处理）
-    // 这样可以避免阻塞调用线程
+    mqtt_client_ = client;
+    current_broker_ = config.mqtt_broker;
+    current_port_ = config.mqtt_port;
+    mqtt_initialized_ = true;
+    mqtt_connected_ = false;
     return true;
 }
 
-struct mosquitto* ReportService::getOrCreateMqttClient(const ReportConfig& config) {
-    // 检查配置是否有效
-    if (config.mqtt_broker.empty() || config.mqtt_topic.empty() || !config.enabled.load()) {
-        // 如果上报被禁用或配置无效，确保停止现有连接
-        if (mqtt_client_ != nullptr) {
-            stopMqttConnection();
-        }
-        return nullptr;
-    }
-    
-    std::unique_lock<std::mutex> lock(mqtt_mutex_);
-    
+struct mosquitto* ReportService::connectedMqttClientLocked(const ReportTaskConfig& config,
+                                                          struct mosquitto*& stale) {
     // 如果客户端未初始化，或者配置发生变化，则创建新客户端
     if (mqtt_client_ == nullptr || 
         !mqtt_initialized_ ||
         current_broker_ != config.mqtt_broker || 
         current_port_ != config.mqtt_port) {
+        // 旧客户端由调用方在释放锁后销毁
+        stale = detachMqttClientLocked();
+        createAndConnectMqttClient(config);
+        return nullptr;
+    }
+    
+    // mosquitto 库将在后台自动处理重连
+    return mqtt_connected_ ? mqtt_client_ : nullptr;
+}
+
+ReportService::DeliveryResult ReportService::publishMqtt(const std::vector<OutboxItem*>& items,
+                                                         const ReportTaskConfig& config) {
+    if (config.mqtt_broker.empty() || config.mqtt_topic.empty()) {
+        for (auto* item : items) {
+            finishItem(*item, DeliveryResult::RETRY, "", "MQTT broker 或 topic 为空");
+        }
+        return DeliveryResult::RETRY;
+    }
+    
+    DeliveryResult outcome = DeliveryResult::DELIVERED;
+    int64_t ack_timeout_ms = static_cast<int64_t>(std::max(1, options_.mqtt_ack_timeout_seconds)) * 1000;
+    size_t max_inflight = static_cast<size_t>(std::max(1, options_.mqtt_max_inflight));
+    std::string broker = config.mqtt_broker + ":" + std::to_string(config.mqtt_port) + "/";
+    
+    for (auto* item : items) {
+        std::string topic = renderMqttTopic(config.mqtt_topic, item->alert);
+        std::string report_url = broker + topic;
         
-        // 创建并连接客户端
-        if (!createAndConnectMqttClient(config, lock)) {
-            // 创建或连接请求失败，返回 nullptr
-            return nullptr;
+        // 在途消息达到上限时等待确认（背压），等待超时说明上报端已不再确认
+        {
+            std::unique_lock<std::mutex> lock(mqtt_inflight_mutex_);
+            if (!mqtt_inflight_cv_.wait_for(lock, std::chrono::milliseconds(ack_timeout_ms),
+                                            [&] { return mqtt_inflight_.size() < max_inflight; })) {
+                lock.unlock();
+                finishItem(*item, DeliveryResult::RETRY, report_url, "MQTT 在途消息已满");
+                outcome = DeliveryResult::RETRY;
+                continue;
+            }
         }
         
-        // createAndConnectMqttClient 内部会释放锁以进行非阻塞连接，
-        // 但我们需要等待初始连接的结果。使用条件变量等待。
-        // 在调用 wait_for 之前，锁必须被重新获取（如果之前被释放）。
-        // createAndConnectMqttClient 保证在返回前不会重新获取锁。
-        lock.lock();
-        if (mqtt_connect_cv_.wait_for(lock, std::chrono::seconds(5), [this]{ return mqtt_connected_ || mqtt_connect_failed_; })) {
-            if (mqtt_connected_) {
-                return mqtt_client_;
-            } else {
-                std::cerr << "MQTT 客户端连接失败" << std::endl;
-                return nullptr;
+        std::string payload;
+        try {
+            payload = buildMqttPayload(item->alert);
+        } catch (const std::exception& e) {
+            // 报警数据无法编码（如名称不是有效的 UTF-8），重试也不会成功
+            finishItem(*item, DeliveryResult::REJECTED, report_url, e.what());
+            continue;
+        }
+        
+        int mid = 0;
+        int rc = MOSQ_ERR_NO_CONN;
+        struct mosquitto* stale = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mqtt_mutex_);
+            struct mosquitto* client = connectedMqttClientLocked(config, stale);
+            if (client != nullptr) {
+                rc = mosquitto_publish(client, &mid, topic.c_str(),
+                                       static_cast<int>(payload.size()), payload.data(),
+                                       1,       // QoS 1
+                                       false);  // retain
+            }
+        }
+        if (stale != nullptr) {
+            // broker 已变更，旧连接上未确认的消息重新排队
+            destroyMqttClient(stale);
+            failMqttInflight("MQTT broker 已变更");
+        }
+        if (rc != MOSQ_ERR_SUCCESS) {
+            finishItem(*item, DeliveryResult::RETRY, report_url,
+                       std::string("MQTT 发布失败: ") + mosquitto_strerror(rc));
+            outcome = DeliveryResult::RETRY;
+            continue;
+        }
+        
+        // 负载已复制到 mosquitto 发送队列，等待确认期间不持有图片
+        item->alert.image_jpeg.reset();
+        item->alert.thumbnail_jpeg.reset();
+        
+        bool acked = false;
+        {
+            std::lock_guard<std::mutex> lock(mqtt_inflight_mutex_);
+            acked = mqtt_early_acks_.erase(mid) > 0;
+            if (!acked) {
+                InflightItem& inflight = mqtt_inflight_[mid];
+                inflight.item = std::move(*item);
+                inflight.report_url = std::move(report_url);
+                inflight.deadline_ms = nowMs() + ack_timeout_ms;
+                mqtt_inflight_count_ = mqtt_inflight_.size();
             }
-        } else {
-            std::cerr << "MQTT 连接超时" << std::endl;
-            return nullptr;
+        }
+        if (acked) {
+            finishItem(*item, DeliveryResult::DELIVERED, report_url, "");
         }
     }
-    
-    // 如果客户端已存在且配置未变，直接返回
-    // mosquitto 库将在后台自动处理重连
-    return mqtt_client_;
+    return outcome;
 }
 
-void ReportService::releaseMqttClient() {
-    // 注意：此方法应在已持有 mqtt_mutex_ 锁的情况下调用
-    if (mqtt_client_ != nullptr) {
-        // mosquitto_disconnect 可以安全地在未连接状态下调用
-        mosquitto_disconnect(mqtt_client_);
-        mosquitto_loop_stop(mqtt_client_, false);
-        mosquitto_destroy(mqtt_client_);
-        mqtt_client_ = nullptr;
+void ReportService::onMqttPublished(int mid) {
+    InflightItem inflight;
+    {
+        std::lock_guard<std::mutex> lock(mqtt_inflight_mutex_);
+        auto it = mqtt_inflight_.find(mid);
+        if (it == mqtt_inflight_.end()) {
+            // 发布线程尚未登记，由其登记时直接完成
+            mqtt_early_acks_.insert(mid);
+            return;
+        }
+        inflight = std::move(it->second);
+        mqtt_inflight_.erase(it);
+        mqtt_inflight_count_ = mqtt_inflight_.size();
     }
-    mqtt_initialized_ = false;
-    mqtt_connected_ = false;
-    mqtt_connect_failed_ = false;
-    current_broker_.clear();
-    current_port_ = 0;
+    mqtt_inflight_cv_.notify_one();
+    finishItem(inflight.item, DeliveryResult::DELIVERED, inflight.report_url, "");
 }
 
-bool ReportService::reportViaMqtt(const AlertRecord& alert, const ReportConfig& config) {
-    if (config.mqtt_broker.empty() || config.mqtt_topic.empty()) {
-        std::cerr << "MQTT 上报失败: broker 或 topic 为空" << std::endl;
-        return false;
+void ReportService::expireMqttInflight() {
+    if (mqtt_inflight_count_.load() == 0) {
+        return;
     }
     
-    // 构建 JSON 数据
-    std::string json_str = buildAlertJson(alert);
-    
-    // 获取或创建 MQTT 客户端
-    // getOrCreateMqttClient 内部已经会等待连接建立（最多3秒），所以这里直接使用结果
-    struct mosquitto* client = getOrCreateMqttClient(config);
-    
-    // 如果客户端仍然未连接，说明连接失败或超时
-    if (client == nullptr) {
-        std::cerr << "MQTT 客户端未连接，无法上报消息" << std::endl;
-        std::cerr << "  请检查:" << std::endl;
-        std::cerr << "  - MQTT broker 地址和端口是否正确: " << config.mqtt_broker << ":" << config.mqtt_port << std::endl;
-        std::cerr << "  - 网络是否能够访问 broker" << std::endl;
-        std::cerr << "  - broker 服务是否正在运行" << std::endl;
-        std::cerr << "  - 用户名和密码是否正确（如果配置了）" << std::endl;
-        std::cerr << "  下次上报时将自动尝试重新连接" << std::endl;
-        return false;
+    std::vector<InflightItem> expired;
+    {
+        std::lock_guard<std::mutex> lock(mqtt_inflight_mutex_);
+        int64_t now = nowMs();
+        for (auto it = mqtt_inflight_.begin(); it != mqtt_inflight_.end();) {
+            if (it->second.deadline_ms <= now) {
+                expired.push_back(std::move(it->second));
+                it = mqtt_inflight_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        mqtt_inflight_count_ = mqtt_inflight_.size();
+    }
+    if (expired.empty()) {
+        return;
     }
     
-    // 发布消息
-    int rc = mosquitto_publish(client, 
-                               nullptr,  // mid (message id)
-                               config.mqtt_topic.c_str(),
-                               json_str.length(),
-                               json_str.c_str(),
-                               1,  // QoS 1
-                               false);  // retain
-    
-    if (rc != MOSQ_ERR_SUCCESS) {
-        std::cerr << "MQTT 发布失败: " << mosquitto_strerror(rc) 
-                  << " (错误代码: " << rc << ")" << std::endl;
-        return false;
+    // QoS 1 至少一次：超时后重新发布，接收端可能收到重复报警，需按报警ID去重
+    mqtt_inflight_cv_.notify_all();
+    for (auto& inflight : expired) {
+        finishItem(inflight.item, DeliveryResult::RETRY, inflight.report_url, "MQTT 未收到发布确认");
     }
+}
+
+void ReportService::failMqttInflight(const std::string& error) {
+    std::unordered_map<int, InflightItem> inflight;
+    {
+        std::lock_guard<std::mutex> lock(mqtt_inflight_mutex_);
+        inflight.swap(mqtt_inflight_);
+        mqtt_early_acks_.clear();
+        mqtt_inflight_count_ = 0;
+    }
+    mqtt_inflight_cv_.notify_all();
+    for (auto& pair : inflight) {
+        finishItem(pair.second.item, DeliveryResult::RETRY, pair.second.report_url, error);
+    }
+}
+
+void ReportService::enqueueLocked(OutboxItem item) {
+    // 上报端不可用期间只保留报警记录，图片在投递时再从文件读取，积压期间内存不随报警数增长
+    if (consecutive_failures_ > 0) {
+        item.alert.image_jpeg.reset();
+        item.alert.thumbnail_jpeg.reset();
+    }
+    outbox_ids_.insert(item.entry.alert_id);
+    int64_t due = item.entry.next_attempt_ms;
+    outbox_.emplace(due, std::move(item));
+}
+
+int64_t ReportService::retryDelayMs(int attempts) const {
+    int64_t max_delay = std::max(1, std::max(options_.retry_base_ms, options_.retry_max_ms));
+    int64_t delay = std::max(1, options_.retry_base_ms);
+    for (int i = 1; i < attempts && delay < max_delay; ++i) {
+        delay *= 2;
+    }
+    delay = std::min(delay, max_delay);
     
-    return true;
+    // ±20% 随机抖动，避免积压的报警在同一时刻集中重试
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+    return static_cast<int64_t>(static_cast<double>(delay) * jitter(rng));
 }
 
+ReportService::ReportTaskConfig ReportService::snapshotConfig() {
+    const auto& config = ReportConfigManager::getInstance().getReportConfig();
+    ReportTaskConfig snapshot;
+    snapshot.type = config.type;
+    snapshot.http_url = config.http_url;
+    snapshot.mqtt_broker = config.mqtt_broker;
+    snapshot.mqtt_port = config.mqtt_port;
+    snapshot.mqtt_topic = config.mqtt_topic;
+    snapshot.mqtt_username = config.mqtt_username;
+    snapshot.mqtt_password = config.mqtt_password;
+    snapshot.mqtt_client_id = config.mqtt_client_id;
+    snapshot.enabled = config.enabled.load();  // 读取 atomic 值
+    return snapshot;
+}
 
-// 上报工作线程函数
-void ReportService::reportWorker() {
-    while (report_worker_running_.load()) {
-        std::unique_lock<std::mutex> lock(report_queue_mutex_);
-        
-        // 等待队列中有任务或线程停止信号
-        report_queue_cv_.wait(lock, [this] {
-            return !report_queue_.empty() || !report_worker_running_.load();
-        });
-        
-        if (!report_worker_running_.load()) {
-            break;
+bool ReportService::loadItem(OutboxItem& item) {
+    if (!item.loaded) {
+        item.alert = AlertManager::getInstance().getAlert(item.entry.alert_id);
+        if (item.alert.id == 0) {
+            return false;  // 报警已被删除
         }
+        item.loaded = true;
+    }
+    
+    // 重启后或重试时图片数据已释放，从图片文件重新读取（只上报图片地址时不需要）
+    if (options_.image_mode == ReportDeliveryOptions::ImageMode::URL) {
+        return true;
+    }
+    if (!item.alert.image_jpeg && !item.alert.image_path.empty()) {
+        if (options_.image_loader) {
+            item.alert.image_jpeg = options_.image_loader(item.alert.image_path);
+        } else {
+            std::ifstream file(item.alert.image_path, std::ios::binary);
+            if (file) {
+                item.alert.image_jpeg = std::make_shared<const std::vector<unsigned char>>(
+                    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+        }
+    }
+    // 告警图片为目标区域时，首次投递附带的整帧缩略图同样重新加载，重试的上报内容与首次一致
+    // （整帧告警的 thumbnail_path 只是列表缩略图，不随上报发送）
+    if (!item.alert.thumbnail_jpeg && item.alert.image_cropped && !item.alert.thumbnail_path.empty() &&
+        options_.image_loader) {
+        item.alert.thumbnail_jpeg = options_.image_loader(item.alert.thumbnail_path);
+    }
+    return true;
+}
+
+// 上报线程函数
+void ReportService::deliveryWorker() {
+    // 每个上报线程持有自己的 HTTP 长连接（httplib::Client 不支持多线程并发请求）
+    HttpSession session;
+    
+    while (true) {
+        expireMqttInflight();
         
-        // 处理队列中的所有任务
-        while (!report_queue_.empty() && report_worker_running_.load()) {
-            ReportTask task = report_queue_.front();
-            report_queue_.pop();
-            lock.unlock();
+        std::vector<OutboxItem> batch;
+        {
+            std::unique_lock<std::mutex> lock(outbox_mutex_);
+            
+            // 等待最早的上报到期；暂停期间等到暂停结束，探测请求进行中时等待其结果
+            bool check_inflight = false;
+            while (true) {
+                if (stopping_) {
+                    return;
+                }
+                if (outbox_.empty() || probing_) {
+                    if (mqtt_inflight_count_.load() == 0) {
+                        outbox_cv_.wait(lock);
+                    } else if (outbox_cv_.wait_for(lock, kInflightCheckInterval) == std::cv_status::timeout) {
+                        check_inflight = true;  // 有等待确认的 MQTT 消息时定期检查确认超时
+                        break;
+                    }
+                    continue;
+                }
+                int64_t due = std::max(outbox_.begin()->first, paused_until_ms_);
+                int64_t now = nowMs();
+                if (due <= now) {
+                    break;
+                }
+                outbox_cv_.wait_for(lock, std::chrono::milliseconds(due - now));
+            }
             
-            // 执行实际上报（可能阻塞，但在后台线程中执行，不影响主线程）
-            executeReport(task.alert, task.config);
+            if (check_inflight) {
+                continue;
+            }
             
-            lock.lock();
+            // 连续失败后恢复投递时先只发一条探测，成功后再恢复批量和并发
+            size_t limit = static_cast<size_t>(std::max(1, options_.batch_size));
+            if (consecutive_failures_ > 0) {
+                probing_ = true;
+                limit = 1;
+            }
+            int64_t now = nowMs();
+            while (!outbox_.empty() && batch.size() < limit && outbox_.begin()->first <= now) {
+                batch.push_back(std::move(outbox_.begin()->second));
+                outbox_.erase(outbox_.begin());
+            }
         }
+        
+        deliver(batch, session);
     }
 }
 
-// 实际执行上报（在工作线程中调用）
-void ReportService::executeReport(const AlertRecord& alert, const ReportTaskConfig& task_config) {
-    bool report_success = false;
+// 投递一批上报（在上报线程中调用）
+void ReportService::deliver(std::vector<OutboxItem>& batch, HttpSession& session) {
+    ReportTaskConfig task_config = snapshotConfig();
     std::string report_url;
+    if (task_config.type == ReportType::HTTP) {
+        report_url = task_config.http_url;
+    } else {
+        report_url = task_config.mqtt_broker + ":" + std::to_string(task_config.mqtt_port) + "/" + task_config.mqtt_topic;
+    }
     
-    try {
-        // 检查配置是否仍然启用
-        if (!task_config.enabled) {
-            return;
+    // 上报已关闭或报警已删除：移出发件箱，上报状态保持不变
+    std::vector<OutboxItem*> pending;
+    for (auto& item : batch) {
+        if (!task_config.enabled || !loadItem(item)) {
+            finishItem(item, DeliveryResult::DISCARDED, report_url, "");
+        } else {
+            pending.push_back(&item);
         }
-        
-        // 将 ReportTaskConfig 转换为 ReportConfig 用于上报
-        ReportConfig config;
-        config.type = task_config.type;
-        config.http_url = task_config.http_url;
-        config.mqtt_broker = task_config.mqtt_broker;
-        config.mqtt_port = task_config.mqtt_port;
-        config.mqtt_topic = task_config.mqtt_topic;
-        config.mqtt_username = task_config.mqtt_username;
-        config.mqtt_password = task_config.mqtt_password;
-        config.mqtt_client_id = task_config.mqtt_client_id;
-        config.enabled.store(task_config.enabled);
-        
-        // 构建上报地址
-        if (config.type == ReportType::HTTP) {
-            report_url = config.http_url;
-            report_success = reportViaHttp(alert, config.http_url);
-        } else if (config.type == ReportType::MQTT) {
-            report_url = config.mqtt_broker + ":" + std::to_string(config.mqtt_port) + "/" + config.mqtt_topic;
-            report_success = reportViaMqtt(alert, config);
+    }
+    
+    DeliveryResult outcome = DeliveryResult::DISCARDED;
+    try {
+        if (!pending.empty() && task_config.type == ReportType::HTTP) {
+            HttpBody body;
+            buildHttpBody(pending, body);
+            
+            std::string error;
+            outcome = postHttp(session, task_config.http_url, body, error);
+            for (auto* item : pending) {
+                finishItem(*item, outcome, report_url, error);
+            }
+        } else if (!pending.empty() && task_config.type == ReportType::MQTT) {
+            // 逐条发布后不等待确认，各条目的结果在 publishMqtt 或 PUBACK 回调中处理
+            std::vector<OutboxItem*> items;
+            items.swap(pending);
+            outcome = publishMqtt(items, task_config);
         }
-        
-        // 更新上报状态到数据库
-        auto& alert_manager = AlertManager::getInstance();
-        std::string report_status = report_success ? "success" : "failed";
-        alert_manager.updateAlertReportStatus(alert.id, report_status, report_url);
-        
     } catch (const std::exception& e) {
+        // 报警数据无法编码（如名称不是有效的 UTF-8），重试也不会成功
         std::cerr << "上报异常: " << e.what() << std::endl;
-        // 更新为失败状态
-        auto& alert_manager = AlertManager::getInstance();
-        alert_manager.updateAlertReportStatus(alert.id, "failed", report_url);
-    } catch (...) {
-        std::cerr << "上报未知异常" << std::endl;
-        // 更新为失败状态
-        auto& alert_manager = AlertManager::getInstance();
-        alert_manager.updateAlertReportStatus(alert.id, "failed", report_url);
+        outcome = DeliveryResult::REJECTED;
+        for (auto* item : pending) {
+            finishItem(*item, outcome, report_url, e.what());
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    if (outcome == DeliveryResult::RETRY) {
+        consecutive_failures_++;
+        paused_until_ms_ = nowMs() + retryDelayMs(consecutive_failures_);
+        if (consecutive_failures_ == 1) {
+            std::cerr << "上报端不可用，暂停投递，发件箱积压 " << outbox_ids_.size() << " 条" << std::endl;
+        }
+    } else if (outcome != DeliveryResult::DISCARDED) {
+        if (consecutive_failures_ > 0) {
+            std::cout << "上报端已恢复，继续投递" << std::endl;
+        }
+        consecutive_failures_ = 0;
+        paused_until_ms_ = 0;
     }
+    probing_ = false;
+    outbox_cv_.notify_all();
 }
 
-} // namespace detector_service
+// 记录单条上报的投递结果
+void ReportService::finishItem(OutboxItem& item, DeliveryResult result, const std::string& report_url,
+                               const std::string& error) {
+    int alert_id = item.entry.alert_id;
+    bool done = result != DeliveryResult::RETRY;
+    if (result == DeliveryResult::RETRY) {
+        item.entry.attempts++;
+        item.entry.last_error = error;
+        done = item.entry.attempts >= std::max(1, options_.max_attempts);
+    }
+    
+    // 更新上报状态到数据库
+    if (done && result != DeliveryResult::DISCARDED) {
+        bool success = result == DeliveryResult::DELIVERED;
+        if (!success) {
+            std::cerr << "上报失败 (报警 " << alert_id << "，已尝试 " << std::max(1, item.entry.attempts)
+                      << " 次): " << error << std::endl;
+        }
+        AlertManager::getInstance().updateAlertReportStatus(alert_id, success ? "success" : "failed", report_url);
+    }
+    
+    auto& db = Database::getInstance();
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    if (done) {
+        if (result == DeliveryResult::DELIVERED) {
+            stats_.delivered++;
+        } else if (result != DeliveryResult::DISCARDED) {
+            stats_.failed++;
+        }
+        db.removeReportOutbox(alert_id);
+        outbox_ids_.erase(alert_id);
+        return;
+    }
+    
+    stats_.retried++;
+    
+    item.entry.next_attempt_ms = nowMs() + retryDelayMs(item.entry.attempts);
+    db.putReportOutbox(item.entry);
+    // 等待重试期间不持有图片数据
+    item.alert.image_jpeg.reset();
+    item.alert.thumbnail_jpeg.reset();
+    enqueueLocked(std::move(item));
+}
 
+} // namespace detector_service
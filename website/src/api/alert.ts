@@ -8,6 +8,7 @@ export interface Alert {
   alert_rule_id?: number;
   alert_rule_name?: string;
   image_path: string;
+  thumbnail_path?: string;
   confidence: number;
   detected_objects: string;
   bbox_x: number;
@@ -17,17 +18,21 @@ export interface Alert {
   report_status: string;
   report_url: string;
   created_at: string;
+  created_ts?: number;
 }
 
 export interface GetAlertsParams {
   limit?: number;
   offset?: number;
+  // 游标翻页：传上一页返回的 next_cursor，传空字符串表示第一页；设置后忽略 offset
+  cursor?: string;
 }
 
 export interface GetAlertsResponse {
   success: boolean;
   alerts: Alert[];
   total: number;
+  next_cursor?: string | null;
   error?: string;
 }
 
@@ -37,12 +42,47 @@ export interface GetAlertResponse {
   error?: string;
 }
 
+export interface GetReportAlertsParams {
+  status?: "failed" | "pending";
+  limit?: number;
+  // 上一页返回的 next_cursor
+  before_id?: number;
+}
+
+export interface GetReportAlertsResponse {
+  success: boolean;
+  alerts: Alert[];
+  total: number;
+  next_cursor?: number | null;
+  error?: string;
+}
+
+export interface ReplayReportsParams {
+  alert_ids?: number[];
+  status?: "failed" | "pending";
+  limit?: number;
+}
+
+export interface ReplayReportsResponse {
+  success: boolean;
+  matched?: number;
+  queued?: number;
+  error?: string;
+}
+
 export interface ApiResponse<T = any> {
   success: boolean;
   data?: T;
   error?: string;
 }
 
+/**
+ * 报警图片地址（thumbnail 为 true 时返回缩略图，未保存缩略图时服务端返回报警图片）
+ */
+export function getAlertImageUrl(id: number, thumbnail = false) {
+  return `${window.location.origin}/api/alerts/${id}/${thumbnail ? "thumbnail" : "image"}`;
+}
+
 /**
  * 获取所有报警记录
  */
@@ -85,7 +125,24 @@ export function deleteAlert(alertId: number) {
   });
 }
 
+/**
+ * 按上报状态获取报警记录（上报失败或待上报）
+ */
+export function getReportAlerts(params?: GetReportAlertsParams) {
+  return request<GetReportAlertsResponse>({
+    url: "/alerts/reports",
+    method: "GET",
+    params,
+  });
+}
 
-
-
-
+/**
+ * 重新上报报警（指定 alert_ids，或按状态批量重新上报）
+ */
+export function replayReports(params: ReplayReportsParams) {
+  return request<ReplayReportsResponse>({
+    url: "/alerts/reports/replay",
+    method: "POST",
+    data: params,
+  });
+}
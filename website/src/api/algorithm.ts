@@ -6,6 +6,8 @@ export interface ROI {
   name: string;
   enabled: boolean;
   points: Array<{ x: number; y: number }>;
+  match_mode?: "CENTER" | "OVERLAP"; // 命中判定方式：中心点 / 重叠比例
+  min_overlap_ratio?: number; // OVERLAP 模式下的最小重叠比例（0-1）
 }
 
 export interface AlertRule {
@@ -18,6 +20,10 @@ export interface AlertRule {
   max_count: number;
   suppression_window_seconds: number;
   roi_ids: number[];
+  window_size: number; // 滑动窗口长度：最近 M 次检测
+  min_hits: number; // 窗口内至少 N 次满足条件
+  min_duration_seconds: number; // 持续满足至少 T 秒，0 表示不要求
+  count_delta: number; // 大于 0 时判定数量变化（与 M 次检测前相比）
 }
 
 export interface AlgorithmConfig {
@@ -0,0 +1,68 @@
+import request from "@/utils/http";
+
+// 区域的实时统计
+export interface ZoneAnalytics {
+  roi_id: number;
+  roi_name: string;
+  occupancy: number; // 当前区域内的目标数
+  entries: number; // 统计开始（服务启动或修改配置）以来的进入数
+  exits: number;
+  minute_ts: number; // 当前分钟（Unix 秒）
+  minute_entries: number;
+  minute_exits: number;
+  minute_max_occupancy: number;
+}
+
+export interface AnalyticsBucket {
+  roi_id: number;
+  minute_ts: number; // 时间段起始时间（Unix 秒）
+  entries: number;
+  exits: number;
+  max_occupancy: number;
+  avg_occupancy: number;
+}
+
+export interface GetLiveAnalyticsResponse {
+  success: boolean;
+  channel_id: number;
+  zones: ZoneAnalytics[];
+  error?: string;
+}
+
+export interface GetAnalyticsBucketsParams {
+  from?: number; // Unix 秒，默认一小时前
+  to?: number; // Unix 秒（不包含）
+  roi_id?: number; // 不指定时返回所有区域
+  interval?: number; // 汇总粒度（分钟），默认 1
+}
+
+export interface GetAnalyticsBucketsResponse {
+  success: boolean;
+  channel_id: number;
+  from: number;
+  to: number;
+  interval: number;
+  buckets: AnalyticsBucket[];
+  error?: string;
+}
+
+/**
+ * 获取通道各区域的实时统计
+ */
+export function getLiveAnalytics(channelId: number) {
+  return request<GetLiveAnalyticsResponse>({
+    url: `/analytics/${channelId}`,
+    method: "GET",
+  });
+}
+
+/**
+ * 获取通道按时间段汇总的区域统计
+ */
+export function getAnalyticsBuckets(channelId: number, params?: GetAnalyticsBucketsParams) {
+  return request<GetAnalyticsBucketsResponse>({
+    url: `/analytics/${channelId}/minutes`,
+    method: "GET",
+    params,
+  });
+}
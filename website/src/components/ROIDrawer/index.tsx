@@ -1,7 +1,11 @@
 import { useState, useRef, useEffect } from "react";
 import { Modal, Button, Space, Radio, message, Spin } from "antd";
 import type { ROI } from "@/api/algorithm";
-import channelWsManager, { type WebSocketMessage } from "@/utils/websocket";
+import channelWsManager, {
+  type WebSocketMessage,
+  type BinaryFrame,
+  BINARY_TYPE_JPEG,
+} from "@/utils/websocket";
 
 interface ROIDrawerProps {
   visible: boolean;
@@ -66,8 +70,8 @@ function ROIDrawer({
     setStreamLoading(true);
     setHasStreamImage(false);
 
-    // 连接WebSocket并订阅通道
-    channelWsManager.connect(channelId);
+    // 连接WebSocket并订阅通道（绘制ROI需要静态画面，始终订阅 JPEG）
+    channelWsManager.connect(channelId, "jpeg");
 
     // 消息处理函数
     function handleMessage(message: WebSocketMessage) {
@@ -76,33 +80,41 @@ function ROIDrawer({
         console.log(`已成功订阅通道 ${message.channel_id}`);
         return;
       }
+    }
 
-      // 处理帧数据
-      if (message.type === "frame" && message.channel_id === channelId) {
-        if (message.image_base64) {
-          const img = new Image();
-          img.onload = () => {
-            backgroundImageRef.current = img;
-            setHasStreamImage(true);
-            setStreamLoading(false);
-            drawCanvas();
-          };
-          img.onerror = () => {
-            setStreamLoading(false);
-            console.error("加载视频流图片失败");
-          };
-          img.src = `data:image/jpeg;base64,${message.image_base64}`;
-        }
+    // 处理帧数据（二进制 JPEG 帧）
+    function handleBinary(frame: BinaryFrame) {
+      if (frame.type !== BINARY_TYPE_JPEG || frame.channel_id !== channelId) {
+        return;
       }
+      if (frame.payload.length === 0) {
+        return;
+      }
+      const url = URL.createObjectURL(new Blob([frame.payload], { type: "image/jpeg" }));
+      const img = new Image();
+      img.onload = () => {
+        URL.revokeObjectURL(url);
+        backgroundImageRef.current = img;
+        setHasStreamImage(true);
+        setStreamLoading(false);
+        drawCanvas();
+      };
+      img.onerror = () => {
+        URL.revokeObjectURL(url);
+        setStreamLoading(false);
+        console.error("加载视频流图片失败");
+      };
+      img.src = url;
     }
 
     // 添加消息处理器
     channelWsManager.addMessageHandler(handleMessage);
+    channelWsManager.addBinaryHandler(handleBinary);
 
     // 如果连接已建立但还未订阅，则订阅通道
     const onOpenCallback = () => {
       if (channelWsManager.getSubscribedChannelId() !== channelId) {
-        channelWsManager.subscribeChannel(channelId);
+        channelWsManager.subscribeChannel(channelId, "jpeg");
       }
     };
 
@@ -111,6 +123,7 @@ function ROIDrawer({
     // 清理函数
     return () => {
       channelWsManager.removeMessageHandler(handleMessage);
+      channelWsManager.removeBinaryHandler(handleBinary);
       channelWsManager.removeOnOpenCallback(onOpenCallback);
       // 注意：不在这里断开连接，因为可能其他地方也在使用
     };
@@ -26,6 +26,7 @@ import {
   getAlerts,
   getAlertsByChannel,
   deleteAlert,
+  getAlertImageUrl,
   type Alert,
   type GetAlertsParams,
 } from "@/api/alert";
@@ -200,8 +201,8 @@ function AlertList() {
   // 获取图片 URL
   function getImageUrl(alert: Alert) {
     if (alert.image_path) {
-      // 如果后端提供了图片路径，可以拼接完整 URL
-      return alert.image_path;
+      // 图片通过报警图片接口读取，支持缓存校验
+      return getAlertImageUrl(alert.id);
     }
     return "";
   }
@@ -212,10 +213,22 @@ function AlertList() {
       pending: "default",
       success: "success",
       failed: "error",
+      skipped: "default",
     };
     return colorMap[status.toLowerCase()] || "default";
   }
 
+  // 获取上报状态文字
+  function getReportStatusText(status: string) {
+    const textMap: Record<string, string> = {
+      pending: "待上报",
+      success: "已上报",
+      failed: "上报失败",
+      skipped: "未上报",
+    };
+    return textMap[status.toLowerCase()] || status;
+  }
+
   const columns: ColumnsType<Alert> = [
     {
       title: "ID",
@@ -284,7 +297,7 @@ function AlertList() {
       width: 100,
       render: (status: string) => (
         <Tag color={getReportStatusColor(status)}>
-          {status === "pending" ? "待上报" : status === "success" ? "已上报" : "上报失败"}
+          {getReportStatusText(status)}
         </Tag>
       ),
     },
@@ -502,7 +515,7 @@ function AlertList() {
                 <div style={{ marginBottom: 16 }}>
                   <strong>上报状态：</strong>
                   <Tag color={getReportStatusColor(viewingAlert.report_status)}>
-                    {viewingAlert.report_status === "pending" ? "待上报" : viewingAlert.report_status === "success" ? "已上报" : "上报失败"}
+                    {getReportStatusText(viewingAlert.report_status)}
                   </Tag>
                 </div>
                 <div style={{ marginBottom: 16 }}>
@@ -507,6 +507,38 @@ function AlgorithmConfigPage() {
                             {roi.enabled ? "已启用" : "已禁用"}
                           </Tag>
                         </div>
+                        <Space wrap>
+                          <span>命中判定:</span>
+                          <Select
+                            value={roi.match_mode || "CENTER"}
+                            onChange={(value) => {
+                              const newRois = [...rois];
+                              newRois[index].match_mode = value;
+                              setRois(newRois);
+                            }}
+                            options={[
+                              { label: "中心点在区域内", value: "CENTER" },
+                              { label: "重叠比例达到阈值", value: "OVERLAP" },
+                            ]}
+                            style={{ width: 160 }}
+                          />
+                          {roi.match_mode === "OVERLAP" && (
+                            <>
+                              <span>最小重叠比例:</span>
+                              <InputNumber
+                                min={0}
+                                max={1}
+                                step={0.05}
+                                value={roi.min_overlap_ratio ?? 0.5}
+                                onChange={(value) => {
+                                  const newRois = [...rois];
+                                  newRois[index].min_overlap_ratio = value ?? 0.5;
+                                  setRois(newRois);
+                                }}
+                              />
+                            </>
+                          )}
+                        </Space>
                         <div style={{ fontSize: 12, color: "#666" }}>
                           提示: 点击"重新绘制"按钮可以在画布上绘制区域。
                         </div>
@@ -563,6 +595,10 @@ function AlgorithmConfigPage() {
                       max_count: 0,
                       suppression_window_seconds: 60,
                       roi_ids: [],
+                      window_size: 1,
+                      min_hits: 1,
+                      min_duration_seconds: 0,
+                      count_delta: 0,
                     };
                     setAlertRules([...alertRules, newRule]);
                   }}
@@ -762,6 +798,95 @@ function AlgorithmConfigPage() {
                     </Col>
                   </Row>
                   
+                  <Row gutter={16}>
+                    <Col span={6}>
+                      <div style={{ marginBottom: 12 }}>
+                        <label style={{ display: "block", marginBottom: 4 }}>
+                          窗口长度(次)
+                        </label>
+                        <InputNumber
+                          value={rule.window_size}
+                          onChange={(value) => {
+                            const newRules = [...alertRules];
+                            newRules[index].window_size = value || 1;
+                            setAlertRules(newRules);
+                          }}
+                          min={1}
+                          max={1000}
+                          style={{ width: "100%" }}
+                          placeholder="1"
+                        />
+                        <div style={{ fontSize: 12, color: "#999", marginTop: 4 }}>
+                          最近M次检测
+                        </div>
+                      </div>
+                    </Col>
+                    <Col span={6}>
+                      <div style={{ marginBottom: 12 }}>
+                        <label style={{ display: "block", marginBottom: 4 }}>
+                          命中次数
+                        </label>
+                        <InputNumber
+                          value={rule.min_hits}
+                          onChange={(value) => {
+                            const newRules = [...alertRules];
+                            newRules[index].min_hits = value || 1;
+                            setAlertRules(newRules);
+                          }}
+                          min={1}
+                          max={rule.window_size}
+                          style={{ width: "100%" }}
+                          placeholder="1"
+                        />
+                        <div style={{ fontSize: 12, color: "#999", marginTop: 4 }}>
+                          M次中至少N次满足条件
+                        </div>
+                      </div>
+                    </Col>
+                    <Col span={6}>
+                      <div style={{ marginBottom: 12 }}>
+                        <label style={{ display: "block", marginBottom: 4 }}>
+                          持续时间(秒)
+                        </label>
+                        <InputNumber
+                          value={rule.min_duration_seconds}
+                          onChange={(value) => {
+                            const newRules = [...alertRules];
+                            newRules[index].min_duration_seconds = value || 0;
+                            setAlertRules(newRules);
+                          }}
+                          min={0}
+                          style={{ width: "100%" }}
+                          placeholder="0"
+                        />
+                        <div style={{ fontSize: 12, color: "#999", marginTop: 4 }}>
+                          持续满足T秒才触发，0=不要求
+                        </div>
+                      </div>
+                    </Col>
+                    <Col span={6}>
+                      <div style={{ marginBottom: 12 }}>
+                        <label style={{ display: "block", marginBottom: 4 }}>
+                          数量变化 <span style={{ color: "#999", fontSize: 12 }}>(0=不启用)</span>
+                        </label>
+                        <InputNumber
+                          value={rule.count_delta}
+                          onChange={(value) => {
+                            const newRules = [...alertRules];
+                            newRules[index].count_delta = value || 0;
+                            setAlertRules(newRules);
+                          }}
+                          min={0}
+                          style={{ width: "100%" }}
+                          placeholder="0"
+                        />
+                        <div style={{ fontSize: 12, color: "#999", marginTop: 4 }}>
+                          与M次检测前相比的数量变化
+                        </div>
+                      </div>
+                    </Col>
+                  </Row>
+                  
                   <Alert
                     message="告警规则说明"
                     description={
@@ -770,6 +895,9 @@ function AlgorithmConfigPage() {
                         <div>• 最小/最大数量：满足最小数量或超过最大数量都会触发告警</div>
                         <div>• ROI区域：留空表示检测全图，否则只在选中的ROI区域内检测</div>
                         <div>• 抑制窗口：防止短时间内重复告警，建议设置为60-300秒</div>
+                        <div>• 窗口/命中次数：最近M次检测中至少N次满足条件才触发，过滤单帧误检</div>
+                        <div>• 持续时间：连续满足T秒才触发，配合ROI区域即为区域内停留时长</div>
+                        <div>• 数量变化：与M次检测前相比目标数量增减达到设定值时触发（不再判断最小/最大数量）</div>
                       </div>
                     }
                     type="info"
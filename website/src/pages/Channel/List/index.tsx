@@ -10,6 +10,7 @@ import {
   Modal,
   Spin,
   Switch,
+  Select,
 } from "antd";
 import type { ColumnsType } from "antd/es/table";
 import { ProForm, ProFormText, ProFormDigit, ProFormSwitch, ModalForm } from "@ant-design/pro-components";
@@ -21,7 +22,14 @@ import {
   FaCog,
 } from "react-icons/fa";
 import { useNavigate } from "react-router-dom";
-import wsManager, { type WebSocketMessage } from "@/utils/websocket";
+import wsManager, {
+  type WebSocketMessage,
+  type BinaryFrame,
+  BINARY_TYPE_H264,
+  BINARY_TYPE_JPEG,
+} from "@/utils/websocket";
+import { drawOverlay, clearOverlay } from "@/utils/overlay";
+import { H264Player } from "@/utils/h264Player";
 import {
   getChannelList,
   createChannel,
@@ -32,6 +40,13 @@ import {
   type UpdateChannelParams,
 } from "@/api/channel";
 
+// 画质档位显示名称
+const TIER_LABELS: Record<string, string> = {
+  high: "高清",
+  medium: "标清",
+  low: "流畅",
+};
+
 function ChannelList() {
   const navigate = useNavigate();
   const [channels, setChannels] = useState<Channel[]>([]);
@@ -42,6 +57,11 @@ function ChannelList() {
   const [viewingChannel, setViewingChannel] = useState<Channel | null>(null);
   const [streamLoading, setStreamLoading] = useState(false);
   const imageRef = useRef<HTMLImageElement>(null);
+  const overlayRef = useRef<HTMLCanvasElement>(null);
+  const videoRef = useRef<HTMLCanvasElement>(null);
+  const [passthroughActive, setPassthroughActive] = useState(false);
+  const [streamTiers, setStreamTiers] = useState<string[]>([]);
+  const [streamTier, setStreamTier] = useState<string | undefined>(undefined);
 
   // 加载通道列表
   function loadChannels() {
@@ -210,13 +230,59 @@ function ChannelList() {
       // 处理订阅确认消息
       if (message.type === "subscription_confirmed") {
         console.log(`已成功订阅通道 ${message.channel_id}`);
+        setStreamTiers(message.tiers || []);
+        setStreamTier(message.tier);
+        return;
+      }
+      // 网络拥塞时服务端自动降低画质档位
+      if (message.type === "tier_changed") {
+        setStreamTier(message.tier);
+        return;
+      }
+    };
+
+    // 二进制消息：JPEG 画面帧、检测结果，以及直通模式的 H.264 码流
+    let player: H264Player | null = null;
+    let imageUrl: string | null = null;
+    const handleBinary = (frame: BinaryFrame) => {
+      if (frame.channel_id !== viewingChannel.id) {
         return;
       }
 
-      // 处理帧数据
-      if (message.type === "frame" && message.channel_id === viewingChannel.id) {
-        if (message.image_base64 && imageRef.current) {
-          imageRef.current.src = `data:image/jpeg;base64,${message.image_base64}`;
+      // 客户端叠加模式：检测结果与画面在同一条消息中（直通模式为单独的检测消息）
+      if (frame.overlay && overlayRef.current) {
+        drawOverlay(overlayRef.current, frame.width, frame.height, frame.detections);
+      }
+
+      if (frame.type === BINARY_TYPE_JPEG) {
+        // 通道直通结束后服务端回退为 JPEG 画面
+        if (player) {
+          player.close();
+          player = null;
+          setPassthroughActive(false);
+        }
+        if (imageRef.current && frame.payload.length > 0) {
+          const nextUrl = URL.createObjectURL(new Blob([frame.payload], { type: "image/jpeg" }));
+          imageRef.current.src = nextUrl;
+          if (imageUrl) {
+            URL.revokeObjectURL(imageUrl);
+          }
+          imageUrl = nextUrl;
+          setStreamLoading(false);
+        }
+        return;
+      }
+
+      if (frame.type !== BINARY_TYPE_H264) {
+        return;
+      }
+      if (!player && videoRef.current) {
+        player = new H264Player(videoRef.current);
+        setPassthroughActive(true);
+      }
+      if (player) {
+        player.push(frame);
+        if (frame.keyframe) {
           setStreamLoading(false);
         }
       }
@@ -224,6 +290,7 @@ function ChannelList() {
 
     // 添加消息处理器
     wsManager.addMessageHandler(handleMessage);
+    wsManager.addBinaryHandler(handleBinary);
 
     // 如果连接已建立但还未订阅，则订阅通道
     const onOpenCallback = () => {
@@ -237,7 +304,20 @@ function ChannelList() {
     // 清理函数
     return () => {
       wsManager.removeMessageHandler(handleMessage);
+      wsManager.removeBinaryHandler(handleBinary);
       wsManager.removeOnOpenCallback(onOpenCallback);
+      if (player) {
+        player.close();
+        player = null;
+      }
+      if (imageUrl) {
+        URL.revokeObjectURL(imageUrl);
+        imageUrl = null;
+      }
+      setPassthroughActive(false);
+      if (overlayRef.current) {
+        clearOverlay(overlayRef.current);
+      }
       // 关闭连接（如果需要的话，可以保留连接以便快速切换通道）
       // wsManager.disconnect();
     };
@@ -465,25 +545,64 @@ function ChannelList() {
       >
         <div style={{ textAlign: "center", padding: "20px" }}>
           <Spin spinning={streamLoading} tip="正在加载视频流...">
-            <img
-              ref={imageRef}
-              alt="视频流"
-              style={{
-                maxWidth: "100%",
-                maxHeight: "70vh",
-                objectFit: "contain",
-                backgroundColor: "#000",
-              }}
-              onError={() => {
-                setStreamLoading(false);
-                message.error("视频流加载失败");
-              }}
-            />
+            <div style={{ position: "relative", display: "inline-block", lineHeight: 0 }}>
+              <canvas
+                ref={videoRef}
+                style={{
+                  display: passthroughActive ? "block" : "none",
+                  maxWidth: "100%",
+                  maxHeight: "70vh",
+                  objectFit: "contain",
+                  backgroundColor: "#000",
+                }}
+              />
+              <img
+                ref={imageRef}
+                alt="视频流"
+                style={{
+                  display: passthroughActive ? "none" : undefined,
+                  maxWidth: "100%",
+                  maxHeight: "70vh",
+                  objectFit: "contain",
+                  backgroundColor: "#000",
+                }}
+                onError={() => {
+                  setStreamLoading(false);
+                  message.error("视频流加载失败");
+                }}
+              />
+              <canvas
+                ref={overlayRef}
+                style={{
+                  position: "absolute",
+                  top: 0,
+                  left: 0,
+                  width: "100%",
+                  height: "100%",
+                  pointerEvents: "none",
+                }}
+              />
+            </div>
           </Spin>
           {viewingChannel && (
             <div style={{ marginTop: "16px", color: "#666" }}>
               <Tag>通道ID: {viewingChannel.id}</Tag>
               <Tag>源地址: {viewingChannel.source_url}</Tag>
+              {streamTiers.length > 1 && !passthroughActive && (
+                <Select
+                  size="small"
+                  style={{ width: 100 }}
+                  value={streamTier}
+                  options={streamTiers.map((tier) => ({
+                    value: tier,
+                    label: TIER_LABELS[tier] || tier,
+                  }))}
+                  onChange={(tier: string) => {
+                    setStreamTier(tier);
+                    wsManager.setTier(tier);
+                  }}
+                />
+              )}
             </div>
           )}
         </div>
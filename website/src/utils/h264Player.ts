@@ -0,0 +1,110 @@
+import type { BinaryFrame } from "@/utils/websocket";
+
+/**
+ * 浏览器是否支持 WebCodecs 解码（不支持时订阅 JPEG 画面）
+ */
+export function isH264PlaybackSupported(): boolean {
+  return typeof window !== "undefined" && "VideoDecoder" in window;
+}
+
+/**
+ * 从 Annex-B 访问单元中查找 SPS，生成 WebCodecs 需要的 codec 字符串（avc1.PPCCLL）
+ */
+function findCodecString(data: Uint8Array): string | null {
+  for (let i = 0; i + 4 < data.length; i++) {
+    // 起始码 00 00 01（四字节起始码 00 00 00 01 同样匹配其后三字节）
+    if (data[i] === 0 && data[i + 1] === 0 && data[i + 2] === 1) {
+      const nalType = data[i + 3] & 0x1f;
+      if (nalType === 7 && i + 6 < data.length) {
+        const hex = (v: number) => v.toString(16).padStart(2, "0");
+        return `avc1.${hex(data[i + 4])}${hex(data[i + 5])}${hex(data[i + 6])}`;
+      }
+      i += 2;
+    }
+  }
+  return null;
+}
+
+/**
+ * 直通 H.264 播放器：使用 WebCodecs 解码服务端转发的 Annex-B 访问单元并绘制到 canvas
+ * 从关键帧开始解码，解码出错时丢弃后续数据直到下一个关键帧
+ */
+export class H264Player {
+  private canvas: HTMLCanvasElement;
+  private decoder: VideoDecoder | null = null;
+  private codec: string | null = null;
+  private waitingKeyframe = true;
+
+  constructor(canvas: HTMLCanvasElement) {
+    this.canvas = canvas;
+  }
+
+  push(frame: BinaryFrame) {
+    if (this.waitingKeyframe) {
+      if (!frame.keyframe) {
+        return;
+      }
+      const codec = findCodecString(frame.payload);
+      if (!codec) {
+        return;
+      }
+      if (!this.decoder || this.decoder.state === "closed" || codec !== this.codec) {
+        this.createDecoder(codec);
+      }
+      this.waitingKeyframe = false;
+    }
+
+    if (!this.decoder || this.decoder.state !== "configured") {
+      return;
+    }
+
+    try {
+      this.decoder.decode(
+        new EncodedVideoChunk({
+          type: frame.keyframe ? "key" : "delta",
+          timestamp: frame.pts * 1000,
+          data: frame.payload,
+        })
+      );
+    } catch (error) {
+      console.error("H.264 解码失败:", error);
+      this.waitingKeyframe = true;
+    }
+  }
+
+  close() {
+    if (this.decoder && this.decoder.state !== "closed") {
+      this.decoder.close();
+    }
+    this.decoder = null;
+    this.codec = null;
+    this.waitingKeyframe = true;
+  }
+
+  private createDecoder(codec: string) {
+    this.close();
+    this.codec = codec;
+    this.decoder = new VideoDecoder({
+      output: (videoFrame) => {
+        const ctx = this.canvas.getContext("2d");
+        if (ctx) {
+          if (
+            this.canvas.width !== videoFrame.displayWidth ||
+            this.canvas.height !== videoFrame.displayHeight
+          ) {
+            this.canvas.width = videoFrame.displayWidth;
+            this.canvas.height = videoFrame.displayHeight;
+          }
+          ctx.drawImage(videoFrame, 0, 0);
+        }
+        videoFrame.close();
+      },
+      error: (error) => {
+        console.error("H.264 解码器错误:", error);
+        this.waitingKeyframe = true;
+      },
+    });
+    // 未提供 description 时，WebCodecs 按 Annex-B 格式解析码流
+    this.decoder.configure({ codec, optimizeForLatency: true });
+  }
+}
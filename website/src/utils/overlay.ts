@@ -0,0 +1,57 @@
+import type { OverlayDetection } from "@/utils/websocket";
+
+// 与服务端叠加样式保持一致
+const BOX_COLOR = "#00ff00";
+const TEXT_COLOR = "#000000";
+const LINE_WIDTH = 2;
+const FONT = "14px sans-serif";
+const LABEL_PADDING = 5;
+
+/**
+ * 在画面上层的 canvas 中绘制检测框（客户端叠加模式）
+ * canvas 的绘图尺寸设置为帧的原始尺寸，显示尺寸由 CSS 跟随图片缩放
+ */
+export function drawOverlay(
+  canvas: HTMLCanvasElement,
+  frameWidth: number,
+  frameHeight: number,
+  detections: OverlayDetection[]
+) {
+  const ctx = canvas.getContext("2d");
+  if (!ctx) {
+    return;
+  }
+
+  const width = frameWidth || canvas.width;
+  const height = frameHeight || canvas.height;
+  if (canvas.width !== width || canvas.height !== height) {
+    canvas.width = width;
+    canvas.height = height;
+  }
+
+  ctx.clearRect(0, 0, canvas.width, canvas.height);
+  ctx.lineWidth = LINE_WIDTH;
+  ctx.font = FONT;
+  ctx.textBaseline = "bottom";
+
+  for (const det of detections) {
+    const { x, y, w, h } = det.bbox;
+    ctx.strokeStyle = BOX_COLOR;
+    ctx.strokeRect(x, y, w, h);
+
+    const label = `${det.class_name} ${det.confidence.toFixed(2)}`;
+    const textWidth = ctx.measureText(label).width;
+    const labelHeight = 14 + LABEL_PADDING * 2;
+    ctx.fillStyle = BOX_COLOR;
+    ctx.fillRect(x, y - labelHeight, textWidth + LABEL_PADDING * 2, labelHeight);
+    ctx.fillStyle = TEXT_COLOR;
+    ctx.fillText(label, x + LABEL_PADDING, y - LABEL_PADDING);
+  }
+}
+
+export function clearOverlay(canvas: HTMLCanvasElement) {
+  const ctx = canvas.getContext("2d");
+  if (ctx) {
+    ctx.clearRect(0, 0, canvas.width, canvas.height);
+  }
+}
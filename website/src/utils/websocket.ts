@@ -1,18 +1,125 @@
 import Config from "@/config/index";
+import { isH264PlaybackSupported } from "@/utils/h264Player";
+import type { ZoneAnalytics } from "@/api/analytics";
+
+// 客户端叠加模式下随帧下发的检测结果（由二进制消息解析）
+export interface OverlayDetection {
+  class_id: number;
+  class_name: string;
+  confidence: number;
+  bbox: { x: number; y: number; w: number; h: number };
+}
 
 export interface WebSocketMessage {
-  type: "frame" | "alert" | "subscription_confirmed" | "alert_subscription_confirmed";
+  type: "alert" | "subscription_confirmed" | "alert_subscription_confirmed" | "tier_changed" | "analytics";
   channel_id: number;
   image_base64?: string;
   channel_name?: string;
   alert_type?: string;
   confidence?: number;
   detected_objects?: string;
-  timestamp: string;
+  timestamp?: string;
+  format?: StreamFormat; // 订阅确认中返回的画面格式
+  tier?: string; // 订阅确认或档位变更中返回的画质档位
+  tiers?: string[]; // 服务端支持的画质档位，第一个为默认档位
+  zones?: ZoneAnalytics[]; // 区域统计推送中各区域的实时统计
+  pts_ms?: number; // 区域统计对应检测帧的时间戳
+}
+
+// 画面格式：h264 仅在通道开启直通时生效，否则服务端回退为 JPEG
+export type StreamFormat = "jpeg" | "h264";
+
+function defaultStreamFormat(): StreamFormat {
+  return isH264PlaybackSupported() ? "h264" : "jpeg";
 }
 
 export type WebSocketMessageHandler = (message: WebSocketMessage) => void;
 
+// 二进制消息（大端序），与服务端 ws_binary_protocol.h 保持一致
+// 头部：type(1) flags(1) count(2) channel_id(4) sequence(4) pts_ms(8)
+// JPEG_FRAME / DETECTIONS 负载：width(2) height(2) jpeg_size(4) jpeg 检测记录 × count
+// 检测记录：class_id(2) confidence(2, ×10000) x(2) y(2) w(2) h(2) name_len(1) name
+const BINARY_HEADER_SIZE = 20;
+const FRAME_INFO_SIZE = 8;
+export const BINARY_TYPE_H264 = 1;
+export const BINARY_TYPE_JPEG = 2;
+export const BINARY_TYPE_DETECTIONS = 3;
+const BINARY_FLAG_KEYFRAME = 0x01;
+const BINARY_FLAG_OVERLAY = 0x02;
+
+const textDecoder = new TextDecoder();
+
+export interface BinaryFrame {
+  type: number;
+  keyframe: boolean;
+  overlay: boolean; // 是否携带检测结果，由客户端绘制
+  channel_id: number;
+  sequence: number;
+  pts: number; // 帧采集时间戳（毫秒）
+  payload: Uint8Array; // H.264 访问单元或 JPEG 数据
+  width: number;
+  height: number;
+  detections: OverlayDetection[];
+}
+
+export type BinaryFrameHandler = (frame: BinaryFrame) => void;
+
+function parseBinaryFrame(buffer: ArrayBuffer): BinaryFrame | null {
+  if (buffer.byteLength < BINARY_HEADER_SIZE) {
+    return null;
+  }
+  const view = new DataView(buffer);
+  const type = view.getUint8(0);
+  const flags = view.getUint8(1);
+  const frame: BinaryFrame = {
+    type,
+    keyframe: (flags & BINARY_FLAG_KEYFRAME) !== 0,
+    overlay: (flags & BINARY_FLAG_OVERLAY) !== 0,
+    channel_id: view.getUint32(4),
+    sequence: view.getUint32(8),
+    pts: Number(view.getBigInt64(12)),
+    payload: new Uint8Array(buffer, BINARY_HEADER_SIZE),
+    width: 0,
+    height: 0,
+    detections: [],
+  };
+
+  if (type !== BINARY_TYPE_JPEG && type !== BINARY_TYPE_DETECTIONS) {
+    return frame;
+  }
+  if (buffer.byteLength < BINARY_HEADER_SIZE + FRAME_INFO_SIZE) {
+    return null;
+  }
+
+  frame.width = view.getUint16(BINARY_HEADER_SIZE);
+  frame.height = view.getUint16(BINARY_HEADER_SIZE + 2);
+  const jpegSize = view.getUint32(BINARY_HEADER_SIZE + 4);
+  let offset = BINARY_HEADER_SIZE + FRAME_INFO_SIZE;
+  if (offset + jpegSize > buffer.byteLength) {
+    return null;
+  }
+  frame.payload = new Uint8Array(buffer, offset, jpegSize);
+  offset += jpegSize;
+
+  const count = view.getUint16(2);
+  for (let i = 0; i < count && offset + 13 <= buffer.byteLength; i++) {
+    const nameLength = view.getUint8(offset + 12);
+    frame.detections.push({
+      class_id: view.getUint16(offset),
+      confidence: view.getUint16(offset + 2) / 10000,
+      bbox: {
+        x: view.getUint16(offset + 4),
+        y: view.getUint16(offset + 6),
+        w: view.getUint16(offset + 8),
+        h: view.getUint16(offset + 10),
+      },
+      class_name: textDecoder.decode(new Uint8Array(buffer, offset + 13, nameLength)),
+    });
+    offset += 13 + nameLength;
+  }
+  return frame;
+}
+
 class ChannelWebSocketManager {
   private ws: WebSocket | null = null;
   private reconnectTimer: number | null = null;
@@ -20,16 +127,23 @@ class ChannelWebSocketManager {
   private maxReconnectAttempts = 5;
   private reconnectDelay = 3000;
   private messageHandlers: Set<WebSocketMessageHandler> = new Set();
+  private binaryHandlers: Set<BinaryFrameHandler> = new Set();
   private isConnecting = false;
   private subscribedChannelId: number | null = null;
   private pendingChannelId: number | null = null;
+  private format: StreamFormat = defaultStreamFormat();
+  private tier: string | null = null;
   private onOpenCallbacks: Set<() => void> = new Set();
 
-  connect(channelId?: number) {
+  connect(channelId?: number, format?: StreamFormat) {
+    if (channelId !== undefined) {
+      this.format = format ?? defaultStreamFormat();
+    }
+
     if (this.isConnecting || (this.ws && this.ws.readyState === WebSocket.OPEN)) {
       // 如果已连接且有新的 channelId，直接订阅
       if (channelId !== undefined && this.ws && this.ws.readyState === WebSocket.OPEN) {
-        this.subscribeChannel(channelId);
+        this.subscribeChannel(channelId, this.format);
       }
       return;
     }
@@ -44,6 +158,7 @@ class ChannelWebSocketManager {
 
     try {
       this.ws = new WebSocket(wsUrl);
+      this.ws.binaryType = "arraybuffer";
 
       this.ws.onopen = () => {
         console.log("通道数据 WebSocket 连接已建立");
@@ -62,6 +177,15 @@ class ChannelWebSocketManager {
       };
 
       this.ws.onmessage = (event) => {
+        // 二进制消息：画面帧、检测结果和直通的 H.264 码流
+        if (event.data instanceof ArrayBuffer) {
+          const frame = parseBinaryFrame(event.data);
+          if (frame) {
+            this.binaryHandlers.forEach((handler) => handler(frame));
+          }
+          return;
+        }
+
         try {
           const message: WebSocketMessage = JSON.parse(event.data);
           
@@ -70,6 +194,11 @@ class ChannelWebSocketManager {
             console.log(`已成功订阅通道 ${message.channel_id}`);
             this.subscribedChannelId = message.channel_id;
           }
+
+          // 网络拥塞时服务端会主动降低画质档位，重连后沿用新档位
+          if (message.type === "tier_changed" && message.tier) {
+            this.tier = message.tier;
+          }
           
           // 处理帧数据和其他消息
           this.messageHandlers.forEach((handler) => handler(message));
@@ -121,7 +250,7 @@ class ChannelWebSocketManager {
     this.reconnectTimer = window.setTimeout(() => {
       this.reconnectTimer = null;
       if (channelIdToResubscribe !== null) {
-        this.connect(channelIdToResubscribe);
+        this.connect(channelIdToResubscribe, this.format);
       } else {
         this.connect();
       }
@@ -140,11 +269,16 @@ class ChannelWebSocketManager {
     }
 
     this.messageHandlers.clear();
+    this.binaryHandlers.clear();
     this.reconnectAttempts = 0;
     this.subscribedChannelId = null;
   }
 
-  subscribeChannel(channelId: number) {
+  subscribeChannel(channelId: number, format?: StreamFormat) {
+    if (format) {
+      this.format = format;
+    }
+
     if (!this.ws || this.ws.readyState !== WebSocket.OPEN) {
       console.warn("WebSocket 未连接，无法订阅通道");
       return;
@@ -153,6 +287,8 @@ class ChannelWebSocketManager {
     const subscribeMessage = {
       action: "subscribe",
       channel_id: channelId,
+      format: this.format,
+      ...(this.tier ? { tier: this.tier } : {}),
     };
 
     try {
@@ -171,10 +307,26 @@ class ChannelWebSocketManager {
     this.messageHandlers.delete(handler);
   }
 
+  addBinaryHandler(handler: BinaryFrameHandler) {
+    this.binaryHandlers.add(handler);
+  }
+
+  removeBinaryHandler(handler: BinaryFrameHandler) {
+    this.binaryHandlers.delete(handler);
+  }
+
   isConnected(): boolean {
     return this.ws !== null && this.ws.readyState === WebSocket.OPEN;
   }
 
+  // 切换画质档位，已订阅时立即重新订阅
+  setTier(tier: string | null) {
+    this.tier = tier;
+    if (this.subscribedChannelId !== null) {
+      this.subscribeChannel(this.subscribedChannelId);
+    }
+  }
+
   getSubscribedChannelId(): number | null {
     return this.subscribedChannelId;
   }